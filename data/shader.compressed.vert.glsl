@@ -0,0 +1,62 @@
+#version 450
+
+layout(binding = 0) uniform Ubo {
+    mat4 vp;
+    vec3 viewPos;
+    vec4 time;
+    vec3 lightDirection;
+    vec3 lightPos;
+};
+
+struct ObjectData
+{
+    // includes the mapping from the mesh bounds to model space
+    mat4 model;
+    // upper 3x3: normal matrix, last column: uv scale (xy) and offset (zw)
+    mat4 modelInvT;
+};
+
+layout(std430, binding = 1) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+// CompressedVertex: positions relative to the mesh bounds, octahedral normals, uvs relative to the uv bounds
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 normalOctahedral;
+layout(location = 2) in vec2 uv;
+
+layout(location = 0) out vec3 fragPositionWorld;
+layout(location = 1) out vec3 fragPositionModel;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec3 fragColor;
+layout(location = 4) out vec2 fragUv;
+
+layout(push_constant) uniform pushConstants
+{
+    uint objectId;
+};
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    mat4 model = objects[objectId].model;
+    mat4 modelInvT = objects[objectId].modelInvT;
+    vec4 positionWorld = model * vec4(position.xyz, 1.f);
+    vec4 positionView = vp * positionWorld;
+    vec3 normalWorld = mat3(modelInvT) * decodeOctahedral(normalOctahedral);
+
+    gl_Position = positionView;
+    fragPositionWorld = positionWorld.xyz;
+    // normalized to the mesh bounds
+    fragPositionModel = position.xyz;
+    fragNormalWorld = normalWorld;
+    fragColor = vec3(1.f);
+    fragUv = uv * modelInvT[3].xy + modelInvT[3].zw;
+}
@@ -1,5 +1,9 @@
 #version 450
 
+// material features, specialized per pipeline variant, see ShaderFeatures
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool SPECULAR = true;
+
 layout(set = 0, binding = 0) uniform Ubo {
     mat4 vp;
     vec3 viewPos;
@@ -8,12 +12,18 @@ layout(set = 0, binding = 0) uniform Ubo {
     vec3 lightColor;
 };
 
-layout(set = 1, binding = 0) uniform MaterialParameters {
+struct MaterialParameters
+{
     vec3 ambient;
     vec3 diffuse;
     vec4 specularAndShininess;
-} material;
-layout(set = 1, binding = 1) uniform sampler2D tex0;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Materials {
+    MaterialParameters materials[];
+};
+
+layout(set = 1, binding = 0) uniform sampler2D tex0;
 
 layout(location = 0) in vec3 positionWorld;
 layout(location = 1) in vec3 positionModel;
@@ -23,24 +33,32 @@ layout(location = 4) in vec2 uv;
 
 layout(location = 0) out vec4 outColor;
 
+layout(push_constant) uniform pushConstants
+{
+    uint objectId;
+    uint materialId;
+};
+
 vec3 phong(vec3 color)
 {
+    MaterialParameters material = materials[materialId];
     vec3 normal = normalize(normalWorld);
     vec3 lightDirection = normalize(lightPos - positionWorld);
-    vec3 reflection = normalize(reflect(-lightDirection, normal));
-    vec3 viewDir = normalize(viewPos - positionWorld);
-
-    vec3 diffuse = max(dot(lightDirection, normal) * material.diffuse, 0.0);
-    vec3 specular = min(
-        pow(max(dot(reflection, viewDir), 0.0), material.specularAndShininess.w) * material.specularAndShininess.xyz,
-        1.0
-    );
-    return clamp(material.ambient + diffuse + specular, 0.0, 1.0) * color;
+
+    vec3 light = material.ambient + max(dot(lightDirection, normal) * material.diffuse, 0.0);
+    if (SPECULAR) {
+        vec3 reflection = normalize(reflect(-lightDirection, normal));
+        vec3 viewDir = normalize(viewPos - positionWorld);
+        light += min(
+            pow(max(dot(reflection, viewDir), 0.0), material.specularAndShininess.w) * material.specularAndShininess.xyz,
+            1.0
+        );
+    }
+    return clamp(light, 0.0, 1.0) * color;
 }
 
 void main()
 {
-    vec4 texColor = texture(tex0, uv);
-    texColor = vec4(phong(texColor.xyz), texColor.a);
-    outColor = texColor;
+    vec4 color = TEXTURED ? texture(tex0, uv) : vec4(inColor, 1.0);
+    outColor = vec4(phong(color.xyz), color.a);
 }
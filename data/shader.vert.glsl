@@ -8,6 +8,16 @@ layout(binding = 0) uniform Ubo {
     vec3 lightPos;
 };
 
+struct ObjectData
+{
+    mat4 model;
+    mat4 modelInvT;
+};
+
+layout(std430, binding = 1) readonly buffer Objects {
+    ObjectData objects[];
+};
+
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec3 color;
@@ -21,19 +31,20 @@ layout(location = 4) out vec2 fragUv;
 
 layout(push_constant) uniform pushConstants
 {
-    mat4 model;
-    mat4 modelInvT;
+    uint objectId;
 };
 
 void main() {
+    mat4 model = objects[objectId].model;
+    mat4 modelInvT = objects[objectId].modelInvT;
     vec4 positionWorld = model * vec4(position, 1.f);
     vec4 positionView = vp * positionWorld;
-    vec4 normalWorld = modelInvT * vec4(normal, 1.f);
+    vec3 normalWorld = mat3(modelInvT) * normal;
 
     gl_Position = positionView;
     fragPositionWorld = positionWorld.xyz;
     fragPositionModel = position;
-    fragNormalWorld = normalWorld.xyz;
+    fragNormalWorld = normalWorld;
     fragColor = color;
     fragUv = uv;
 }
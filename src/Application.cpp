@@ -5,9 +5,11 @@
 #include "RenderObject.h"
 #include "RenderPass.h"
 #include "ResourceRepository.h"
+#include "StartupProfiler.h"
 #include "VkHelpers.h"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cmath>
@@ -39,12 +41,28 @@
 #include <sstream>
 
 
-Application::Application(bool enableValidationLayers, uint32_t concurrentFrames, bool singleFrame)
+Application::Application(
+	bool enableValidationLayers,
+	uint32_t concurrentFrames,
+	bool singleFrame,
+	const std::optional<SceneGenerator::Settings> &sceneSettings,
+	const std::filesystem::path &assetPack,
+	bool pushDescriptors,
+	std::unordered_map<ResourceKey, MeshImportSettings> meshSettings
+)
 	: concurrentFrames(concurrentFrames),
+	sceneSettings(sceneSettings),
+	assetPack(assetPack),
+	meshSettings(std::move(meshSettings)),
+	pushDescriptors(pushDescriptors),
 	exited(singleFrame)
 {
-	initWindow();
-	initVulkan(enableValidationLayers);
+	{
+		StartupProfiler::Scope scope("startup");
+		initWindow();
+		initVulkan(enableValidationLayers);
+	}
+	StartupProfiler::finish();
 }
 
 Application::~Application()
@@ -56,6 +74,10 @@ Application::~Application()
 
 void Application::run()
 {
+	// a single frame has no time to see any file change
+	if (hotReload && !exited) {
+		assetReloader = std::make_unique<AssetReloader>(std::filesystem::current_path());
+	}
 	startedAtTimePoint = std::chrono::high_resolution_clock::now();
 	mainLoop();
 }
@@ -66,8 +88,29 @@ void Application::setTargetFps(float targetFps)
 	this->targetFps = targetFps;
 }
 
+void Application::setLodSelection(const LodSelection &lodSelection)
+{
+	this->lodSelection = lodSelection;
+}
+
+void Application::setClusterCulling(const ClusterCulling &clusterCulling)
+{
+	this->clusterCulling = clusterCulling;
+}
+
+void Application::setHotReload(bool hotReload)
+{
+	this->hotReload = hotReload;
+}
+
+void Application::setMemoryBudget(VkDeviceSize budget)
+{
+	device->getObjectCache().setMemoryBudget(budget);
+}
+
 void Application::initWindow()
 {
+	StartupProfiler::Scope scope("init window");
 	spdlog::info("initializing window...");
 	glfwInit();
 
@@ -93,29 +136,76 @@ void Application::initVulkan(bool validationLayers)
 	}
 	std::vector<const char *> instanceExtensions(glfwExtensions, glfwExtensions + glfwRequiredExtensionsCount);
 
-	instance = std::make_unique<Instance>(instanceExtensions, validationLayers);
-	
-	VK_ASSERT(glfwCreateWindowSurface(instance->getHandle(), window, nullptr, &surface));
-	
-	device = std::make_unique<Device>(
-		*instance, 
-		surface,
-		std::vector<const char *>{ 
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+	{
+		StartupProfiler::Scope scope("create instance");
+		instance = std::make_unique<Instance>(
+			instanceExtensions,
+			validationLayers,
+			// required by VK_KHR_push_descriptor on Vulkan 1.0
+			std::vector<const char *>{ VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME }
+		);
+		VK_ASSERT(glfwCreateWindowSurface(instance->getHandle(), window, nullptr, &surface));
+	}
+	{
+		StartupProfiler::Scope scope("create device");
+		std::vector<const char *> optionalDeviceExtensions{
+			// complete descriptor set writes use update templates if available
+			VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+		};
+		if (pushDescriptors && instance->isExtensionEnabled(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+			optionalDeviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
 		}
-	);
-
-	createRenderPassAndSwapChain();
-
-	loadResources();
-
-	createInitialObjects();
+		device = std::make_unique<Device>(
+			*instance, 
+			surface,
+			std::vector<const char *>{ 
+				VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+			},
+			optionalDeviceExtensions
+		);
+		if (pushDescriptors && !device->getFunctions().hasPushDescriptors()) {
+			spdlog::warn("VK_KHR_push_descriptor is not supported, material descriptor sets are bound instead");
+			pushDescriptors = false;
+		}
+		device->getObjectCache().setPushMaterialDescriptors(pushDescriptors);
+	}
+	{
+		StartupProfiler::Scope scope("create render pass and swap chain");
+		createRenderPassAndSwapChain();
+	}
+	// filled by addMaterial()
+	materialBuffer = std::make_unique<MaterialBuffer>(device->getAllocator(), concurrentFrames);
+	{
+		StartupProfiler::Scope scope("load resources");
+		loadResources();
+	}
+	{
+		StartupProfiler::Scope scope("create initial objects");
+		createInitialObjects();
+	}
+	{
+		// the initial pipelines are compiled in parallel, but the first frame shows all of them
+		StartupProfiler::Scope scope("compile pipelines");
+		device->getObjectCache().waitForGraphicsPipelines();
+	}
+	const ResourceRepository::DeduplicationStatistics &deduplication = resourceRepository->getDeduplicationStatistics();
+	if (deduplication.aliasCount > 0) {
+		spdlog::info(
+			"{} loaded resources were duplicates of others, {:.1f} MiB saved",
+			deduplication.aliasCount,
+			static_cast<double>(deduplication.bytesSaved) / (1024. * 1024.)
+		);
+	}
 	
+	StartupProfiler::Scope scope("create frames");
+	objectBuffer = std::make_unique<ObjectBuffer>(device->getAllocator(), concurrentFrames);
 	frames.reserve(concurrentFrames);
-	for (size_t i = 0; i < concurrentFrames; ++i) {
+	for (uint32_t i = 0; i < concurrentFrames; ++i) {
 		Frame &frame = frames.emplace_back(
 			*device, 
-			device->getQueueFamilyIndices().graphics.value()
+			device->getQueueFamilyIndices().graphics.value(),
+			objectBuffer->getDescriptorBufferInfo(i),
+			materialBuffer->getDescriptorBufferInfo()
 		);
 		updateDescriptors(frame);
 	}
@@ -234,26 +324,42 @@ void Application::recreateSwapChain()
 
 void Application::loadResources()
 {
-	spdlog::info("creating resource repository and loading resources...");
-
-	resourceRepository = std::make_unique<ResourceRepository>("image/default");
+	spdlog::info("creating resource repository...");
+
+	// resources are only indexed here and loaded when objects use them
+	resourceRepository = std::make_unique<ResourceRepository>(
+		"image/default",
+		MeshImportSettings{},
+		meshSettings,
+		assetPack
+	);
 
-	spdlog::info("loaded resources:\n{}", resourceRepository->resourceTree(1));
+	spdlog::info("resources:\n{}", resourceRepository->resourceTree(1));
 }
 
 void Application::createInitialObjects()
 {
+	if (sceneSettings) {
+		createGeneratedScene(*sceneSettings);
+		return;
+	}
+
 	spdlog::info("creating initial objects...");
+	resourceRepository->prefetch({
+		"mesh/Low-Poly Plant_",
+		"mesh/cylinder",
+		"mesh/icosphere",
+	});
 
 	spdlog::info("add cone...");
 	addObject(
-		resourceRepository->getMesh("mesh/Low-Poly Plant_"),
+		"mesh/Low-Poly Plant_",
 		glm::mat4{1.f},
 		"mid"
 	);
 	spdlog::info("add cylinder...");
 	addObject(
-		resourceRepository->getMesh("mesh/cylinder"),
+		"mesh/cylinder",
 		glm::translate(
 			glm::rotate(glm::mat4{1.f}, glm::quarter_pi<float>(), glm::vec3(0.f, 0.f, 1.f)),
 			 glm::vec3(-1.5f, -2.5f, 0.f)
@@ -262,7 +368,7 @@ void Application::createInitialObjects()
 	);
 	spdlog::info("add sun...");
 	addObject(
-		resourceRepository->getMesh("mesh/icosphere"),
+		"mesh/icosphere",
 		glm::translate(glm::mat4(1.f), glm::vec3(5.f, 5.f, 3.f)),
 		"sun"
 	);
@@ -270,20 +376,273 @@ void Application::createInitialObjects()
 	camera.lookAt(glm::vec3(0.f), 10.f, glm::quarter_pi<float>(), glm::quarter_pi<float>());
 }
 
-void Application::updateDescriptors(Frame &frame)
+void Application::createGeneratedScene(const SceneGenerator::Settings &settings)
 {
-	// make sure all required descriptor sets have been allocated and initialize them
-	for (auto &pipelineIter : graphicsPipelines) {
-		GraphicsPipeline &pipeline = *pipelineIter.second;
+	spdlog::info(
+		"generating {} scene with {} objects and {} materials (seed {})...",
+		SceneGenerator::getLayoutName(settings.layout),
+		settings.objectCount,
+		settings.materialCount,
+		settings.seed
+	);
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	SceneGenerator::Scene scene = SceneGenerator(settings).generate(*resourceRepository);
 
-		frame.getDescriptorSet(
-			0, 
-			pipeline.getMaterialDescriptorSetLayout(), 
-			pipeline.getMaterial().getDescriptorBufferInfos(),
-			pipeline.getMaterial().getDescriptorImageInfos()
+	std::vector<Material *> sceneMaterials;
+	sceneMaterials.reserve(scene.materials.size());
+	for (MaterialHandle material : scene.materials) {
+		sceneMaterials.push_back(addMaterial(resourceRepository->get(material)).second);
+	}
+	renderObjects.reserve(renderObjects.size() + scene.objects.size());
+	for (const SceneGenerator::Object &object : scene.objects) {
+		uint32_t id = addObject(
+			resourceRepository->getName(object.mesh),
+			*sceneMaterials[object.material],
+			object.transform
 		);
+		if (object.angularVelocity != 0.f) {
+			animations.push_back(Animation{
+				.objectId = id,
+				.transform = object.transform,
+				.rotationAxis = object.rotationAxis,
+				.angularVelocity = object.angularVelocity,
+			});
+		}
+	}
+
+	float distance = std::max(scene.radius * 2.f, 10.f);
+	camera.setFar(distance + scene.radius * 2.f);
+	camera.lookAt(glm::vec3(0.f), distance, glm::quarter_pi<float>(), glm::quarter_pi<float>());
+
+	float seconds = std::chrono::duration<float, std::chrono::seconds::period>(
+		std::chrono::high_resolution_clock::now() - startTime
+	).count();
+	spdlog::info(
+		"scene: {} objects ({} animated), {} materials, {} meshes uploaded, {} triangles at full detail, created in {:.2f}s",
+		scene.objects.size(),
+		animations.size(),
+		sceneMaterials.size(),
+		meshBuffers.size(),
+		scene.triangleCount,
+		seconds
+	);
+}
+
+void Application::animateObjects()
+{
+	for (const Animation &animation : animations) {
+		// the rotation is applied in model space, so objects spin around their own center
+		getObject(animation.objectId).setTransform(glm::rotate(
+			animation.transform,
+			animation.angularVelocity * secondsRunning,
+			animation.rotationAxis
+		));
+	}
+}
+
+void Application::updateObjectBuffer(Frame &frame)
+{
+	// normal matrices are only computed for objects that moved
+	for (RenderObject &r : renderObjects) {
+		if (r.takeObjectDataChanged()) {
+			objectBuffer->set(r.getId(), r.getObjectData());
+		}
+	}
+	if (objectBuffer->update(currentFrameIndex)) {
+		frame.setObjectBuffer(objectBuffer->getDescriptorBufferInfo(currentFrameIndex));
+	}
+	drawStatistics.updatedObjects = objectBuffer->getLastUpdateCount();
+}
+
+void Application::updateMaterialBuffer(VkCommandBuffer commandBuffer, Frame &frame)
+{
+	// the buffer is shared by all frames, the ones in flight keep reading the old one until they retire
+	if (materialBuffer->update(currentFrameIndex, commandBuffer, frameCounter, frame.getSubmittedFrame())) {
+		for (Frame &f : frames) {
+			f.setMaterialBuffer(materialBuffer->getDescriptorBufferInfo());
+		}
 	}
-	frame.updateDescriptorSets(0);
+	drawStatistics.updatedMaterials = materialBuffer->getLastUpdateCount();
+}
+
+void Application::reloadAssets()
+{
+	if (!assetReloader) {
+		return;
+	}
+
+	// changed files are read on the reloader's thread, only swapping them in happens here
+	for (const auto &path : assetReloader->takeChangedFiles()) {
+		auto request = resourceRepository->getReloadRequest(path);
+		if (request) {
+			spdlog::info("reloading {}...", request->name);
+			assetReloader->request(std::move(*request));
+		}
+	}
+
+	std::vector<ResourceRepository::Reload> reloads = assetReloader->takeReloads();
+	if (reloads.empty()) {
+		return;
+	}
+
+	// called between frames, so waiting for the device makes everything created from the old data unused
+	device->waitDeviceIdle();
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (auto &reload : reloads) {
+		ResourceKey name = reload.name;
+		try {
+			applyReload(std::move(reload));
+		}
+		catch (const std::exception &e) {
+			spdlog::error("reloading {} failed: {}", name, e.what());
+		}
+	}
+	for (Frame &frame : frames) {
+		updateDescriptors(frame);
+	}
+	spdlog::info(
+		"swapped in {} reloaded resources in {:.3f}s",
+		reloads.size(),
+		std::chrono::duration<float, std::chrono::seconds::period>(
+			std::chrono::high_resolution_clock::now() - startTime
+		).count()
+	);
+}
+
+void Application::applyReload(ResourceRepository::Reload reload)
+{
+	typedef ResourceRepository::ResourceType ResourceType;
+	ResourceType type = reload.type;
+	ResourceKey name = reload.name;
+
+	// a name that shared its resource with others is split off by the repository,
+	// then only the users of that name switch to the new resource and the old one is not evicted
+	if (type == ResourceType::MESH) {
+		// objects keep their materials, so the new mesh must not draw slots they have none for
+		for (const RenderObject &r : renderObjects) {
+			if (r.getMeshName() != name) {
+				continue;
+			}
+			for (const Mesh::Submesh &submesh : reload.mesh->submeshes) {
+				if (submesh.material >= r.getMaterials().size() || !r.getMaterials()[submesh.material]) {
+					throw std::runtime_error(fmt::format(
+						"material slot {} is new, the mesh is only reloaded on restart", submesh.material
+					));
+				}
+			}
+		}
+
+		std::optional<ResourceId> oldId = resourceRepository->apply(std::move(reload));
+		if (oldId) {
+			meshBuffers.erase(*oldId);
+		}
+		const MeshResource &mesh = resourceRepository->getMesh(name);
+		std::shared_ptr<const MeshBuffer> buffer = getMeshBuffer(mesh);
+		for (RenderObject &r : renderObjects) {
+			if (r.getMeshName() == name) {
+				for (const Material *material : r.getMaterials()) {
+					if (material) {
+						getGraphicsPipeline(*material, mesh.getData().getVertexFormat());
+					}
+				}
+				r.setMesh(mesh, buffer);
+			}
+		}
+	}
+	else if (type == ResourceType::IMAGE) {
+		std::optional<ResourceId> oldId = resourceRepository->apply(std::move(reload));
+		const ImageResource &image = resourceRepository->getImage(name);
+		for (auto &i : materials) {
+			Material &material = *i.second;
+			// the frames' material sets pick up the new image views in updateDescriptors()
+			if (material.usesImage(image)) {
+				material.reloadImages();
+			}
+		}
+		if (oldId) {
+			device->getObjectCache().evictImage(*oldId);
+		}
+	}
+	else {
+		std::optional<ResourceId> oldId = resourceRepository->apply(std::move(reload));
+		const ShaderResource &shader = type == ResourceType::VERTEX_SHADER
+			? resourceRepository->getVertexShader(name)
+			: resourceRepository->getFragmentShader(name);
+		for (auto &i : graphicsPipelines) {
+			const Material &material = *materials.at(i.first.first);
+			VertexFormat vertexFormat = i.first.second;
+			if (&material.getVertexShaderResource(vertexFormat) != &shader
+				&& &material.getFragmentShaderResource() != &shader
+			) {
+				continue;
+			}
+			// a shader that does not fit the material leaves the previous pipeline in place
+			try {
+				i.second = device->getObjectCache().acquireGraphicsPipeline(*renderPass, material, vertexFormat);
+			}
+			catch (const std::exception &e) {
+				spdlog::error("rebuilding pipeline of material {} failed: {}", material.getId(), e.what());
+			}
+		}
+		if (oldId) {
+			device->getObjectCache().evictShader(*oldId);
+		}
+	}
+}
+
+void Application::updateDescriptors(Frame &frame)
+{
+	// creates the material sets or writes the bindings that changed, e.g. reloaded images,
+	// so that drawing only looks up the material's set by its id; pushed descriptors need no sets
+	if (!pushDescriptors) {
+		for (auto &i : materials) {
+			frame.updateMaterialDescriptorSet(*i.second);
+		}
+	}
+	frame.flushDescriptorUpdates();
+}
+
+void Application::selectLods()
+{
+	float viewportHeight = static_cast<float>(swapChain->getExtent().height);
+
+	drawStatistics = DrawStatistics{};
+	for (auto &r : renderObjects) {
+		uint32_t lod = r.selectLod(camera, viewportHeight, lodSelection);
+		if (drawStatistics.objectsPerLod.size() <= lod) {
+			drawStatistics.objectsPerLod.resize(lod + 1, 0);
+		}
+		++drawStatistics.objectsPerLod[lod];
+		drawStatistics.fullTriangles += r.getTriangleCount(0);
+		// triangles of visible meshlets are counted while recording
+		if (!clusterCulling.enabled || !r.usesMeshlets()) {
+			drawStatistics.drawnTriangles += r.getTriangleCount(lod);
+		}
+	}
+}
+
+void Application::logDrawStatistics() const
+{
+	std::string levels;
+	for (size_t i = 0; i < drawStatistics.objectsPerLod.size(); ++i) {
+		levels += fmt::format(" {}: {}", i, drawStatistics.objectsPerLod[i]);
+	}
+	spdlog::info(
+		"Draw statistics: max pixel error {}, triangles {} of {}, meshlets {} of {}, updated objects {}, "
+		"updated materials {}, transient descriptor sets {} (peak {}, {} pools), objects per level:{}",
+		lodSelection.maxPixelError,
+		drawStatistics.drawnTriangles,
+		drawStatistics.fullTriangles,
+		drawStatistics.visibleMeshlets,
+		drawStatistics.meshlets,
+		drawStatistics.updatedObjects,
+		drawStatistics.updatedMaterials,
+		drawStatistics.transientDescriptors.allocatedSets,
+		drawStatistics.transientDescriptors.peakAllocatedSets,
+		drawStatistics.transientDescriptors.poolCount,
+		levels
+	);
 }
 
 void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, Frame &frame)
@@ -295,6 +654,9 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuff
 
 	VK_ASSERT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
+	// copies changed material parameters, which cannot be done inside the render pass
+	updateMaterialBuffer(commandBuffer, frame);
+
 	VkExtent2D swapChainExtent = swapChain->getExtent();
 	float vpWdt = static_cast<float>(swapChainExtent.width);
 	float vpHgt = static_cast<float>(swapChainExtent.height);
@@ -328,32 +690,102 @@ void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuff
 	scissor.extent = swapChainExtent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	for (const auto &r : renderObjects) {
-		GraphicsPipeline &pipeline = *graphicsPipelines.at(r.getMaterial().getId());
-		pipeline.bind(commandBuffer);
-
-		pipeline.bindDescriptorSet(
-			commandBuffer,
-			DescriptorSetIndex::GLOBAL_UNIFORM_DATA,
-			frame.getGlobalUniformDataDescriptorSet()
-		);
-		pipeline.bindDescriptorSet(commandBuffer, DescriptorSetIndex::MATERIAL_DATA,
-			frame.getDescriptorSet(
-				0,
-				pipeline.getMaterialDescriptorSetLayout(), 
-				r.getMaterial().getDescriptorBufferInfos(),
-				r.getMaterial().getDescriptorImageInfos()
-		));
+	// culled meshlets of all objects share one indirect buffer, each object using its own range
+	size_t meshletCount = 0;
+	if (clusterCulling.enabled) {
+		for (const auto &r : renderObjects) {
+			if (r.usesMeshlets()) {
+				meshletCount += r.getMeshletCount();
+			}
+		}
+	}
+	VkDrawIndexedIndirectCommand *indirectCommands = nullptr;
+	VkBuffer indirectBuffer = VK_NULL_HANDLE;
+	if (meshletCount > 0) {
+		MappedBuffer &buffer = frame.getIndirectCommandBuffer(meshletCount);
+		indirectCommands = reinterpret_cast<VkDrawIndexedIndirectCommand *>(buffer.getData());
+		indirectBuffer = buffer.getHandle();
+	}
 
-		pushConstants.transform = r.getTransform();
-		pushConstants.normalTransform = glm::transpose(glm::inverse(pushConstants.transform));
+	RenderObject::IndirectCommands indirect{
+		.buffer = indirectBuffer,
+		.commands = indirectCommands,
+		.count = 0,
+		.multiDraw = device->getEnabledFeatures().multiDrawIndirect == VK_TRUE,
+	};
+
+	// consecutive materials sharing a pipeline only rebind their descriptor set
+	const GraphicsPipeline *boundPipeline = nullptr;
+	// created once per frame, the std::function would allocate per object otherwise
+	const RenderObject *drawnObject = nullptr;
+	RenderObject::MaterialBinder bindMaterial = [&](const Material &material) {
+		GraphicsPipeline *requestedPipeline = graphicsPipelines.at(
+			std::make_pair(material.getId(), drawnObject->getVertexFormat())
+		).get();
+		// still compiling, drawn with a compatible pipeline or not at all
+		if (!requestedPipeline->isReady()) {
+			requestedPipeline = requestedPipeline->getFallback();
+			if (!requestedPipeline) {
+				return false;
+			}
+		}
+		GraphicsPipeline &pipeline = *requestedPipeline;
+		if (&pipeline != boundPipeline) {
+			pipeline.bind(commandBuffer);
+			pipeline.bindDescriptorSet(
+				commandBuffer,
+				DescriptorSetIndex::GLOBAL_UNIFORM_DATA,
+				frame.getGlobalUniformDataDescriptorSet()
+			);
+			boundPipeline = &pipeline;
+		}
+		// the parameters are looked up by materialId, the material's set only holds its textures
+		if (pushDescriptors) {
+			pipeline.pushDescriptorSet(
+				commandBuffer,
+				DescriptorSetIndex::MATERIAL_DATA,
+				material.getPushDescriptorWrites()
+			);
+		}
+		else {
+			pipeline.bindDescriptorSet(
+				commandBuffer,
+				DescriptorSetIndex::MATERIAL_DATA,
+				frame.getMaterialDescriptorSet(material)
+			);
+		}
+		pushConstants.materialId = material.getId();
 		pipeline.pushConstants(
 			commandBuffer, 
 			static_cast<void *>(&pushConstants), 
 			sizeof(pushConstants)
 		);
-		
-		r.enqueueDrawCommands(commandBuffer);
+		return true;
+	};
+
+	for (const auto &r : renderObjects) {
+		// the transforms are read from the ObjectBuffer
+		pushConstants.objectId = r.getId();
+		drawnObject = &r;
+
+		if (indirectCommands && r.usesMeshlets()) {
+			uint32_t firstCommand = indirect.count;
+			uint32_t drawCount = r.enqueueMeshletDrawCommands(
+				commandBuffer,
+				camera,
+				clusterCulling,
+				indirect,
+				bindMaterial
+			);
+			for (uint32_t i = firstCommand; i < indirect.count; ++i) {
+				drawStatistics.drawnTriangles += indirectCommands[i].indexCount / 3;
+			}
+			drawStatistics.meshlets += r.getMeshletCount();
+			drawStatistics.visibleMeshlets += drawCount;
+		}
+		else {
+			r.enqueueDrawCommands(commandBuffer, bindMaterial);
+		}
 	}
 
 	vkCmdEndRenderPass(commandBuffer);
@@ -427,8 +859,15 @@ void Application::draw()
 		VK_TRUE, 
 		UINT64_MAX
 	);
+	// frames are submitted in order, so every frame up to the one that used this fence has retired
+	device->getObjectCache().beginFrame(frameCounter, frame.getSubmittedFrame());
+	frame.resetTransientDescriptorSets();
+	device->getPipelineCache().saveIfDue();
 
 	updateCamera();
+	animateObjects();
+	selectLods();
+	updateObjectBuffer(frame);
 
 	GlobalUniformData uniformData{};
 	uniformData.viewProj = camera.getTransform();
@@ -459,6 +898,7 @@ void Application::draw()
 		throw std::runtime_error(fmt::format("vkResetCommandBuffer failed with code {}", (int32_t) result));
 	}
 	recordCommandBuffer(commandBuffer, swapChainFramebuffers[imageIndex], frame);
+	drawStatistics.transientDescriptors = frame.getTransientDescriptorStatistics();
 
 	VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 	VkSubmitInfo submitInfo{};
@@ -475,6 +915,7 @@ void Application::draw()
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error(fmt::format("vkQueueSubmit failed with code {}", (int32_t) result));
 	}
+	frame.setSubmittedFrame(frameCounter);
 
 	result = swapChain->queuePresent(presentQueue, imageIndex, renderFinishedSemaphore);
 	if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR || needsSwapChainRecreation) {
@@ -505,6 +946,7 @@ void Application::mainLoop()
 
 		if (!paused) {
 			handleInput();
+			reloadAssets();
 			draw();
 		}
 
@@ -544,7 +986,8 @@ void Application::mainLoop()
 void Application::updateInfoDisplay()
 {
 	std::stringstream s;
-	s << "Demo " << std::setprecision(3) << frameRate << " fps";
+	s << "Demo " << std::setprecision(3) << frameRate << " fps, "
+		<< drawStatistics.drawnTriangles << "/" << drawStatistics.fullTriangles << " triangles";
 	if (paused) {
 		s << " paused";
 	}
@@ -563,11 +1006,16 @@ void Application::cleanup()
 {
 	spdlog::info("cleaning up...");
 
+	assetReloader.reset();
+
 	renderObjects.clear();
+	meshBuffers.clear();
 	frames.clear();
-	for (auto &i : graphicsPipelines) {
-		i.second.reset();
-	}
+	objectBuffer.reset();
+	materialBuffer.reset();
+	graphicsPipelines.clear();
+	// compilations still running use the render pass
+	device->getObjectCache().waitForGraphicsPipelines();
 	for (auto &i : materials) {
 		i.second.reset();
 	}
@@ -587,21 +1035,16 @@ void Application::addMaterial(std::unique_ptr<Material> material)
 	if (materials.find(material->getId()) != materials.end()) {
 		throw std::runtime_error(fmt::format("Material with ID {} already exists", material->getId()));
 	}
-	Material &inserted = *materials.insert(
+	materialBuffer->set(material->getId(), material->getParameters());
+	materials.insert(
 		std::make_pair<uint32_t, std::unique_ptr<Material>>(material->getId(), std::move(material))
-	).first->second;
-	graphicsPipelines.insert(std::make_pair(
-		inserted.getId(),
-		std::make_unique<GraphicsPipeline>(
-			*device,
-			*renderPass,
-			inserted
-	)));
+	);
 }
 
 
 std::pair<uint32_t, Material *> Application::addMaterial(const MaterialResource &resource)
 {
+	StartupProfiler::Scope scope("create material", resource.getData().name);
 	uint32_t newId = nextMaterialId++;
 	auto mat = std::make_unique<Material>(newId, *device, resource);
 	Material *retMat = mat.get();
@@ -609,37 +1052,104 @@ std::pair<uint32_t, Material *> Application::addMaterial(const MaterialResource
 	return std::make_pair(newId, retMat);
 }
 
+GraphicsPipeline &Application::getGraphicsPipeline(const Material &material, VertexFormat vertexFormat)
+{
+	auto key = std::make_pair(material.getId(), vertexFormat);
+	auto iter = graphicsPipelines.find(key);
+	if (iter == graphicsPipelines.end()) {
+		iter = graphicsPipelines.emplace(
+			key,
+			device->getObjectCache().acquireGraphicsPipeline(*renderPass, material, vertexFormat)
+		).first;
+	}
+	return *iter->second;
+}
+
+std::shared_ptr<const MeshBuffer> Application::getMeshBuffer(const MeshResource &mesh)
+{
+	auto iter = meshBuffers.find(mesh.getId());
+	if (iter == meshBuffers.end()) {
+		StartupProfiler::Scope scope("upload mesh", fmt::format("resource {}", mesh.getId()));
+		iter = meshBuffers.emplace(
+			mesh.getId(),
+			std::make_shared<const MeshBuffer>(device->getAllocator(), mesh.getData())
+		).first;
+	}
+	return iter->second;
+}
+
 uint32_t Application::addObject(
-	const MeshResource &mesh,
+	const ResourceKey &meshName,
 	const Material &material,
 	glm::mat4 transform,
 	std::string name
 ) {
+	const MeshResource &mesh = resourceRepository->getMesh(meshName);
+	std::vector<const Material *> slots(mesh.getData().getMaterials().size(), &material);
+	return addObject(meshName, std::move(slots), transform, name);
+}
+
+uint32_t Application::addObject(
+	const ResourceKey &meshName,
+	std::vector<const Material *> materials,
+	glm::mat4 transform,
+	std::string name
+) {
+	const MeshResource &mesh = resourceRepository->getMesh(meshName);
 	size_t newIndex = renderObjects.size();
 	uint32_t newId = nextId++;
 
-	spdlog::info("add object: id {}, index {}", newId, newIndex);
+	spdlog::trace("add object: id {}, index {}", newId, newIndex);
 
-	renderObjects.emplace_back(newId, *device, mesh, material, name).setTransform(transform);
+	for (const Material *material : materials) {
+		if (material) {
+			getGraphicsPipeline(*material, mesh.getData().getVertexFormat());
+		}
+	}
+	renderObjects.emplace_back(
+		newId,
+		*device,
+		mesh,
+		meshName,
+		getMeshBuffer(mesh),
+		std::move(materials),
+		name
+	).setTransform(transform);
 	renderObjectIdIndexMap.emplace(newId, newIndex);
 
 	return newId;
 }
 
-
 uint32_t Application::addObject(
-	const MeshResource &mesh,
+	const ResourceKey &meshName,
 	glm::mat4 transform,
 	std::string name
 ) {
-	spdlog::info("addObject: mesh {} with material {}", (void*)&mesh, (void*)mesh.getData().getMaterial());
-	const MaterialResource *matResource = mesh.getData().getMaterial();
-	if (!matResource) {
-		throw std::runtime_error("Application::addObject: No material specified and mesh has no assigned material");
+	const MeshResource &mesh = resourceRepository->getMesh(meshName);
+	const std::vector<const MaterialResource *> &resources = mesh.getData().getMaterials();
+	spdlog::info("addObject: mesh {} with {} materials", meshName, resources.size());
+
+	// only slots that are drawn get a material, slots sharing a resource share the material
+	std::vector<bool> used(resources.size(), false);
+	for (const Mesh::Submesh &submesh : mesh.getData().getSubmeshes()) {
+		used[submesh.material] = true;
 	}
-	Material *mat = addMaterial(*matResource).second;
-	uint32_t id = addObject(mesh, *mat, transform, name);
-	return id;
+	std::vector<const Material *> materials(resources.size(), nullptr);
+	std::map<const MaterialResource *, const Material *> created;
+	for (size_t i = 0; i < resources.size(); ++i) {
+		if (!used[i]) {
+			continue;
+		}
+		if (!resources[i]) {
+			throw std::runtime_error("Application::addObject: No material specified and mesh has no assigned material");
+		}
+		auto iter = created.find(resources[i]);
+		if (iter == created.end()) {
+			iter = created.emplace(resources[i], addMaterial(*resources[i]).second).first;
+		}
+		materials[i] = iter->second;
+	}
+	return addObject(meshName, std::move(materials), transform, name);
 }
 
 RenderObject &Application::getObject(uint32_t id)
@@ -698,5 +1208,8 @@ void Application::onKeyEvent(GLFWwindow* window, int key, int scancode, int acti
 		else if (key == GLFW_KEY_KP_SUBTRACT) {
 			myThis->camera.addFar(-10.f);
 		}
+		else if (key == GLFW_KEY_L) {
+			myThis->logDrawStatistics();
+		}
 	}
 }
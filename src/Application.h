@@ -1,6 +1,7 @@
 #ifndef _APPLICATION_H_
 #define _APPLICATION_H_
 
+#include "AssetReloader.h"
 #include "Camera.h"
 #include "GraphicsPipeline.h"
 #include "RenderObject.h"
@@ -10,6 +11,8 @@
 #include "SwapChain.h"
 #include "Buffer.h"
 #include "Mesh.h"
+#include "ObjectBuffer.h"
+#include "MaterialBuffer.h"
 #include "Frame.h"
 #include "Instance.h"
 #include "Device.h"
@@ -19,6 +22,8 @@
 #include "Image.h"
 #include "Material.h"
 #include "Resource.h"
+#include "SceneGenerator.h"
+#include "MeshBuffer.h"
 
 #include <cstddef>
 #include <glm/ext/matrix_float4x4.hpp>
@@ -28,6 +33,7 @@
 #include <GLFW/glfw3.h>
 #include <cstdint>
 #include <filesystem>
+#include <map>
 #include <optional>
 #include <spdlog/spdlog.h>
 #include <unordered_map>
@@ -41,11 +47,50 @@ public:
     const uint32_t WIDTH = 800;
     const uint32_t HEIGHT = 800;
 
-	Application(bool enableValidationLayers, uint32_t concurrentFrames, bool singleFrame);
+	// without scene settings, a few fixed objects are shown;
+	// without an asset pack, resources are loaded from the working directory;
+	// pushDescriptors pushes material descriptors while recording instead of binding per frame sets,
+	// if the device supports VK_KHR_push_descriptor;
+	// meshSettings overrides the import settings of single meshes
+	Application(
+		bool enableValidationLayers,
+		uint32_t concurrentFrames,
+		bool singleFrame,
+		const std::optional<SceneGenerator::Settings> &sceneSettings = std::nullopt,
+		const std::filesystem::path &assetPack = {},
+		bool pushDescriptors = false,
+		std::unordered_map<ResourceKey, MeshImportSettings> meshSettings = {}
+	);
 	~Application();
 	void run();
     void setTargetFps(float targetFps);
+    void setLodSelection(const LodSelection &lodSelection);
+    void setClusterCulling(const ClusterCulling &clusterCulling);
+    // watch the working directory and reload changed meshes, images and shaders while running
+    void setHotReload(bool hotReload);
+    // device memory that unused cached images may occupy before the least recently used ones are destroyed
+    void setMemoryBudget(VkDeviceSize budget);
 private:
+    struct DrawStatistics
+    {
+        std::vector<uint32_t> objectsPerLod;
+        uint64_t drawnTriangles = 0;
+        uint64_t fullTriangles = 0;
+        uint64_t meshlets = 0;
+        uint64_t visibleMeshlets = 0;
+        size_t updatedObjects = 0;
+        size_t updatedMaterials = 0;
+        Frame::TransientDescriptorStatistics transientDescriptors;
+    };
+
+    struct Animation
+    {
+        uint32_t objectId;
+        glm::mat4 transform;
+        glm::vec3 rotationAxis;
+        float angularVelocity;
+    };
+
     void initWindow();
     void initVulkan(bool validationLayers);
     void createLogicalDevice();
@@ -59,7 +104,15 @@ private:
     void recreateSwapChain();
     void loadResources();
     void createInitialObjects();
+    void createGeneratedScene(const SceneGenerator::Settings &settings);
+    void animateObjects();
+    void updateObjectBuffer(Frame &frame);
+    void updateMaterialBuffer(VkCommandBuffer commandBuffer, Frame &frame);
+    void reloadAssets();
+    void applyReload(ResourceRepository::Reload reload);
     void updateDescriptors(Frame &frame);
+    void selectLods();
+    void logDrawStatistics() const;
     void recordCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, Frame &frame);
     void mainLoop();
     void updateInfoDisplay();
@@ -70,14 +123,24 @@ private:
     void cleanup();
     void addMaterial(std::unique_ptr<Material> material);
     std::pair<uint32_t, Material *> addMaterial(const MaterialResource &resource);
+    GraphicsPipeline &getGraphicsPipeline(const Material &material, VertexFormat vertexFormat);
+    std::shared_ptr<const MeshBuffer> getMeshBuffer(const MeshResource &mesh);
+    // objects keep the name of their mesh, so that reloading it only affects the objects using that name
     uint32_t addObject(
-        const MeshResource &mesh,
+        const ResourceKey &meshName,
         const Material &material,
         glm::mat4 transform = glm::mat4{1.f},
         std::string name = ""
     );
+    // one material per material slot of the mesh
+    uint32_t addObject(
+        const ResourceKey &meshName,
+        std::vector<const Material *> materials,
+        glm::mat4 transform = glm::mat4{1.f},
+        std::string name = ""
+    );
     uint32_t addObject(
-        const MeshResource &mesh,
+        const ResourceKey &meshName,
         glm::mat4 transform = glm::mat4{1.f},
         std::string name = ""
     );
@@ -95,6 +158,10 @@ private:
     static void onKeyEvent(GLFWwindow* window, int key, int scancode, int action, int mods);
 
     uint32_t concurrentFrames;
+    std::optional<SceneGenerator::Settings> sceneSettings;
+    std::filesystem::path assetPack;
+    std::unordered_map<ResourceKey, MeshImportSettings> meshSettings;
+    bool pushDescriptors;
     GLFWwindow *window = nullptr;
     bool paused = false;
     bool exited = false;
@@ -111,6 +178,8 @@ private:
     VkSurfaceKHR surface = VK_NULL_HANDLE;
     std::unique_ptr<Device> device;
     std::unique_ptr<ResourceRepository> resourceRepository;
+    bool hotReload = true;
+    std::unique_ptr<AssetReloader> assetReloader;
     std::unique_ptr<SwapChain> swapChain;
     std::unique_ptr<DepthImage> depthImage;
     std::unique_ptr<RenderPass> renderPass;
@@ -121,9 +190,18 @@ private:
     bool needsSwapChainRecreation = false;
     bool recreatingSwapChain = false;
     PushConstants pushConstants;
+    LodSelection lodSelection;
+    ClusterCulling clusterCulling;
+    DrawStatistics drawStatistics;
     std::unordered_map<uint32_t, std::unique_ptr<Material>> materials;
+    std::unique_ptr<MaterialBuffer> materialBuffer;
     uint32_t nextMaterialId = 1;
-    std::unordered_map<uint32_t, std::unique_ptr<GraphicsPipeline>> graphicsPipelines;
+    // keyed by material id and vertex format, materials with the same shaders share the cached pipeline
+    std::map<std::pair<uint32_t, VertexFormat>, CacheReference<GraphicsPipeline>> graphicsPipelines;
+    // keyed by mesh resource id, every mesh is uploaded once no matter how many objects draw it
+    std::unordered_map<ResourceId, std::shared_ptr<const MeshBuffer>> meshBuffers;
+    std::vector<Animation> animations;
+    std::unique_ptr<ObjectBuffer> objectBuffer;
     uint32_t nextId = 1;
     std::vector<RenderObject> renderObjects;
     std::unordered_map<uint32_t, size_t> renderObjectIdIndexMap;
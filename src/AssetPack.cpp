@@ -0,0 +1,212 @@
+#include "AssetPack.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <spdlog/fmt/fmt.h>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+    uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + AssetPack::BLOB_ALIGNMENT - 1) / AssetPack::BLOB_ALIGNMENT * AssetPack::BLOB_ALIGNMENT;
+    }
+
+    void writePadding(std::ofstream &file, uint64_t targetOffset)
+    {
+        static const char zeros[AssetPack::BLOB_ALIGNMENT] = {};
+        uint64_t offset = static_cast<uint64_t>(file.tellp());
+        file.write(zeros, static_cast<std::streamsize>(targetOffset - offset));
+    }
+
+    uint64_t mix(uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdull;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ull;
+        value ^= value >> 33;
+        return value;
+    }
+}
+
+AssetPack::AssetPack(const std::filesystem::path &path)
+    : mapping(std::make_shared<const MappedFile>(path)),
+    header(reinterpret_cast<const Header *>(mapping->getData()))
+{
+    validate();
+}
+
+
+const AssetPack::Header &AssetPack::getHeader() const
+{
+    return *header;
+}
+
+const AssetPack::Entry *AssetPack::getEntries() const
+{
+    return reinterpret_cast<const Entry *>(mapping->getData() + header->entryOffset);
+}
+
+std::string AssetPack::getName(const Entry &entry) const
+{
+    const char *names = reinterpret_cast<const char *>(mapping->getData() + header->nameOffset);
+    return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+const std::byte *AssetPack::getData(const Entry &entry) const
+{
+    return mapping->getData() + entry.offset;
+}
+
+const std::shared_ptr<const MappedFile> &AssetPack::getMapping() const
+{
+    return mapping;
+}
+
+void AssetPack::verify(const Entry &entry) const
+{
+    if (hash(getData(entry), entry.size) != entry.hash) {
+        throw std::runtime_error(fmt::format(
+            "AssetPack {}: {} is corrupted", mapping->getPath().string(), getName(entry)
+        ));
+    }
+}
+
+uint64_t AssetPack::hash(const std::byte *data, size_t size)
+{
+    // word at a time, so that checking a blob costs little more than reading it
+    uint64_t result = mix(size ^ 0x9e3779b97f4a7c15ull);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        result = (result ^ mix(word)) * 0x9e3779b97f4a7c15ull;
+    }
+    uint64_t tail = 0;
+    if (i < size) {
+        std::memcpy(&tail, data + i, size - i);
+    }
+    return mix(result ^ mix(tail));
+}
+
+void AssetPack::write(const std::filesystem::path &path, std::vector<Blob> blobs)
+{
+    std::sort(blobs.begin(), blobs.end(), [](const Blob &a, const Blob &b) {
+        return a.name < b.name || (a.name == b.name && a.type < b.type);
+    });
+
+    Header header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(blobs.size());
+    header.entryOffset = alignOffset(sizeof(Header));
+    header.nameOffset = header.entryOffset + blobs.size() * sizeof(Entry);
+
+    std::string names;
+    std::vector<Entry> entries(blobs.size(), Entry{});
+    for (size_t i = 0; i < blobs.size(); ++i) {
+        entries[i].nameOffset = names.size();
+        entries[i].nameLength = static_cast<uint32_t>(blobs[i].name.size());
+        entries[i].type = blobs[i].type;
+        entries[i].size = blobs[i].data.size();
+        entries[i].hash = hash(blobs[i].data.data(), blobs[i].data.size());
+        names += blobs[i].name;
+    }
+    header.nameSize = names.size();
+
+    // identical blobs are stored once, their entries share the offset
+    std::unordered_map<uint64_t, std::vector<size_t>> blobsByHash;
+    std::vector<bool> stored(blobs.size(), false);
+    uint64_t offset = header.nameOffset + names.size();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Entry &entry = entries[i];
+        std::vector<size_t> &candidates = blobsByHash[entry.hash];
+        auto original = std::find_if(candidates.begin(), candidates.end(), [&blobs, &i](size_t j) {
+            return blobs[j].data == blobs[i].data;
+        });
+        if (original != candidates.end()) {
+            entry.offset = entries[*original].offset;
+            continue;
+        }
+        candidates.push_back(i);
+        stored[i] = true;
+        entry.offset = alignOffset(offset);
+        offset = entry.offset + entry.size;
+    }
+
+    // write to a temporary file first so that a crash never leaves a truncated pack behind
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error(fmt::format("AssetPack: could not open {} for writing", temporaryPath.string()));
+        }
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writePadding(file, header.entryOffset);
+        file.write(
+            reinterpret_cast<const char *>(entries.data()),
+            static_cast<std::streamsize>(entries.size() * sizeof(Entry))
+        );
+        file.write(names.data(), static_cast<std::streamsize>(names.size()));
+        for (size_t i = 0; i < blobs.size(); ++i) {
+            if (!stored[i]) {
+                continue;
+            }
+            writePadding(file, entries[i].offset);
+            file.write(
+                reinterpret_cast<const char *>(blobs[i].data.data()),
+                static_cast<std::streamsize>(blobs[i].data.size())
+            );
+        }
+
+        if (!file) {
+            throw std::runtime_error(fmt::format("AssetPack: writing {} failed", temporaryPath.string()));
+        }
+    }
+    std::filesystem::rename(temporaryPath, path);
+}
+
+void AssetPack::validate() const
+{
+    const std::string fileName = mapping->getPath().string();
+    const size_t size = mapping->getSize();
+
+    if (size < sizeof(Header)) {
+        throw std::runtime_error(fmt::format("AssetPack {}: file too small", fileName));
+    }
+    if (header->magic != MAGIC) {
+        throw std::runtime_error(fmt::format("AssetPack {}: invalid magic number", fileName));
+    }
+    if (header->version != VERSION) {
+        throw std::runtime_error(fmt::format(
+            "AssetPack {}: version {} is not supported (expected {})", fileName, header->version, VERSION
+        ));
+    }
+    // offsets are compared before sizes are subtracted from what follows them, sums could wrap around
+    if (header->entryOffset % alignof(Entry)
+        || header->entryOffset > size
+        || header->entryCount > (size - header->entryOffset) / sizeof(Entry)
+        || header->nameOffset > size
+        || header->nameSize > size - header->nameOffset
+    ) {
+        throw std::runtime_error(fmt::format("AssetPack {}: table of contents exceeds file size", fileName));
+    }
+    for (uint32_t i = 0; i < header->entryCount; ++i) {
+        const Entry &entry = getEntries()[i];
+        if (entry.nameOffset > header->nameSize
+            || entry.nameLength > header->nameSize - entry.nameOffset
+            || entry.offset % BLOB_ALIGNMENT
+            || entry.offset > size
+            || entry.size > size - entry.offset
+        ) {
+            throw std::runtime_error(fmt::format("AssetPack {}: entry {} is out of range", fileName, i));
+        }
+    }
+}
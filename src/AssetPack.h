@@ -0,0 +1,88 @@
+#ifndef ASSETPACK_H_
+#define ASSETPACK_H_
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Single file holding preprocessed resources, mapped into memory as a whole so that they can be used in place.
+// Layout: Header | Entry[entryCount] | names | blobs, every blob starting at a multiple of BLOB_ALIGNMENT.
+// Blobs are MeshFile images for meshes, an ImageHeader followed by RGBA8 pixels for images and SPIR-V for shaders;
+// entries of identical blobs point to the same one.
+class AssetPack
+{
+public:
+    static constexpr uint32_t MAGIC = 0x4b434150; // "PACK"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t BLOB_ALIGNMENT = 16;
+    static constexpr const char *EXTENSION = ".pack";
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t pad;
+        uint64_t entryOffset;
+        uint64_t nameOffset;
+        uint64_t nameSize;
+    };
+
+    // sorted by name
+    struct Entry
+    {
+        // relative to Header::nameOffset
+        uint64_t nameOffset;
+        uint32_t nameLength;
+        // ResourceRepository::ResourceType
+        uint32_t type;
+        uint64_t offset;
+        uint64_t size;
+        // see hash(), checked by verify()
+        uint64_t hash;
+    };
+
+    struct ImageHeader
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t pad;
+    };
+
+    // a resource to be written into a pack
+    struct Blob
+    {
+        uint32_t type;
+        std::string name;
+        std::vector<std::byte> data;
+    };
+
+    AssetPack(const std::filesystem::path &path);
+    AssetPack(const AssetPack &) = delete;
+    AssetPack(AssetPack &&) = default;
+    ~AssetPack() = default;
+
+    const Header &getHeader() const;
+    const Entry *getEntries() const;
+    std::string getName(const Entry &entry) const;
+    const std::byte *getData(const Entry &entry) const;
+    // shared with everything served from the pack, so that it stays mapped while in use
+    const std::shared_ptr<const MappedFile> &getMapping() const;
+    // throws if the blob no longer matches the hash it was written with
+    void verify(const Entry &entry) const;
+
+    static uint64_t hash(const std::byte *data, size_t size);
+    static void write(const std::filesystem::path &path, std::vector<Blob> blobs);
+private:
+    void validate() const;
+
+    std::shared_ptr<const MappedFile> mapping;
+    const Header *header;
+};
+
+#endif
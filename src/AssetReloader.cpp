@@ -0,0 +1,201 @@
+#include "AssetReloader.h"
+#include "ResourceRepository.h"
+#include "third-party/stb_image.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // how long the thread blocks waiting for file events before it looks at new requests
+    constexpr int POLL_TIMEOUT_MS = 50;
+}
+
+AssetReloader::AssetReloader(const std::filesystem::path &root)
+{
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        throw std::runtime_error(fmt::format("AssetReloader: inotify_init1 failed: {}", std::strerror(errno)));
+    }
+    addWatches(root);
+    spdlog::info("AssetReloader: watching {} directories below {}", watches.size(), root.string());
+
+    running = true;
+    thread = std::thread(&AssetReloader::run, this);
+#else
+    spdlog::warn("AssetReloader: file watching is only supported on Linux, assets are not reloaded");
+#endif
+}
+
+AssetReloader::~AssetReloader()
+{
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+#endif
+    for (auto &reload : reloads) {
+        // decoded images own memory that is otherwise freed by the repository
+        if (reload.image) {
+            stbi_image_free(reload.image->data);
+        }
+    }
+}
+
+
+bool AssetReloader::isWatching() const
+{
+    return running;
+}
+
+std::vector<std::filesystem::path> AssetReloader::takeChangedFiles()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::filesystem::path> files(changedFiles.begin(), changedFiles.end());
+    changedFiles.clear();
+    return files;
+}
+
+void AssetReloader::request(ResourceRepository::ReloadRequest request)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &pending : requests) {
+        if (pending.type == request.type && pending.name == request.name) {
+            return;
+        }
+    }
+    requests.push_back(std::move(request));
+}
+
+std::vector<ResourceRepository::Reload> AssetReloader::takeReloads()
+{
+    std::vector<ResourceRepository::Reload> taken;
+    std::lock_guard<std::mutex> lock(mutex);
+    taken.swap(reloads);
+    return taken;
+}
+
+void AssetReloader::run()
+{
+    while (running) {
+        readEvents();
+        decodeRequests();
+    }
+}
+
+void AssetReloader::addWatches(const std::filesystem::path &directory)
+{
+#ifdef __linux__
+    auto addWatch = [this](const std::filesystem::path &path) {
+        int watch = inotify_add_watch(
+            inotifyFd,
+            path.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR
+        );
+        if (watch < 0) {
+            spdlog::warn("AssetReloader: cannot watch {}: {}", path.string(), std::strerror(errno));
+            return;
+        }
+        watches[watch] = path;
+    };
+
+    addWatch(directory);
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator i(directory, error), end; i != end; i.increment(error)) {
+        if (error || !i->is_directory()) {
+            continue;
+        }
+        // the same trees the resource index skips
+        std::string fileName = i->path().filename().string();
+        if (!fileName.empty() && fileName[0] == '.') {
+            i.disable_recursion_pending();
+            continue;
+        }
+        addWatch(i->path());
+    }
+#endif
+}
+
+void AssetReloader::readEvents()
+{
+#ifdef __linux__
+    pollfd descriptor{inotifyFd, POLLIN, 0};
+    if (poll(&descriptor, 1, POLL_TIMEOUT_MS) <= 0) {
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length;) {
+            const inotify_event &event = *reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event.len;
+
+            auto watch = watches.find(event.wd);
+            if (watch == watches.end() || event.len == 0) {
+                continue;
+            }
+            std::filesystem::path path = watch->second / event.name;
+            if (event.mask & IN_ISDIR) {
+                if (event.mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addWatches(path);
+                }
+            }
+            // files are only reported once they are completely written
+            else if (event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                changedFiles.insert(path);
+            }
+        }
+    }
+#endif
+}
+
+void AssetReloader::decodeRequests()
+{
+    while (true) {
+        ResourceRepository::ReloadRequest request;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (requests.empty()) {
+                return;
+            }
+            request = std::move(requests.front());
+            requests.pop_front();
+        }
+
+        try {
+            auto startTime = std::chrono::high_resolution_clock::now();
+            ResourceRepository::Reload reload = ResourceRepository::decode(request);
+            float seconds = std::chrono::duration<float, std::chrono::seconds::period>(
+                std::chrono::high_resolution_clock::now() - startTime
+            ).count();
+            spdlog::info("AssetReloader: decoded {} in {:.3f}s", request.name, seconds);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            reloads.push_back(std::move(reload));
+        }
+        catch (std::exception &e) {
+            spdlog::error("AssetReloader: reloading {} failed: {}", request.name, e.what());
+        }
+    }
+}
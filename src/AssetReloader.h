@@ -0,0 +1,49 @@
+#ifndef ASSETRELOADER_H_
+#define ASSETRELOADER_H_
+
+#include "ResourceRepository.h"
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Watches a directory tree for written files (inotify, Linux only) and decodes the resources
+// requested for reloading on its own thread, so that only swapping them in is left to the render thread.
+class AssetReloader
+{
+public:
+    AssetReloader(const std::filesystem::path &root);
+    AssetReloader(const AssetReloader &) = delete;
+    ~AssetReloader();
+
+    bool isWatching() const;
+    // files written or moved into the tree since the last call
+    std::vector<std::filesystem::path> takeChangedFiles();
+    void request(ResourceRepository::ReloadRequest request);
+    // resources decoded since the last call, in the order they were requested
+    std::vector<ResourceRepository::Reload> takeReloads();
+private:
+    void run();
+    void addWatches(const std::filesystem::path &directory);
+    void readEvents();
+    void decodeRequests();
+
+    int inotifyFd = -1;
+    // watch descriptor -> watched directory
+    std::unordered_map<int, std::filesystem::path> watches;
+
+    std::mutex mutex;
+    std::set<std::filesystem::path> changedFiles;
+    std::deque<ResourceRepository::ReloadRequest> requests;
+    std::vector<ResourceRepository::Reload> reloads;
+
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
+
+#endif
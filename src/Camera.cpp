@@ -1,6 +1,7 @@
 #include "Camera.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <glm/ext/matrix_transform.hpp>
@@ -62,6 +63,38 @@ glm::vec3 Camera::getEye() const
     return eye;
 }
 
+float Camera::getProjectedSize(const glm::vec3 &center, float radius, float viewportHeight) const
+{
+    float distance = glm::length(center - eye);
+    if (distance <= radius) {
+        return std::numeric_limits<float>::max();
+    }
+    return viewportHeight * radius / (distance * std::tan(fovy * 0.5f));
+}
+
+std::array<glm::vec4, 6> Camera::getFrustumPlanes() const
+{
+    const glm::mat4 &m = currentTransform;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    // clip space depth is in [0, w]
+    std::array<glm::vec4, 6> planes{
+        row3 + row0,
+        row3 - row0,
+        row3 + row1,
+        row3 - row1,
+        row2,
+        row3 - row2,
+    };
+    for (glm::vec4 &plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
 void Camera::lookAt(glm::vec3 center, float r, float theta, float phi)
 {
     this->center = center;
@@ -113,6 +146,13 @@ void Camera::addFar(float dzFar)
     updateTransform();
 }
 
+void Camera::setFar(float zFar)
+{
+    this->zFar = std::max(zFar, zNear);
+    p = perspective(fovy, aspect, zNear, zFar);
+    updateTransform();
+}
+
 void Camera::setCenter(glm::vec3 center)
 {
     this->center = center;
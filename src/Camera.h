@@ -1,6 +1,7 @@
 #ifndef CAMERA_H_
 #define CAMERA_H_
 
+#include <array>
 #include <glm/ext/matrix_float4x4.hpp>
 
 class Camera
@@ -12,12 +13,18 @@ public:
 
     glm::mat4 getTransform() const;
     glm::vec3 getEye() const;
+    // approximate height in pixels of a sphere projected to a viewport of the given height
+    float getProjectedSize(const glm::vec3 &center, float radius, float viewportHeight) const;
+    // world space planes (normal.xyz, distance.w) with the normals pointing inwards;
+    // a point p is inside if dot(plane.xyz, p) + plane.w >= 0 for all of them
+    std::array<glm::vec4, 6> getFrustumPlanes() const;
     void lookAt(glm::vec3 center, float r, float theta, float phi);
     void drag(float dx, float dy);
     void setAspect(float aspect);
     void setRadius(float radius);
     void addRadius(float dr);
     void addFar(float dzFar);
+    void setFar(float zFar);
     void setCenter(glm::vec3 center);
     void moveCenter(glm::vec3 dc);
 private:
@@ -47,8 +47,11 @@ void DescriptorPool::destroyPools()
 
 void DescriptorPool::reset()
 {
-    destroyPools();
-    pools.clear();
+    // the pools are kept, so that allocating after a reset does not create any
+    for (auto &pool : pools) {
+        VK_ASSERT(vkResetDescriptorPool(device, pool.pool, 0));
+        pool.allocatedSetCount = 0;
+    }
     currentPoolIndex = 0;
 }
 
@@ -77,6 +80,11 @@ const DescriptorSetLayout &DescriptorPool::getDescriptorSetLayout() const
     return layout;
 }
 
+uint32_t DescriptorPool::getPoolCount() const
+{
+    return static_cast<uint32_t>(pools.size());
+}
+
 DescriptorPool::PoolData &DescriptorPool::getPoolData()
 {
     if (pools.size() <= currentPoolIndex) {
@@ -17,9 +17,11 @@ public:
     DescriptorPool(DescriptorPool &&);
     ~DescriptorPool();
 
+    // frees all sets allocated from the pool at once, none of them may be in use anymore
     void reset();
     VkDescriptorSet allocate();
     const DescriptorSetLayout &getDescriptorSetLayout() const;
+    uint32_t getPoolCount() const;
 private:
     void destroyPools();
 
@@ -18,6 +18,14 @@ DescriptorSet::DescriptorSet(
     bufferBindingInfos(std::move(bufferBindingInfos)),
     imageBindingInfos(std::move(imageBindingInfos))
 {
+    for (const auto &imageInfo : this->imageBindingInfos) {
+        if (this->bufferBindingInfos.find(imageInfo.first) != this->bufferBindingInfos.end()) {
+            throw std::invalid_argument(fmt::format(
+                "attempting to update binding {} with an image info, but a buffer info for this binding index is also provided",
+                imageInfo.first
+            ));
+        }
+    }
 }
 
 DescriptorSet::DescriptorSet(DescriptorSet &&other)
@@ -25,7 +33,9 @@ DescriptorSet::DescriptorSet(DescriptorSet &&other)
     device(other.device),
     descriptorSet(other.descriptorSet),
     bufferBindingInfos(std::move(other.bufferBindingInfos)),
-    imageBindingInfos(std::move(other.imageBindingInfos))
+    imageBindingInfos(std::move(other.imageBindingInfos)),
+    allDirty(other.allDirty),
+    dirtyBindings(std::move(other.dirtyBindings))
 {
     other.descriptorSet = VK_NULL_HANDLE;
 }
@@ -41,52 +51,118 @@ VkDescriptorSet DescriptorSet::getHandle() const
     return descriptorSet;
 }
 
-void DescriptorSet::updateAll()
+const DescriptorSetLayout &DescriptorSet::getLayout() const
+{
+    return descriptorPool.getDescriptorSetLayout();
+}
+
+const std::map<uint32_t, VkDescriptorImageInfo> &DescriptorSet::getImageBindingInfos() const
+{
+    return imageBindingInfos;
+}
+
+void DescriptorSet::setBufferInfo(uint32_t binding, const VkDescriptorBufferInfo &info)
 {
-    for (const auto &bufferInfo : bufferBindingInfos) {
-        const auto &binding = descriptorPool.getDescriptorSetLayout().getBinding(bufferInfo.first);
-
-        VkWriteDescriptorSet descriptorWrite{};
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = descriptorSet;
-        descriptorWrite.dstBinding = bufferInfo.first;
-        descriptorWrite.dstArrayElement = 0;
-        descriptorWrite.descriptorType = binding.descriptorType;
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo.second;
-        descriptorWrite.pImageInfo = nullptr;
-
-        writes.push_back(descriptorWrite);
+    if (imageBindingInfos.find(binding) != imageBindingInfos.end()) {
+        throw std::invalid_argument(fmt::format("binding {} already has an image info", binding));
     }
+    auto i = bufferBindingInfos.find(binding);
+    // compared by field, the padding of the structs is indeterminate
+    if (i != bufferBindingInfos.end()
+        && i->second.buffer == info.buffer
+        && i->second.offset == info.offset
+        && i->second.range == info.range
+    ) {
+        return;
+    }
+    bufferBindingInfos[binding] = info;
+    dirtyBindings.insert(binding);
+}
 
-    for (const auto &imageInfo : imageBindingInfos) {
-        if (bufferBindingInfos.find(imageInfo.first) != bufferBindingInfos.end()) {
-            throw std::invalid_argument(fmt::format(
-                "attempting to update binding {} with an image info, but a buffer info for this binding index is also provided",
-                imageInfo.first
-            ));
-        }
+void DescriptorSet::setImageInfo(uint32_t binding, const VkDescriptorImageInfo &info)
+{
+    if (bufferBindingInfos.find(binding) != bufferBindingInfos.end()) {
+        throw std::invalid_argument(fmt::format("binding {} already has a buffer info", binding));
+    }
+    auto i = imageBindingInfos.find(binding);
+    if (i != imageBindingInfos.end()
+        && i->second.sampler == info.sampler
+        && i->second.imageView == info.imageView
+        && i->second.imageLayout == info.imageLayout
+    ) {
+        return;
+    }
+    imageBindingInfos[binding] = info;
+    dirtyBindings.insert(binding);
+}
 
-        const auto &binding = descriptorPool.getDescriptorSetLayout().getBinding(imageInfo.first);
+bool DescriptorSet::isDirty() const
+{
+    return allDirty || !dirtyBindings.empty();
+}
 
-        VkWriteDescriptorSet descriptorWrite{};
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = descriptorSet;
-        descriptorWrite.dstBinding = imageInfo.first;
-        descriptorWrite.dstArrayElement = 0;
-        descriptorWrite.descriptorType = binding.descriptorType;
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = nullptr;
-        descriptorWrite.pImageInfo = &imageInfo.second;
+bool DescriptorSet::canUpdateWithTemplate() const
+{
+    const DescriptorSetLayout &layout = getLayout();
+    return allDirty
+        && layout.getUpdateTemplate() != VK_NULL_HANDLE
+        && bufferBindingInfos.size() + imageBindingInfos.size() == layout.getBindings().size();
+}
 
-        writes.push_back(descriptorWrite);
+void DescriptorSet::getTemplateData(std::vector<DescriptorInfo> &data) const
+{
+    const auto &bindings = getLayout().getBindings();
+    data.resize(bindings.size());
+    for (size_t i = 0; i < bindings.size(); ++i) {
+        auto bufferInfo = bufferBindingInfos.find(bindings[i].binding);
+        if (bufferInfo != bufferBindingInfos.end()) {
+            data[i].buffer = bufferInfo->second;
+        }
+        else {
+            data[i].image = imageBindingInfos.at(bindings[i].binding);
+        }
     }
+}
 
-    vkUpdateDescriptorSets(
-        device, 
-        static_cast<uint32_t>(writes.size()),
-        writes.data(),
-        0,
-        nullptr
-    );
+void DescriptorSet::getWrites(std::vector<VkWriteDescriptorSet> &writes) const
+{
+    if (allDirty) {
+        for (const auto &bufferInfo : bufferBindingInfos) {
+            writes.push_back(createWrite(bufferInfo.first));
+        }
+        for (const auto &imageInfo : imageBindingInfos) {
+            writes.push_back(createWrite(imageInfo.first));
+        }
+    }
+    else {
+        for (uint32_t binding : dirtyBindings) {
+            writes.push_back(createWrite(binding));
+        }
+    }
+}
+
+void DescriptorSet::clearDirty()
+{
+    allDirty = false;
+    dirtyBindings.clear();
+}
+
+VkWriteDescriptorSet DescriptorSet::createWrite(uint32_t binding) const
+{
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = getLayout().getBinding(binding).descriptorType;
+    descriptorWrite.descriptorCount = 1;
+
+    auto bufferInfo = bufferBindingInfos.find(binding);
+    if (bufferInfo != bufferBindingInfos.end()) {
+        descriptorWrite.pBufferInfo = &bufferInfo->second;
+    }
+    else {
+        descriptorWrite.pImageInfo = &imageBindingInfos.at(binding);
+    }
+    return descriptorWrite;
 }
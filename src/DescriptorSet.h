@@ -1,16 +1,21 @@
 #ifndef DESCRIPTORSET_H_
 #define DESCRIPTORSET_H_
 
+#include "DescriptorSetLayout.h"
+
 #include <map>
+#include <set>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
 
 class DescriptorPool;
 
+// Written by a DescriptorUpdateBatch, which only writes the bindings changed since the last write
 class DescriptorSet
 {
 public:
+    // all bindings start out dirty
     DescriptorSet(
         VkDevice device,
         DescriptorPool &descriptorPool, 
@@ -22,12 +27,27 @@ public:
     ~DescriptorSet();
 
     VkDescriptorSet getHandle() const;
-    void updateAll();
+    const DescriptorSetLayout &getLayout() const;
+    const std::map<uint32_t, VkDescriptorImageInfo> &getImageBindingInfos() const;
+    // the binding only becomes dirty if the info differs from the current one
+    void setBufferInfo(uint32_t binding, const VkDescriptorBufferInfo &info);
+    void setImageInfo(uint32_t binding, const VkDescriptorImageInfo &info);
+    bool isDirty() const;
+    // true if every binding is dirty and has an info, so that the layout's update template can write the set
+    bool canUpdateWithTemplate() const;
+    // one element per binding of the layout, see DescriptorInfo
+    void getTemplateData(std::vector<DescriptorInfo> &data) const;
+    // appends writes of the dirty bindings, which refer to this set's infos until they change
+    void getWrites(std::vector<VkWriteDescriptorSet> &writes) const;
+    void clearDirty();
 private:
+    VkWriteDescriptorSet createWrite(uint32_t binding) const;
+
     VkDescriptorSet descriptorSet;
     std::map<uint32_t, VkDescriptorBufferInfo> bufferBindingInfos;
     std::map<uint32_t, VkDescriptorImageInfo> imageBindingInfos;
-    std::vector<VkWriteDescriptorSet> writes;
+    bool allDirty = true;
+    std::set<uint32_t> dirtyBindings;
 
     DescriptorPool &descriptorPool;
     VkDevice device;
@@ -6,11 +6,17 @@
 #include <utility>
 #include <vulkan/vulkan_core.h>
 
-DescriptorSetLayout::DescriptorSetLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+DescriptorSetLayout::DescriptorSetLayout(
+    VkDevice device,
+    const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+    VkDescriptorSetLayoutCreateFlags flags,
+    const DeviceFunctions &functions
+)
     : device(device), bindings(bindings)
 {
     VkDescriptorSetLayoutCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	createInfo.flags = flags;
 	createInfo.bindingCount = static_cast<uint32_t>(this->bindings.size());
 	createInfo.pBindings = this->bindings.data();
 
@@ -24,19 +30,34 @@ DescriptorSetLayout::DescriptorSetLayout(VkDevice device, const std::vector<VkDe
         nullptr, 
         &descriptorSetLayout
     ));
+
+    // push descriptor layouts would need templates of the push descriptor type, which are bound to a pipeline layout;
+    // empty layouts have nothing to write
+    if (functions.hasDescriptorUpdateTemplates()
+        && !(flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)
+        && !this->bindings.empty()
+    ) {
+        createUpdateTemplate(functions);
+    }
 }
 
 DescriptorSetLayout::DescriptorSetLayout(DescriptorSetLayout &&other)
     : device(other.device),
     descriptorSetLayout(other.descriptorSetLayout),
+    updateTemplate(other.updateTemplate),
+    destroyUpdateTemplate(other.destroyUpdateTemplate),
     bindings(std::move(other.bindings)),
     bindingsKeyedByIndex(std::move(other.bindingsKeyedByIndex))
 {
     other.descriptorSetLayout = VK_NULL_HANDLE;
+    other.updateTemplate = VK_NULL_HANDLE;
 }
 
 DescriptorSetLayout::~DescriptorSetLayout()
 {
+    if (updateTemplate != VK_NULL_HANDLE) {
+        destroyUpdateTemplate(device, updateTemplate, nullptr);
+    }
     if (descriptorSetLayout != VK_NULL_HANDLE) {
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
     }
@@ -63,3 +84,45 @@ const VkDescriptorSetLayoutBinding &DescriptorSetLayout::getBinding(uint32_t bin
 
     return it->second;
 }
+
+VkDescriptorUpdateTemplate DescriptorSetLayout::getUpdateTemplate() const
+{
+    return updateTemplate;
+}
+
+void DescriptorSetLayout::createUpdateTemplate(const DeviceFunctions &functions)
+{
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    for (size_t i = 0; i < bindings.size(); ++i) {
+        switch (bindings[i].descriptorType) {
+            case VK_DESCRIPTOR_TYPE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+                break;
+            default:
+                // texel buffers and others do not fit DescriptorInfo, such layouts are written without template
+                return;
+        }
+        entries.push_back(VkDescriptorUpdateTemplateEntry{
+            .dstBinding = bindings[i].binding,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = bindings[i].descriptorType,
+            .offset = i * sizeof(DescriptorInfo),
+            .stride = sizeof(DescriptorInfo),
+        });
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    createInfo.pDescriptorUpdateEntries = entries.data();
+    createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    createInfo.descriptorSetLayout = descriptorSetLayout;
+
+    VK_ASSERT(functions.createDescriptorUpdateTemplate(device, &createInfo, nullptr, &updateTemplate));
+    destroyUpdateTemplate = functions.destroyDescriptorUpdateTemplate;
+}
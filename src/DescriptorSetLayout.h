@@ -1,14 +1,29 @@
 #ifndef DESCRIPTORSETLAYOUT_H_
 #define DESCRIPTORSETLAYOUT_H_
 
+#include "DeviceFunctions.h"
+
 #include <map>
 #include <vulkan/vulkan_core.h>
 #include <vector>
 
+// data read by an update template, one element per binding in the order of DescriptorSetLayout::getBindings()
+union DescriptorInfo
+{
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
+};
+
 class DescriptorSetLayout
 {
 public:
-    DescriptorSetLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+    // an update template is created if the functions provide it and the layout is not for push descriptors
+    DescriptorSetLayout(
+        VkDevice device,
+        const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+        VkDescriptorSetLayoutCreateFlags flags = 0,
+        const DeviceFunctions &functions = {}
+    );
     DescriptorSetLayout(const DescriptorSetLayout &) = delete;
     DescriptorSetLayout(DescriptorSetLayout &&);
     ~DescriptorSetLayout();
@@ -16,8 +31,14 @@ public:
     VkDescriptorSetLayout getHandle() const;
     const std::vector<VkDescriptorSetLayoutBinding> &getBindings() const;
     const VkDescriptorSetLayoutBinding &getBinding(uint32_t bindingIndex) const;
+    // writes one descriptor per binding from an array of DescriptorInfo, VK_NULL_HANDLE if not available
+    VkDescriptorUpdateTemplate getUpdateTemplate() const;
 private:
+    void createUpdateTemplate(const DeviceFunctions &functions);
+
     VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR destroyUpdateTemplate = nullptr;
     std::vector<VkDescriptorSetLayoutBinding> bindings;
     std::map<uint32_t, VkDescriptorSetLayoutBinding> bindingsKeyedByIndex;
 
@@ -0,0 +1,48 @@
+#include "DescriptorUpdateBatch.h"
+#include "DescriptorSet.h"
+
+#include <algorithm>
+
+DescriptorUpdateBatch::DescriptorUpdateBatch(VkDevice device, const DeviceFunctions &functions)
+    : device(device),
+    functions(&functions)
+{
+}
+
+void DescriptorUpdateBatch::add(DescriptorSet &set)
+{
+    if (set.isDirty() && std::find(sets.begin(), sets.end(), &set) == sets.end()) {
+        sets.push_back(&set);
+    }
+}
+
+void DescriptorUpdateBatch::flush()
+{
+    if (sets.empty()) {
+        return;
+    }
+
+    writes.clear();
+    for (DescriptorSet *set : sets) {
+        if (set->canUpdateWithTemplate()) {
+            set->getTemplateData(templateData);
+            functions->updateDescriptorSetWithTemplate(
+                device,
+                set->getHandle(),
+                set->getLayout().getUpdateTemplate(),
+                templateData.data()
+            );
+        }
+        else {
+            set->getWrites(writes);
+        }
+    }
+    if (!writes.empty()) {
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    for (DescriptorSet *set : sets) {
+        set->clearDirty();
+    }
+    sets.clear();
+}
@@ -0,0 +1,36 @@
+#ifndef DESCRIPTORUPDATEBATCH_H_
+#define DESCRIPTORUPDATEBATCH_H_
+
+#include "DescriptorSetLayout.h"
+#include "DeviceFunctions.h"
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class DescriptorSet;
+
+// Collects dirty descriptor sets and writes their dirty bindings with a single vkUpdateDescriptorSets call.
+// Sets written completely use their layout's update template instead, if there is one.
+class DescriptorUpdateBatch
+{
+public:
+    DescriptorUpdateBatch(VkDevice device, const DeviceFunctions &functions);
+    DescriptorUpdateBatch(const DescriptorUpdateBatch &) = delete;
+    DescriptorUpdateBatch(DescriptorUpdateBatch &&) = default;
+    ~DescriptorUpdateBatch() = default;
+
+    // sets without dirty bindings are ignored, the set must stay alive until the next flush
+    void add(DescriptorSet &set);
+    // none of the sets may be bound in a command buffer that is being recorded
+    void flush();
+private:
+    VkDevice device;
+    const DeviceFunctions *functions;
+    std::vector<DescriptorSet *> sets;
+    // kept to reuse their memory
+    std::vector<VkWriteDescriptorSet> writes;
+    std::vector<DescriptorInfo> templateData;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "DeviceAllocator.h"
 #include "VkHelpers.h"
 #include "Instance.h"
+#include "PipelineCache.h"
 #include "VulkanObjectCache.h"
 
 #include <GLFW/glfw3.h>
@@ -17,15 +18,20 @@
 Device::Device(
 	Instance &instance, 
 	VkSurfaceKHR surface,
-	std::vector<const char *> extensionsToEnable
+	std::vector<const char *> extensionsToEnable,
+	std::vector<const char *> optionalExtensions
 )
     : instance(instance),
     surface(surface),
 	extensionsToEnable(extensionsToEnable),
+	optionalExtensions(optionalExtensions),
 	selectedQueueFamilyIndices{},
 	graphicsQueue(VK_NULL_HANDLE),
 	presentQueue(VK_NULL_HANDLE),
 	physicalDevice(chooseSuitablePhysicalDevice()),
+	properties{},
+	enabledFeatures{},
+	functions{},
 	device(createLogicalDevice()),
 	transferCommandPool(createTransferCommandPool()),
 	allocator(std::make_unique<DeviceAllocator>(
@@ -35,6 +41,7 @@ Device::Device(
 		transferCommandPool,
 		graphicsQueue)
 	),
+	pipelineCache(std::make_unique<PipelineCache>(device, properties, PipelineCache::DEFAULT_PATH)),
 	objectCache(std::make_unique<VulkanObjectCache>(*this))
 {
 }
@@ -42,6 +49,7 @@ Device::Device(
 Device::~Device()
 {
 	objectCache.reset();
+	pipelineCache.reset();
 	vkDestroyCommandPool(device, transferCommandPool, nullptr);
 	allocator.reset();
 	
@@ -59,6 +67,11 @@ DeviceAllocator &Device::getAllocator()
 	return *allocator;
 }
 
+PipelineCache &Device::getPipelineCache()
+{
+	return *pipelineCache;
+}
+
 
 VkInstance Device::getInstanceHandle()
 {
@@ -90,6 +103,31 @@ const QueueFamilyIndices &Device::getQueueFamilyIndices() const
     return selectedQueueFamilyIndices;
 }
 
+const VkPhysicalDeviceProperties &Device::getProperties() const
+{
+	return properties;
+}
+
+const VkPhysicalDeviceFeatures &Device::getEnabledFeatures() const
+{
+	return enabledFeatures;
+}
+
+bool Device::isExtensionEnabled(const char *name) const
+{
+	for (const char *extension : extensionsToEnable) {
+		if (!strcmp(extension, name)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const DeviceFunctions &Device::getFunctions() const
+{
+	return functions;
+}
+
 void Device::waitDeviceIdle()
 {
     vkDeviceWaitIdle(device);
@@ -259,14 +297,32 @@ VkDevice Device::createLogicalDevice()
 	}
 
 
-	VkPhysicalDeviceFeatures deviceFeatures{};
-	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	enabledFeatures.samplerAnisotropy = VK_TRUE;
+	// lets culled meshlets be drawn with one indirect call per object
+	enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	for (const char *optionalExtension : optionalExtensions) {
+		for (const auto &availableExtension : availableExtensions) {
+			if (!strcmp(optionalExtension, availableExtension.extensionName)) {
+				extensionsToEnable.push_back(optionalExtension);
+				break;
+			}
+		}
+	}
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = queueCreateInfos.size();
-	createInfo.pEnabledFeatures = &deviceFeatures;
+	createInfo.pEnabledFeatures = &enabledFeatures;
 	createInfo.enabledLayerCount = 0;
 	createInfo.ppEnabledExtensionNames = extensionsToEnable.data();
 	createInfo.enabledExtensionCount = extensionsToEnable.size();
@@ -290,11 +346,32 @@ VkDevice Device::createLogicalDevice()
 
 	vkGetDeviceQueue(device, selectedQueueFamilyIndices.graphics.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, selectedQueueFamilyIndices.present.value(), 0, &presentQueue);
+	loadFunctions(device);
 
 	spdlog::info("logical device created.");
 	return device;
 }
 
+void Device::loadFunctions(VkDevice device)
+{
+	if (isExtensionEnabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+		functions.createDescriptorUpdateTemplate = reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplateKHR>(
+			vkGetDeviceProcAddr(device, "vkCreateDescriptorUpdateTemplateKHR")
+		);
+		functions.destroyDescriptorUpdateTemplate = reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplateKHR>(
+			vkGetDeviceProcAddr(device, "vkDestroyDescriptorUpdateTemplateKHR")
+		);
+		functions.updateDescriptorSetWithTemplate = reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplateKHR>(
+			vkGetDeviceProcAddr(device, "vkUpdateDescriptorSetWithTemplateKHR")
+		);
+	}
+	if (isExtensionEnabled(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+		functions.cmdPushDescriptorSet = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+			vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR")
+		);
+	}
+}
+
 VkCommandPool Device::createTransferCommandPool()
 {
 	spdlog::info("creating transfer command pool...");
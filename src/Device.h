@@ -2,6 +2,8 @@
 #define DEVICE_H_
 
 #include "DeviceAllocator.h"
+#include "DeviceFunctions.h"
+#include "PipelineCache.h"
 #include "SwapChain.h"
 #include "VulkanObjectCache.h"
 
@@ -31,7 +33,9 @@ public:
     Device(
         Instance &instance, 
         VkSurfaceKHR surface, 
-        std::vector<const char *> extensionsToEnable = {}
+        std::vector<const char *> extensionsToEnable = {},
+        // enabled only if the physical device supports them
+        std::vector<const char *> optionalExtensions = {}
     );
     Device(const Device &) = delete;
     Device(Device &&) = delete;
@@ -39,6 +43,7 @@ public:
 
     VulkanObjectCache &getObjectCache();
     DeviceAllocator &getAllocator();
+    PipelineCache &getPipelineCache();
 
     VkInstance getInstanceHandle();
     VkPhysicalDevice getPhysicalDeviceHandle();
@@ -46,6 +51,11 @@ public:
     VkQueue getGraphicsQueue();
     VkQueue getPresentQueue();
     const QueueFamilyIndices &getQueueFamilyIndices() const;
+    const VkPhysicalDeviceProperties &getProperties() const;
+    // optional features are only enabled if the physical device supports them
+    const VkPhysicalDeviceFeatures &getEnabledFeatures() const;
+    bool isExtensionEnabled(const char *name) const;
+    const DeviceFunctions &getFunctions() const;
 
     void waitDeviceIdle();
 private:
@@ -62,18 +72,24 @@ private:
     bool checkDeviceRequiredExtensionsSupport(VkPhysicalDevice device);
     QueueFamilyIndices findNeededQueueFamilyIndices(VkPhysicalDevice device);
     VkDevice createLogicalDevice();
+    void loadFunctions(VkDevice device);
     VkCommandPool createTransferCommandPool();
 
     Instance &instance;
     VkSurfaceKHR surface;
     std::vector<const char *> extensionsToEnable;
+    std::vector<const char *> optionalExtensions;
     QueueFamilyIndices selectedQueueFamilyIndices;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
     VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceFeatures enabledFeatures;
+    DeviceFunctions functions;
     VkDevice device;
     VkCommandPool transferCommandPool;
     std::unique_ptr<DeviceAllocator> allocator;
+    std::unique_ptr<PipelineCache> pipelineCache;
     std::unique_ptr<VulkanObjectCache> objectCache;
 };
 
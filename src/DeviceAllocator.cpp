@@ -1,4 +1,5 @@
 #include "DeviceAllocator.h"
+#include "StartupProfiler.h"
 #include "VkHelpers.h"
 #include <cstddef>
 #include <cstdint>
@@ -58,6 +59,7 @@ std::pair<VkBuffer, VmaAllocation> DeviceAllocator::allocateDeviceLocalBufferAnd
     size_t size, 
     VkBufferUsageFlags usage
 ) {
+    StartupProfiler::Scope scope("upload buffer", fmt::format("{} bytes", size));
     auto destinationBuf = allocateBuffer(
         size, 
         usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
@@ -131,6 +133,7 @@ std::pair<VkImage, VmaAllocation> DeviceAllocator::allocateDeviceLocalImageAndTr
     VkFormat format,
     VkImageUsageFlags usage
 ) {
+    StartupProfiler::Scope scope("upload image", fmt::format("{}x{}", width, height));
     auto destinationImage = allocateImageAsTransferDst(
         width,
         height, 
@@ -170,6 +173,13 @@ void DeviceAllocator::free(std::pair<VkImage, VmaAllocation> allocation)
     vmaDestroyImage(allocator, allocation.first, allocation.second);
 }
 
+VkDeviceSize DeviceAllocator::getAllocationSize(VmaAllocation allocation) const
+{
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(allocator, allocation, &info);
+    return info.size;
+}
+
 
 void DeviceAllocator::withThrowawayCommandBuffer(std::function<void (VkCommandBuffer)> recorder)
 {
@@ -47,6 +47,7 @@ public:
     );
     void free(std::pair<VkBuffer, VmaAllocation> allocation);
     void free(std::pair<VkImage, VmaAllocation> allocation);
+    VkDeviceSize getAllocationSize(VmaAllocation allocation) const;
 private:
     void withThrowawayCommandBuffer(std::function<void (VkCommandBuffer)> recorder);
     std::pair<VkBuffer, VmaAllocation> allocateBuffer(
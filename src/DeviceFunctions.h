@@ -0,0 +1,27 @@
+#ifndef DEVICEFUNCTIONS_H_
+#define DEVICEFUNCTIONS_H_
+
+#include <vulkan/vulkan_core.h>
+
+// entry points of optional device extensions, null if the extension is not enabled
+struct DeviceFunctions
+{
+    // VK_KHR_descriptor_update_template
+    PFN_vkCreateDescriptorUpdateTemplateKHR createDescriptorUpdateTemplate = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR destroyDescriptorUpdateTemplate = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR updateDescriptorSetWithTemplate = nullptr;
+    // VK_KHR_push_descriptor
+    PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet = nullptr;
+
+    bool hasDescriptorUpdateTemplates() const
+    {
+        return updateDescriptorSetWithTemplate != nullptr;
+    }
+
+    bool hasPushDescriptors() const
+    {
+        return cmdPushDescriptorSet != nullptr;
+    }
+};
+
+#endif
@@ -5,27 +5,24 @@
 #include "VkHash.h"
 #include "VkHelpers.h"
 
+#include <algorithm>
+#include <iterator>
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/spdlog.h>
 #include <utility>
 #include <vulkan/vulkan_core.h>
 
-Frame::Frame(Device &device, uint32_t renderQueueFamilyIndex)
+Frame::Frame(
+    Device &device,
+    uint32_t renderQueueFamilyIndex,
+    const VkDescriptorBufferInfo &objectBufferInfo,
+    const VkDescriptorBufferInfo &materialBufferInfo
+)
     : device(device),
     globalUniformBuffer(createGlobalUniformBuffer()),
-    globalUniformDataDescriptorSet(getDescriptorSet(
-        0, 
-        device.getObjectCache().getDescriptorSetLayout(RenderObject::getGlobalUniformDataLayoutBindings()), 
-        std::map<uint32_t, VkDescriptorBufferInfo>{std::make_pair(
-            0,
-            VkDescriptorBufferInfo{
-                .buffer = globalUniformBuffer.getHandle(),
-                .offset = 0,
-                .range = VK_WHOLE_SIZE,
-            }
-        )}, 
-        {})
-    )
+    descriptorUpdates(device.getDeviceHandle(), device.getFunctions()),
+    objectBufferInfo(objectBufferInfo),
+    materialBufferInfo(materialBufferInfo)
 {
 	VkCommandPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -81,10 +78,18 @@ Frame::Frame(Frame &&other)
     fence(other.fence),
     imageAvailableSemaphore(other.imageAvailableSemaphore),
     renderFinishedSemaphore(other.renderFinishedSemaphore),
+    submittedFrame(other.submittedFrame),
     globalUniformBuffer(std::move(other.globalUniformBuffer)),
+    indirectCommandBuffer(std::move(other.indirectCommandBuffer)),
     descriptorPools(std::move(other.descriptorPools)),
-    descriptorSets(std::move(other.descriptorSets)),
-    globalUniformDataDescriptorSet(other.globalUniformDataDescriptorSet)
+    descriptorUpdates(std::move(other.descriptorUpdates)),
+    objectBufferInfo(other.objectBufferInfo),
+    materialBufferInfo(other.materialBufferInfo),
+    globalUniformDataDescriptorSet(other.globalUniformDataDescriptorSet),
+    transientDescriptorPools(std::move(other.transientDescriptorPools)),
+    transientDescriptorSets(std::move(other.transientDescriptorSets)),
+    transientDescriptorStatistics(other.transientDescriptorStatistics),
+    materialDescriptorSets(std::move(other.materialDescriptorSets))
 {
     other.commandPool = VK_NULL_HANDLE;
     other.commandBuffer = VK_NULL_HANDLE;
@@ -95,16 +100,15 @@ Frame::Frame(Frame &&other)
 
 Frame::~Frame()
 {
-    for (auto &map : descriptorSets) {
-        for (auto &i : map.second) {
-            i.second.reset();
-        }
-    }
+    transientDescriptorSets.clear();
+    transientDescriptorPools.clear();
+    materialDescriptorSets.clear();
     for (auto &map : descriptorPools) {
         for (auto &i : map.second) {
             i.second.reset();
         }
     }
+    indirectCommandBuffer.reset();
     vkDestroyFence(device.getDeviceHandle(), fence, nullptr);
     vkDestroySemaphore(device.getDeviceHandle(), renderFinishedSemaphore, nullptr);
     vkDestroySemaphore(device.getDeviceHandle(), imageAvailableSemaphore, nullptr);
@@ -131,6 +135,16 @@ const VkSemaphore &Frame::getRenderFinishedSemaphore() const
     return renderFinishedSemaphore;
 }
 
+uint64_t Frame::getSubmittedFrame() const
+{
+    return submittedFrame;
+}
+
+void Frame::setSubmittedFrame(uint64_t frame)
+{
+    submittedFrame = frame;
+}
+
 DescriptorPool &Frame::getDescriptorPool(uint32_t concurrencyIndex, const DescriptorSetLayout &layout)
 {
     size_t hash = Utility::hash_value(layout);
@@ -150,55 +164,121 @@ DescriptorPool &Frame::getDescriptorPool(uint32_t concurrencyIndex, const Descri
     return ret;
 }
 
-DescriptorSet &Frame::getDescriptorSet(
-    uint32_t concurrencyIndex,
-    const DescriptorSetLayout &layout, 
-    const std::map<uint32_t, VkDescriptorBufferInfo> &bufferBindingInfos, 
-    const std::map<uint32_t, VkDescriptorImageInfo> &imageBindingInfos
-)
+
+DescriptorSet &Frame::getGlobalUniformDataDescriptorSet()
 {
-    size_t hash = Utility::hash_value(layout);
-    for (auto &i : bufferBindingInfos) {
-        Utility::hash_combine(hash, i.second);
-    }
-    for (auto &i : imageBindingInfos) {
-        Utility::hash_combine(hash, i.second);
+    if (!globalUniformDataDescriptorSet) {
+        globalUniformDataDescriptorSet = &allocateTransientDescriptorSet(
+            device.getObjectCache().getDescriptorSetLayout(RenderObject::getGlobalUniformDataLayoutBindings()),
+            std::map<uint32_t, VkDescriptorBufferInfo>{
+                std::make_pair(0, VkDescriptorBufferInfo{
+                    .buffer = globalUniformBuffer.getHandle(),
+                    .offset = 0,
+                    .range = VK_WHOLE_SIZE,
+                }),
+                std::make_pair(1, objectBufferInfo),
+                std::make_pair(2, materialBufferInfo),
+            },
+            {}
+        );
+        // requested while recording, so it cannot wait for the next flush
+        descriptorUpdates.flush();
     }
+    return *globalUniformDataDescriptorSet;
+}
 
-    auto &descriptorSetMap = descriptorSets[concurrencyIndex];
+DescriptorSet &Frame::getMaterialDescriptorSet(const Material &material)
+{
+    uint32_t id = material.getId();
+    if (id < materialDescriptorSets.size() && materialDescriptorSets[id]) {
+        return *materialDescriptorSets[id];
+    }
+    DescriptorSet &set = createMaterialDescriptorSet(material);
+    descriptorUpdates.flush();
+    return set;
+}
 
-    auto i = descriptorSetMap.find(hash);
-    if (i != descriptorSetMap.end()) {
-        return *i->second;
+void Frame::updateMaterialDescriptorSet(const Material &material)
+{
+    uint32_t id = material.getId();
+    if (id >= materialDescriptorSets.size() || !materialDescriptorSets[id]) {
+        createMaterialDescriptorSet(material);
+        return;
+    }
+    DescriptorSet &set = *materialDescriptorSets[id];
+    for (const auto &imageInfo : material.getDescriptorImageInfos()) {
+        set.setImageInfo(imageInfo.first, imageInfo.second);
     }
-    DescriptorPool &pool = getDescriptorPool(concurrencyIndex, layout);
+    descriptorUpdates.add(set);
+}
 
-    auto &ret = *descriptorSetMap.emplace(
-        hash,
-        std::make_unique<DescriptorSet>(
-            device.getDeviceHandle(), 
-            pool, bufferBindingInfos, 
-            imageBindingInfos
-        )
-    ).first->second;
-    spdlog::info("Frame: created descriptor set at {}", (void*) &ret);
-    return ret;
+void Frame::setObjectBuffer(const VkDescriptorBufferInfo &objectBufferInfo)
+{
+    this->objectBufferInfo = objectBufferInfo;
+    globalUniformDataDescriptorSet = nullptr;
 }
 
+void Frame::setMaterialBuffer(const VkDescriptorBufferInfo &materialBufferInfo)
+{
+    this->materialBufferInfo = materialBufferInfo;
+    globalUniformDataDescriptorSet = nullptr;
+}
 
-DescriptorSet &Frame::getGlobalUniformDataDescriptorSet()
+DescriptorSet &Frame::allocateTransientDescriptorSet(
+    const DescriptorSetLayout &layout,
+    const std::map<uint32_t, VkDescriptorBufferInfo> &bufferBindingInfos,
+    const std::map<uint32_t, VkDescriptorImageInfo> &imageBindingInfos
+)
 {
-    return globalUniformDataDescriptorSet;
+    size_t hash = Utility::hash_value(layout);
+    auto poolIter = transientDescriptorPools.find(hash);
+    if (poolIter == transientDescriptorPools.end()) {
+        poolIter = transientDescriptorPools.emplace(
+            hash,
+            std::make_unique<DescriptorPool>(device.getDeviceHandle(), layout, 64)
+        ).first;
+    }
+    DescriptorPool &pool = *poolIter->second;
+    uint32_t poolCount = pool.getPoolCount();
+
+    DescriptorSet &set = transientDescriptorSets.emplace_back(
+        device.getDeviceHandle(),
+        pool,
+        bufferBindingInfos,
+        imageBindingInfos
+    );
+    descriptorUpdates.add(set);
+
+    transientDescriptorStatistics.poolCount += pool.getPoolCount() - poolCount;
+    ++transientDescriptorStatistics.allocatedSets;
+    transientDescriptorStatistics.peakAllocatedSets = std::max(
+        transientDescriptorStatistics.peakAllocatedSets,
+        transientDescriptorStatistics.allocatedSets
+    );
+    return set;
 }
 
-void Frame::updateDescriptorSets(uint32_t concurrencyIndex)
+void Frame::resetTransientDescriptorSets()
 {
-    auto map = descriptorSets.find(concurrencyIndex);
-    if (map != descriptorSets.end()) {
-        for (auto &set : map->second) {
-            set.second->updateAll();
-        }
+    // pending updates may refer to transient sets
+    descriptorUpdates.flush();
+    globalUniformDataDescriptorSet = nullptr;
+    transientDescriptorSets.clear();
+    for (auto &pool : transientDescriptorPools) {
+        pool.second->reset();
     }
+    transientDescriptorStatistics.allocatedSets = 0;
+    ++transientDescriptorStatistics.resetCount;
+}
+
+const Frame::TransientDescriptorStatistics &Frame::getTransientDescriptorStatistics() const
+{
+    return transientDescriptorStatistics;
+}
+
+void Frame::flushDescriptorUpdates()
+{
+    descriptorUpdates.flush();
 }
 
 void Frame::updateGlobalUniformBuffer(const GlobalUniformData &data)
@@ -216,6 +296,26 @@ VkBuffer Frame::getGlobalUniformBufferHandle()
     return globalUniformBuffer.getHandle();
 }
 
+MappedBuffer &Frame::getIndirectCommandBuffer(size_t commandCount)
+{
+    size_t size = commandCount * sizeof(VkDrawIndexedIndirectCommand);
+    if (!indirectCommandBuffer || indirectCommandBuffer->getSize() < size) {
+        // the frame's fence has been waited on, so the old buffer is no longer in use
+        size_t newSize = std::max<size_t>(size, 1024 * sizeof(VkDrawIndexedIndirectCommand));
+        if (indirectCommandBuffer) {
+            newSize = std::max(newSize, indirectCommandBuffer->getSize() * 2);
+        }
+        indirectCommandBuffer.reset();
+        indirectCommandBuffer = std::make_unique<MappedBuffer>(
+            device.getAllocator(),
+            newSize,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+        );
+        spdlog::info("Frame: indirect command buffer resized to {} bytes", newSize);
+    }
+    return *indirectCommandBuffer;
+}
+
 
 MappedBuffer Frame::createGlobalUniformBuffer()
 {
@@ -225,3 +325,22 @@ MappedBuffer Frame::createGlobalUniformBuffer()
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
     );
 }
+
+DescriptorSet &Frame::createMaterialDescriptorSet(const Material &material)
+{
+    if (materialDescriptorSets.size() <= material.getId()) {
+        materialDescriptorSets.resize(material.getId() + 1);
+    }
+    auto &set = materialDescriptorSets[material.getId()];
+    set = std::make_unique<DescriptorSet>(
+        device.getDeviceHandle(),
+        getDescriptorPool(
+            0,
+            device.getObjectCache().getDescriptorSetLayout(material.getDescriptorSetLayoutBindings())
+        ),
+        std::map<uint32_t, VkDescriptorBufferInfo>{},
+        material.getDescriptorImageInfos()
+    );
+    descriptorUpdates.add(*set);
+    return *set;
+}
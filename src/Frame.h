@@ -3,11 +3,13 @@
 
 #include "DescriptorSet.h"
 #include "DescriptorPool.h"
+#include "DescriptorUpdateBatch.h"
 #include "Material.h"
 #include "MappedBuffer.h"
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
+#include <deque>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -19,7 +21,24 @@ struct GlobalUniformData;
 class Frame
 {
 public:
-    Frame(Device &device, uint32_t renderQueueFamilyIndex);
+    struct TransientDescriptorStatistics
+    {
+        // sets allocated since the last reset
+        uint32_t allocatedSets = 0;
+        uint32_t peakAllocatedSets = 0;
+        // VkDescriptorPools backing the transient sets, kept across resets
+        uint32_t poolCount = 0;
+        uint64_t resetCount = 0;
+    };
+
+    // objectBufferInfo: this frame's copy of the ObjectBuffer, materialBufferInfo: the MaterialBuffer,
+    // both bound next to the global uniform data
+    Frame(
+        Device &device,
+        uint32_t renderQueueFamilyIndex,
+        const VkDescriptorBufferInfo &objectBufferInfo,
+        const VkDescriptorBufferInfo &materialBufferInfo
+    );
     Frame(const Frame &) = delete;
     Frame(Frame &&);
     ~Frame();
@@ -28,20 +47,41 @@ public:
     const VkFence &getFence() const;
     const VkSemaphore &getImageAvailableSemaphore() const;
     const VkSemaphore &getRenderFinishedSemaphore() const;
+    // number of the frame last submitted with this frame's fence, 0 if there was none
+    uint64_t getSubmittedFrame() const;
+    void setSubmittedFrame(uint64_t frame);
     DescriptorPool &getDescriptorPool(uint32_t concurrencyIndex, const DescriptorSetLayout &layout);
-    DescriptorSet &getDescriptorSet(
-        uint32_t concurrencyIndex,
-        const DescriptorSetLayout &layout, 
-        const std::map<uint32_t, VkDescriptorBufferInfo> &bufferBindingInfos, 
+    // allocated transiently, once per use of the frame
+    DescriptorSet &getGlobalUniformDataDescriptorSet();
+    // looked up in a table indexed by material id, the set is created and written on first use
+    DescriptorSet &getMaterialDescriptorSet(const Material &material);
+    // takes over the material's current image infos, only the bindings that changed
+    // are written by the next flushDescriptorUpdates()
+    void updateMaterialDescriptorSet(const Material &material);
+    // switches to another copy of the ObjectBuffer after it was recreated
+    void setObjectBuffer(const VkDescriptorBufferInfo &objectBufferInfo);
+    // switches to the MaterialBuffer's buffer after it was recreated
+    void setMaterialBuffer(const VkDescriptorBufferInfo &materialBufferInfo);
+    // allocated from pools that are reset as a whole, the set is written by the next flushDescriptorUpdates()
+    // and valid until the next reset
+    DescriptorSet &allocateTransientDescriptorSet(
+        const DescriptorSetLayout &layout,
+        const std::map<uint32_t, VkDescriptorBufferInfo> &bufferBindingInfos,
         const std::map<uint32_t, VkDescriptorImageInfo> &imageBindingInfos
     );
-    DescriptorSet &getGlobalUniformDataDescriptorSet();
-    void updateDescriptorSets(uint32_t concurrencyIndex);
+    // frees all transient sets, the frame's fence must have been waited on
+    void resetTransientDescriptorSets();
+    const TransientDescriptorStatistics &getTransientDescriptorStatistics() const;
+    // writes all pending descriptor updates at once, none of the sets may be bound in a recording command buffer
+    void flushDescriptorUpdates();
     void updateGlobalUniformBuffer(const GlobalUniformData &data);
     GlobalUniformData &getGlobalUniformData();
     VkBuffer getGlobalUniformBufferHandle();
+    // host visible buffer for indirect draws recorded this frame, grown to hold at least commandCount
+    MappedBuffer &getIndirectCommandBuffer(size_t commandCount);
 private:
     MappedBuffer createGlobalUniformBuffer();
+    DescriptorSet &createMaterialDescriptorSet(const Material &material);
 
     Device &device;
 
@@ -50,11 +90,22 @@ private:
     VkFence fence = VK_NULL_HANDLE;
     VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
     VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    uint64_t submittedFrame = 0;
     MappedBuffer globalUniformBuffer;
+    std::unique_ptr<MappedBuffer> indirectCommandBuffer;
 
     std::unordered_map<size_t, std::unordered_map<size_t, std::unique_ptr<DescriptorPool>>> descriptorPools;
-    std::unordered_map<size_t, std::unordered_map<size_t, std::unique_ptr<DescriptorSet>>> descriptorSets;
-    DescriptorSet &globalUniformDataDescriptorSet;
+    DescriptorUpdateBatch descriptorUpdates;
+    VkDescriptorBufferInfo objectBufferInfo;
+    VkDescriptorBufferInfo materialBufferInfo;
+    // a transient set, null until first requested after a reset
+    DescriptorSet *globalUniformDataDescriptorSet = nullptr;
+    // keyed by layout hash
+    std::unordered_map<size_t, std::unique_ptr<DescriptorPool>> transientDescriptorPools;
+    std::deque<DescriptorSet> transientDescriptorSets;
+    TransientDescriptorStatistics transientDescriptorStatistics;
+    // indexed by material id, null where not created yet
+    std::vector<std::unique_ptr<DescriptorSet>> materialDescriptorSets;
 };
 
 #endif
@@ -3,9 +3,13 @@
 #include "DescriptorSetLayout.h"
 #include "DescriptorSet.h"
 #include "Material.h"
+#include "PipelineCache.h"
 #include "RenderObject.h"
 #include "Vertex.h"
 #include "RenderPass.h"
+#include "ShaderLayout.h"
+#include "ShaderLayouts.h"
+#include "StartupProfiler.h"
 #include "VkHelpers.h"
 
 #include <cstddef>
@@ -20,19 +24,112 @@
 #include <vulkan/vk_enum_string_helper.h>
 #include <vulkan/vulkan_core.h>
 
+namespace
+{
+	// the shaders compiled with the application are checked against the pipeline layout when building it
+
+	constexpr bool fitPushConstants()
+	{
+		for (const ShaderLayout &layout : ShaderLayouts::ALL) {
+			for (uint32_t i = 0; i < layout.pushConstantRangeCount; ++i) {
+				const ShaderLayout::PushConstantRange &range = layout.pushConstantRanges[i];
+				if (range.offset + range.size > sizeof(PushConstants)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	constexpr bool fitDescriptorSets()
+	{
+		for (const ShaderLayout &layout : ShaderLayouts::ALL) {
+			for (uint32_t i = 0; i < layout.bindingCount; ++i) {
+				if (layout.bindings[i].set > static_cast<uint32_t>(DescriptorSetIndex::MATERIAL_DATA)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// component count and numeric type of a vertex format, {0, 0} for formats not used by any vertex
+	constexpr std::pair<uint32_t, char> getVertexFormatClass(VkFormat format)
+	{
+		switch (format) {
+		case VK_FORMAT_R32_SFLOAT:
+			return {1, 'f'};
+		case VK_FORMAT_R32G32_SFLOAT:
+		case VK_FORMAT_R16G16_SNORM:
+		case VK_FORMAT_R16G16_UNORM:
+			return {2, 'f'};
+		case VK_FORMAT_R32G32B32_SFLOAT:
+			return {3, 'f'};
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+		case VK_FORMAT_R16G16B16A16_SNORM:
+		case VK_FORMAT_R16G16B16A16_UNORM:
+		case VK_FORMAT_R8G8B8A8_UNORM:
+			return {4, 'f'};
+		default:
+			return {0, 0};
+		}
+	}
+
+	// every input of the shader is provided at its location, normalized formats are read as floats
+	template<size_t N>
+	constexpr bool fitVertexAttributes(
+		const ShaderLayout &layout,
+		const std::array<VkVertexInputAttributeDescription, N> &attributes
+	)
+	{
+		for (uint32_t i = 0; i < layout.vertexInputCount; ++i) {
+			const ShaderLayout::VertexInput &input = layout.vertexInputs[i];
+			bool provided = false;
+			for (const VkVertexInputAttributeDescription &attribute : attributes) {
+				if (attribute.location == input.location) {
+					std::pair<uint32_t, char> inputClass = getVertexFormatClass(input.format);
+					provided = inputClass.first > 0 && inputClass == getVertexFormatClass(attribute.format);
+				}
+			}
+			if (!provided) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static_assert(fitPushConstants(), "a shader reads push constants beyond PushConstants");
+	static_assert(fitDescriptorSets(), "a shader uses a descriptor set beyond DescriptorSetIndex");
+	static_assert(
+		fitVertexAttributes(ShaderLayouts::SHADER_VERT, Vertex::getAttributeDescriptions()),
+		"shader.vert reads a vertex attribute that Vertex does not provide"
+	);
+	static_assert(
+		fitVertexAttributes(ShaderLayouts::SHADER_COMPRESSED_VERT, CompressedVertex::getAttributeDescriptions()),
+		"shader.compressed.vert reads a vertex attribute that CompressedVertex does not provide"
+	);
+}
+
 GraphicsPipeline::GraphicsPipeline(
         Device &device,
         const RenderPass &renderPass,
-		const Material &material
+		const Material &material,
+		VertexFormat vertexFormat,
+		const Shader &vertexShader,
+		const Shader &fragmentShader
 ) : device(device),
-	renderPass(renderPass),
-	material(material),
-	materialDescriptorSetLayout(
-		device.getObjectCache().getDescriptorSetLayout(material.getDescriptorSetLayoutBindings())
-	)
+	vertexFormat(vertexFormat),
+	shaderFeatures(material.getShaderFeatures()),
+	vertexShaderId(material.getVertexShaderResource(vertexFormat).getId()),
+	fragmentShaderId(material.getFragmentShaderResource().getId()),
+	materialDescriptorSetLayout(device.getObjectCache().getMaterialDescriptorSetLayout(material))
 {
-	Shader &vertexShader = device.getObjectCache().getShader(material.getVertexShaderResource());
-	Shader &fragmentShader = device.getObjectCache().getShader(material.getFragmentShaderResource());
+	if (!(vertexShader.getResource().getData().stage & VK_SHADER_STAGE_VERTEX_BIT)) {
+		throw std::invalid_argument("vertexShader is not suited for the vertex stage");
+	}
+	if (!(fragmentShader.getResource().getData().stage & VK_SHADER_STAGE_FRAGMENT_BIT)) {
+		throw std::invalid_argument("fragmentShader is not suited for the fragment stage");
+	}
 
 	auto globalBindings = RenderObject::getGlobalUniformDataLayoutBindings();
 	const auto &materialBindings = material.getDescriptorSetLayoutBindings();
@@ -47,13 +144,13 @@ GraphicsPipeline::GraphicsPipeline(
 		pipelineBindings[1][binding.binding] = binding;
 	}
 
-	std::array<Shader *, 2> shaderArray = {
+	std::array<const Shader *, 2> shaderArray = {
 		&vertexShader,
 		&fragmentShader
 	};
 
 	// check shader compatibility
-	for (Shader *shader : shaderArray) {
+	for (const Shader *shader : shaderArray) {
 		auto shaderStage = shader->getResource().getData().stage;
 		std::string shaderName;
 		if (shaderStage & VK_SHADER_STAGE_VERTEX_BIT) {
@@ -65,6 +162,9 @@ GraphicsPipeline::GraphicsPipeline(
 
 		for (const auto &setAndBindings : shader->getDescriptorSetLayoutBindingMap()) {
 			for (const auto &binding : setAndBindings.second) {
+				// samplers skipped by a specialization constant are still used statically, so every
+				// binding the shader declares has to be in the layout, see Material::createImages()
+
 				auto pipelineSetIter = pipelineBindings.find(setAndBindings.first);
 				if (pipelineSetIter == pipelineBindings.end()) {
 					throw std::invalid_argument(fmt::format(
@@ -121,18 +221,29 @@ GraphicsPipeline::GraphicsPipeline(
 	createPipelineLayout(
 		descriptorSetLayouts
 	);
-	createPipeline(
-		vertexShader,
-		fragmentShader
-	);
+
+	compileInfo = CompileInfo{
+		.device = device.getDeviceHandle(),
+		.pipelineCache = &device.getPipelineCache(),
+		.renderPass = renderPass.getHandle(),
+		.pipelineLayout = pipelineLayout,
+		.vertexFormat = vertexFormat,
+		.shaderFeatures = shaderFeatures,
+		.vertexShader = vertexShader.getShaderModule(),
+		.fragmentShader = fragmentShader.getShaderModule(),
+	};
 }
 
 GraphicsPipeline::GraphicsPipeline(GraphicsPipeline &&other)
 	: device(other.device),
-	renderPass(other.renderPass),
-	material(other.material),
+	vertexFormat(other.vertexFormat),
+	shaderFeatures(other.shaderFeatures),
+	vertexShaderId(other.vertexShaderId),
+	fragmentShaderId(other.fragmentShaderId),
 	pipelineLayout(other.pipelineLayout),
 	pipeline(other.pipeline),
+	fallback(other.fallback),
+	compileInfo(other.compileInfo),
 	materialDescriptorSetLayout(other.materialDescriptorSetLayout)
 {
 	other.pipelineLayout = VK_NULL_HANDLE;
@@ -142,12 +253,16 @@ GraphicsPipeline::GraphicsPipeline(GraphicsPipeline &&other)
 GraphicsPipeline::~GraphicsPipeline()
 {
 	vkDestroyPipeline(device.getDeviceHandle(), pipeline, nullptr);
-	vkDestroyPipelineLayout(device.getDeviceHandle(), pipelineLayout, nullptr);
 }
 
-const Material &GraphicsPipeline::getMaterial() const
+VertexFormat GraphicsPipeline::getVertexFormat() const
+{
+	return vertexFormat;
+}
+
+const ShaderFeatures &GraphicsPipeline::getShaderFeatures() const
 {
-	return material;
+	return shaderFeatures;
 }
 
 const DescriptorSetLayout &GraphicsPipeline::getMaterialDescriptorSetLayout() const
@@ -155,6 +270,47 @@ const DescriptorSetLayout &GraphicsPipeline::getMaterialDescriptorSetLayout() co
 	return materialDescriptorSetLayout;
 }
 
+bool GraphicsPipeline::usesShader(ResourceId id) const
+{
+	return vertexShaderId == id || fragmentShaderId == id;
+}
+
+VkDeviceSize GraphicsPipeline::getSize() const
+{
+	return 0;
+}
+
+bool GraphicsPipeline::isReady() const
+{
+	return pipeline != VK_NULL_HANDLE;
+}
+
+bool GraphicsPipeline::isCompatible(const GraphicsPipeline &other) const
+{
+	return pipelineLayout == other.pipelineLayout && vertexFormat == other.vertexFormat;
+}
+
+GraphicsPipeline *GraphicsPipeline::getFallback() const
+{
+	return fallback;
+}
+
+void GraphicsPipeline::setFallback(GraphicsPipeline *fallback)
+{
+	this->fallback = fallback;
+}
+
+const GraphicsPipeline::CompileInfo &GraphicsPipeline::getCompileInfo() const
+{
+	return compileInfo;
+}
+
+void GraphicsPipeline::setCompiledPipeline(VkPipeline pipeline)
+{
+	this->pipeline = pipeline;
+	fallback = nullptr;
+}
+
 void GraphicsPipeline::bind(VkCommandBuffer commandBuffer)
 {
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
@@ -178,6 +334,22 @@ void GraphicsPipeline::bindDescriptorSet(
 	);
 }
 
+void GraphicsPipeline::pushDescriptorSet(
+	VkCommandBuffer commandBuffer,
+	DescriptorSetIndex index,
+	const std::vector<VkWriteDescriptorSet> &writes
+)
+{
+	device.getFunctions().cmdPushDescriptorSet(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		static_cast<uint32_t>(index),
+		static_cast<uint32_t>(writes.size()),
+		writes.data()
+	);
+}
+
 void GraphicsPipeline::pushConstants(VkCommandBuffer commandBuffer, const void *data, size_t size)
 {
 	vkCmdPushConstants(commandBuffer, 
@@ -210,40 +382,44 @@ void GraphicsPipeline::createPipelineLayout(const std::vector<VkDescriptorSetLay
 	pushConstantRange.size = sizeof(PushConstants);
 	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = descriptorSetLayouts.size();
-	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-	VK_ASSERT(vkCreatePipelineLayout(
-		device.getDeviceHandle(), 
-		&pipelineLayoutInfo, 
-		nullptr, 
-		&pipelineLayout
-	));
+	pipelineLayout = device.getObjectCache().getPipelineLayout(descriptorSetLayouts, {pushConstantRange});
 }
 
-void GraphicsPipeline::createPipeline(const Shader &vertexShader, const Shader &fragmentShader)
+VkPipeline GraphicsPipeline::compile(const CompileInfo &info)
 {
-	if (!(vertexShader.getResource().getData().stage & VK_SHADER_STAGE_VERTEX_BIT)) {
-		throw std::invalid_argument("vertexShader is not suited for the vertex stage");
-	}
-	if (!(fragmentShader.getResource().getData().stage & VK_SHADER_STAGE_FRAGMENT_BIT)) {
-		throw std::invalid_argument("fragmentShader is not suited for the fragment stage");
-	}
+	StartupProfiler::Scope scope("compile pipeline", fmt::format("variant {:#x}", info.shaderFeatures.getMask()));
+
+	struct SpecializationData
+	{
+		VkBool32 textured;
+		VkBool32 specular;
+	};
+	SpecializationData specializationData{
+		.textured = info.shaderFeatures.textured ? VK_TRUE : VK_FALSE,
+		.specular = info.shaderFeatures.specular ? VK_TRUE : VK_FALSE,
+	};
+	std::array<VkSpecializationMapEntry, 2> specializationEntries = {
+		VkSpecializationMapEntry{0, offsetof(SpecializationData, textured), sizeof(VkBool32)},
+		VkSpecializationMapEntry{1, offsetof(SpecializationData, specular), sizeof(VkBool32)},
+	};
+	VkSpecializationInfo specializationInfo{
+		.mapEntryCount = static_cast<uint32_t>(specializationEntries.size()),
+		.pMapEntries = specializationEntries.data(),
+		.dataSize = sizeof(specializationData),
+		.pData = &specializationData,
+	};
 
 	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStageInfos = {};
 	shaderStageInfos[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStageInfos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	shaderStageInfos[0].module = vertexShader.getShaderModule();
+	shaderStageInfos[0].module = info.vertexShader;
 	shaderStageInfos[0].pName = "main";
 
 	shaderStageInfos[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStageInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	shaderStageInfos[1].module = fragmentShader.getShaderModule();
+	shaderStageInfos[1].module = info.fragmentShader;
 	shaderStageInfos[1].pName = "main";
+	shaderStageInfos[1].pSpecializationInfo = &specializationInfo;
 
 
 	// fixed function setup
@@ -257,8 +433,18 @@ void GraphicsPipeline::createPipeline(const Shader &vertexShader, const Shader &
 	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicState.pDynamicStates = dynamicStates.data();
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	VkVertexInputBindingDescription bindingDescription;
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	if (info.vertexFormat == VertexFormat::COMPRESSED) {
+		auto attributes = CompressedVertex::getAttributeDescriptions();
+		bindingDescription = CompressedVertex::getBindingDescription();
+		attributeDescriptions.assign(attributes.begin(), attributes.end());
+	}
+	else {
+		auto attributes = Vertex::getAttributeDescriptions();
+		bindingDescription = Vertex::getBindingDescription();
+		attributeDescriptions.assign(attributes.begin(), attributes.end());
+	}
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
@@ -344,18 +530,21 @@ void GraphicsPipeline::createPipeline(const Shader &vertexShader, const Shader &
 	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDynamicState = &dynamicState;
-	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = renderPass.getHandle();
+	pipelineInfo.layout = info.pipelineLayout;
+	pipelineInfo.renderPass = info.renderPass;
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
+	VkPipeline pipeline = VK_NULL_HANDLE;
 	VK_ASSERT(vkCreateGraphicsPipelines(
-		device.getDeviceHandle(), 
-		VK_NULL_HANDLE, 
+		info.device, 
+		info.pipelineCache->getHandle(), 
 		1, 
 		&pipelineInfo, 
 		nullptr, 
 		&pipeline
 	));
+	info.pipelineCache->notifyPipelineCreated();
+	return pipeline;
 }
\ No newline at end of file
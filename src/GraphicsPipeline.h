@@ -5,6 +5,7 @@
 #include "DescriptorSetLayout.h"
 #include "Resource.h"
 #include "Shader.h"
+#include "Vertex.h"
 
 #include <vulkan/vulkan_core.h>
 #include <vector>
@@ -15,10 +16,13 @@ class RenderPass;
 class DescriptorSet;
 class Material;
 class Device;
+class PipelineCache;
 
 struct PushConstants {
-    glm::mat4 transform;
-    glm::mat4 normalTransform;
+    // index into the ObjectBuffer
+    uint32_t objectId;
+    // index into the MaterialBuffer
+    uint32_t materialId;
 };
 
 
@@ -28,33 +32,92 @@ enum class DescriptorSetIndex: uint32_t
     MATERIAL_DATA = 1,
 };
 
+// material features that are compile time constants of the fragment shader, so that unused texture
+// lookups and lighting terms cost nothing; one pipeline variant is compiled per combination
+struct ShaderFeatures
+{
+    // constant_id 0, samples tex0, the first material texture bound to set 1
+    bool textured = true;
+    // constant_id 1
+    bool specular = true;
+
+    // the key of the variant
+    uint32_t getMask() const
+    {
+        return (textured ? 2u : 0u) | (specular ? 1u : 0u);
+    }
+};
+
+// Created for a material, but only depends on its shaders and descriptor set layout, so it is shared
+// through the VulkanObjectCache by all materials that have these in common.
+// The constructor only validates the shaders and sets up the layout, the VkPipeline is compiled separately
+// with compile(), which may run on any thread, and handed over with setCompiledPipeline().
 class GraphicsPipeline
 {
 public:
+    // everything compile() needs, so that it does not depend on the pipeline object or its shaders
+    struct CompileInfo
+    {
+        VkDevice device;
+        PipelineCache *pipelineCache;
+        VkRenderPass renderPass;
+        VkPipelineLayout pipelineLayout;
+        VertexFormat vertexFormat;
+        ShaderFeatures shaderFeatures;
+        VkShaderModule vertexShader;
+        VkShaderModule fragmentShader;
+    };
+
     GraphicsPipeline(
         Device &device,
         const RenderPass &renderPass,
-        const Material &material
+        const Material &material,
+        VertexFormat vertexFormat,
+        const Shader &vertexShader,
+        const Shader &fragmentShader
     );
     GraphicsPipeline(const GraphicsPipeline &) = delete;
     GraphicsPipeline(GraphicsPipeline &&);
     ~GraphicsPipeline();
 
     const DescriptorSetLayout &getMaterialDescriptorSetLayout() const; // set = 1
-    const Material &getMaterial() const;
+    VertexFormat getVertexFormat() const;
+    const ShaderFeatures &getShaderFeatures() const;
+    bool usesShader(ResourceId id) const;
+    // pipelines take no device memory counted against the cache budget
+    VkDeviceSize getSize() const;
+    bool isReady() const;
+    // draws with the same material descriptor sets and vertices can use the other pipeline
+    bool isCompatible(const GraphicsPipeline &other) const;
+    // a compatible ready pipeline to draw with until this one is compiled, if there is one
+    GraphicsPipeline *getFallback() const;
+    void setFallback(GraphicsPipeline *fallback);
+    const CompileInfo &getCompileInfo() const;
+    void setCompiledPipeline(VkPipeline pipeline);
+    static VkPipeline compile(const CompileInfo &info);
     void bind(VkCommandBuffer commandBuffer);
     void bindDescriptorSet(VkCommandBuffer commandBuffer, DescriptorSetIndex index, const DescriptorSet &set);
+    // requires a push descriptor layout for the set, see VulkanObjectCache::setPushMaterialDescriptors()
+    void pushDescriptorSet(
+        VkCommandBuffer commandBuffer,
+        DescriptorSetIndex index,
+        const std::vector<VkWriteDescriptorSet> &writes
+    );
     void pushConstants(VkCommandBuffer commandBuffer, const void *data, size_t size);
 private:
     std::vector<VkDescriptorSetLayoutBinding> createGlobalUniformDataLayoutBindings();
     void createPipelineLayout(const std::vector<VkDescriptorSetLayout> &descriptorSetLayouts);
-    void createPipeline(const Shader &vertexShader, const Shader &fragmentShader);
 
     Device &device;
-    const RenderPass &renderPass;
-    const Material &material;
+    VertexFormat vertexFormat;
+    ShaderFeatures shaderFeatures;
+    ResourceId vertexShaderId;
+    ResourceId fragmentShaderId;
+    // owned by the VulkanObjectCache, shared by all pipelines with the same descriptor set layouts
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     VkPipeline pipeline = VK_NULL_HANDLE;
+    GraphicsPipeline *fallback = nullptr;
+    CompileInfo compileInfo;
 
     DescriptorSetLayout &materialDescriptorSetLayout;
 };
@@ -41,6 +41,11 @@ VkImage Image::getImageHandle() const
     return image.first;
 }
 
+VkDeviceSize Image::getSize() const
+{
+    return image.second != VK_NULL_HANDLE ? device.getAllocator().getAllocationSize(image.second) : 0;
+}
+
 std::pair<VkImage, VmaAllocation> Image::createImage(const std::filesystem::path &imagePath)
 {
     int wdt;
@@ -20,6 +20,8 @@ public:
     ~Image();
 
     VkImage getImageHandle() const;
+    // of the device memory allocated for the image
+    VkDeviceSize getSize() const;
 private:
     std::pair<VkImage, VmaAllocation> createImage(const std::filesystem::path &image);
     std::pair<VkImage, VmaAllocation> createImage(const ImageResource &image);
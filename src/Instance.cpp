@@ -1,14 +1,17 @@
 #include "Instance.h"
 #include "VkHelpers.h"
 
+#include <cstring>
 #include <vulkan/vulkan_core.h>
 #include <sstream>
 
 Instance::Instance(
     std::vector<const char *> extensionsToEnable,
-    bool enableValidationLayers
+    bool enableValidationLayers,
+    std::vector<const char *> optionalExtensions
 )
     : extensionsToEnable(extensionsToEnable),
+    optionalExtensions(optionalExtensions),
     isValidationLayersEnabled(enableValidationLayers)
 {
     createInstance();
@@ -37,6 +40,16 @@ bool Instance::hasValidationLayersEnabled() const
     return isValidationLayersEnabled;
 }
 
+bool Instance::isExtensionEnabled(const char *name) const
+{
+    for (const char *extension : extensionsToEnable) {
+        if (!strcmp(extension, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 const std::vector<const char *> &Instance::getValidationLayers() const
 {
     return requiredValidationLayers;
@@ -90,6 +103,14 @@ void Instance::createInstance()
 	if(isValidationLayersEnabled) {
 		extensionsToEnable.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
+	for (const char *optionalExtension : optionalExtensions) {
+		for (const auto &extension : extensions) {
+			if (!strcmp(optionalExtension, extension.extensionName)) {
+				extensionsToEnable.push_back(optionalExtension);
+				break;
+			}
+		}
+	}
 	createInfo.enabledExtensionCount = extensionsToEnable.size();
 	createInfo.ppEnabledExtensionNames = extensionsToEnable.data();
 
@@ -10,12 +10,15 @@ class Instance
 public:
     Instance(
         std::vector<const char *> extensionsToEnable = { VK_KHR_SURFACE_EXTENSION_NAME },
-        bool enableValidationLayers = false
+        bool enableValidationLayers = false,
+        // enabled only if available
+        std::vector<const char *> optionalExtensions = {}
     );
     ~Instance();
 
     VkInstance getHandle();
     bool hasValidationLayersEnabled() const;
+    bool isExtensionEnabled(const char *name) const;
     const std::vector<const char *> &getValidationLayers() const;
 private:
     void createInstance();
@@ -35,6 +38,7 @@ private:
     VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
 
     std::vector<const char *> extensionsToEnable;
+    std::vector<const char *> optionalExtensions;
 
     std::vector<VkExtensionProperties> extensions;
     std::vector<const char *> requiredValidationLayers = {
@@ -18,8 +18,11 @@ MappedBuffer::MappedBuffer(DeviceAllocator &allocator, size_t size, VkBufferUsag
 
 MappedBuffer::MappedBuffer(MappedBuffer &&b) noexcept
     : allocator(b.allocator),
+    data(b.data),
+    size(b.size),
     bufferAllocation(b.bufferAllocation)
 {
+    b.data = nullptr;
     b.bufferAllocation.first = VK_NULL_HANDLE;
 }
 
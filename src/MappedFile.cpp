@@ -0,0 +1,145 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <spdlog/fmt/fmt.h>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path &path)
+    : path(path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(fmt::format("MappedFile: could not open {}", path.string()));
+    }
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(file, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    fileHandle = file;
+
+    if (size > 0) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            unmap();
+            throw std::runtime_error(fmt::format("MappedFile: could not map {}", path.string()));
+        }
+        mappingHandle = mapping;
+        data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr) {
+            unmap();
+            throw std::runtime_error(fmt::format("MappedFile: could not map {}", path.string()));
+        }
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(fmt::format(
+            "MappedFile: could not open {}: {}", path.string(), std::strerror(errno)
+        ));
+    }
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error(fmt::format(
+            "MappedFile: could not stat {}: {}", path.string(), std::strerror(errno)
+        ));
+    }
+    size = static_cast<size_t>(fileStat.st_size);
+
+    if (size > 0) {
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error(fmt::format(
+                "MappedFile: could not map {}: {}", path.string(), std::strerror(errno)
+            ));
+        }
+        data = static_cast<const std::byte *>(mapped);
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : path(std::move(other.path)),
+    data(other.data),
+    size(other.size)
+#ifdef _WIN32
+    , fileHandle(other.fileHandle),
+    mappingHandle(other.mappingHandle)
+#endif
+{
+    other.data = nullptr;
+    other.size = 0;
+#ifdef _WIN32
+    other.fileHandle = nullptr;
+    other.mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+
+const std::byte *MappedFile::getData() const
+{
+    return data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return size;
+}
+
+const std::filesystem::path &MappedFile::getPath() const
+{
+    return path;
+}
+
+void MappedFile::unmap()
+{
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data) {
+        munmap(const_cast<std::byte *>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <filesystem>
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile(const std::filesystem::path &path);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&) noexcept;
+    ~MappedFile();
+
+    const std::byte *getData() const;
+    size_t getSize() const;
+    const std::filesystem::path &getPath() const;
+private:
+    void unmap();
+
+    std::filesystem::path path;
+    const std::byte *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+#endif
@@ -4,8 +4,10 @@
 #include "GraphicsPipeline.h"
 #include "Image.h"
 #include "VkHelpers.h"
+#include <algorithm>
 #include <cstdint>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
 #include <utility>
 #include <vulkan/vulkan_core.h>
 
@@ -14,15 +16,15 @@ Material::Material(uint32_t id, Device &device, const MaterialResource &resource
     : id(id),
     name(resource.getData().name),
     device(device),
-    vertexShader(*resource.getData().vertexShader),
-    fragmentShader(*resource.getData().fragmentShader),
+    resource(resource),
     images(createImages(resource)),
     imageViews(createImageViews()),
     sampler(requestSampler()),
-    parameterBuffer(createParameterBuffer(resource)),
+    parameters(createParameters()),
     descriptorSetLayoutBindings(createDescriptorSetLayoutBindings()),
     descriptorImageInfos(createDescriptorImageInfos()),
-    descriptorBufferInfos(createDescriptorBufferInfos())
+    pushDescriptorWrites(createPushDescriptorWrites()),
+    shaderFeatures(createShaderFeatures())
 {
     spdlog::info("Material {}({}): created", id, name);
 }
@@ -31,15 +33,17 @@ Material::Material(Material &&other)
     : id(other.id),
     name(std::move(other.name)),
     device(other.device),
-    vertexShader(other.vertexShader),
-    fragmentShader(other.fragmentShader),
+    resource(other.resource),
+    textureCount(other.textureCount),
     images(std::move(other.images)),
     imageViews(std::move(other.imageViews)),
     sampler(other.sampler),
-    parameterBuffer(std::move(other.parameterBuffer)),
+    parameters(other.parameters),
     descriptorSetLayoutBindings(std::move(other.descriptorSetLayoutBindings)),
     descriptorImageInfos(std::move(other.descriptorImageInfos)),
-    descriptorBufferInfos(std::move(other.descriptorBufferInfos))
+    // moving the map keeps its nodes, so the writes still point to the right infos
+    pushDescriptorWrites(std::move(other.pushDescriptorWrites)),
+    shaderFeatures(other.shaderFeatures)
 {
     other.sampler = VK_NULL_HANDLE;
 }
@@ -47,9 +51,7 @@ Material::Material(Material &&other)
 Material::~Material()
 {
     images.clear();
-    for (auto &imageView : imageViews) {
-        vkDestroyImageView(device.getDeviceHandle(), imageView, nullptr);
-    }
+    destroyImageViews();
 }
 
 
@@ -58,14 +60,55 @@ uint32_t Material::getId() const
     return id;
 }
 
-const ShaderResource &Material::getVertexShaderResource() const
+const MaterialResource &Material::getResource() const
+{
+    return resource;
+}
+
+const Material::Parameters &Material::getParameters() const
+{
+    return parameters;
+}
+
+bool Material::usesImage(const ImageResource &image) const
+{
+    const auto &resourceData = resource.getData();
+    return resourceData.ambientTexture == &image
+        || resourceData.diffuseTexture == &image
+        || resourceData.specularTexture == &image
+        || resourceData.normalTexture == &image
+        || (textureCount == 0 && resourceData.placeholderTexture == &image);
+}
+
+void Material::reloadImages()
 {
-    return vertexShader;
+    spdlog::info("Material {}({}): reloading images", id, name);
+
+    destroyImageViews();
+    images = createImages(resource);
+    imageViews = createImageViews();
+    descriptorImageInfos = createDescriptorImageInfos();
+    pushDescriptorWrites = createPushDescriptorWrites();
+}
+
+const ShaderResource &Material::getVertexShaderResource(VertexFormat vertexFormat) const
+{
+    // read from the resource every time, a reloaded shader may have been split off a shared one
+    const MaterialResourceData &data = resource.getData();
+    if (vertexFormat == VertexFormat::COMPRESSED) {
+        if (!data.compressedVertexShader) {
+            throw std::runtime_error(fmt::format(
+                "Material {}({}): no vertex shader for compressed vertices", id, name
+            ));
+        }
+        return *data.compressedVertexShader;
+    }
+    return *data.vertexShader;
 }
 
 const ShaderResource &Material::getFragmentShaderResource() const
 {
-    return fragmentShader;
+    return *resource.getData().fragmentShader;
 }
 
 VkSampler Material::getSamplerHandle() const
@@ -78,27 +121,39 @@ const std::vector<VkDescriptorSetLayoutBinding> &Material::getDescriptorSetLayou
     return descriptorSetLayoutBindings;
 }
 
+const ShaderFeatures &Material::getShaderFeatures() const
+{
+    return shaderFeatures;
+}
+
 const std::map<uint32_t, VkDescriptorImageInfo> &Material::getDescriptorImageInfos() const
 {
     return descriptorImageInfos;
 }
 
-
-const std::map<uint32_t, VkDescriptorBufferInfo> &Material::getDescriptorBufferInfos() const
+const std::vector<VkWriteDescriptorSet> &Material::getPushDescriptorWrites() const
 {
-    return descriptorBufferInfos;
+    return pushDescriptorWrites;
 }
 
 
-std::vector<Image *> Material::createImages(const std::vector<const ImageResource *> &imageResources)
+void Material::destroyImageViews()
+{
+    for (auto &imageView : imageViews) {
+        vkDestroyImageView(device.getDeviceHandle(), imageView, nullptr);
+    }
+    imageViews.clear();
+}
+
+std::vector<CacheReference<Image>> Material::createImages(const std::vector<const ImageResource *> &imageResources)
 {
     spdlog::info("Material {}({}): creating images", id, name);
 
-    std::vector<Image *> images;
+    std::vector<CacheReference<Image>> images;
     images.reserve(imageResources.size());
 
     for (const ImageResource *imageResource : imageResources) {
-        images.emplace_back(&device.getObjectCache().getImage(*imageResource));
+        images.push_back(device.getObjectCache().acquireImage(*imageResource));
     }
 
     spdlog::info("Material {}({}): created {} images", id, name, images.size());
@@ -106,10 +161,9 @@ std::vector<Image *> Material::createImages(const std::vector<const ImageResourc
     return images;
 }
 
-std::vector<Image *> Material::createImages(const MaterialResource &resource)
+std::vector<CacheReference<Image>> Material::createImages(const MaterialResource &resource)
 {
     spdlog::info("Material {}({}): creating images from MaterialResource", id, name);
-    // TODO: the images for a single ImageResource should not be created multiple times
     const auto &resourceData = resource.getData();
     std::vector<const ImageResource *> imageResources;
     imageResources.reserve(4);
@@ -125,6 +179,16 @@ std::vector<Image *> Material::createImages(const MaterialResource &resource)
     if (resourceData.normalTexture) {
         imageResources.push_back(resourceData.normalTexture);
     }
+    textureCount = static_cast<uint32_t>(imageResources.size());
+    // tex0 counts as used by the untextured variants as well, so the layout needs a binding for it
+    if (imageResources.empty()) {
+        if (!resourceData.placeholderTexture) {
+            throw std::runtime_error(fmt::format(
+                "Material {}({}): no placeholder texture for an untextured material", id, name
+            ));
+        }
+        imageResources.push_back(resourceData.placeholderTexture);
+    }
     return createImages(imageResources);
 }
 
@@ -179,19 +243,13 @@ VkSampler Material::requestSampler()
 
 std::vector<VkDescriptorSetLayoutBinding> Material::createDescriptorSetLayoutBindings()
 {
-    size_t bindingsCount = images.size() + 1;
+    // the parameters are read from the MaterialBuffer, so the set only holds the textures
+    size_t bindingsCount = images.size();
     spdlog::info("Material {}({}): creating {} descriptor set layout bindings", id, name, bindingsCount);
 
     std::vector<VkDescriptorSetLayoutBinding> bindings(bindingsCount, VkDescriptorSetLayoutBinding{});
 
-    bindings[0] = {
-        .binding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-    };
-
-    for (size_t i = 1; i < bindings.size(); ++i) {
+    for (size_t i = 0; i < bindings.size(); ++i) {
         VkDescriptorSetLayoutBinding &samplerDescriptorSetLayoutBinding = bindings[i];
         samplerDescriptorSetLayoutBinding.binding = i;
         samplerDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -210,7 +268,7 @@ std::map<uint32_t, VkDescriptorImageInfo> Material::createDescriptorImageInfos()
     std::map<uint32_t, VkDescriptorImageInfo> imageBindingInfos;
 
     for (size_t i = 0; i < imageCount; ++i) {
-        imageBindingInfos[i + 1] = VkDescriptorImageInfo{
+        imageBindingInfos[i] = VkDescriptorImageInfo{
             .sampler = sampler,
             .imageView = imageViews[i],
             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
@@ -220,39 +278,46 @@ std::map<uint32_t, VkDescriptorImageInfo> Material::createDescriptorImageInfos()
     return imageBindingInfos;
 }
 
-
-std::map<uint32_t, VkDescriptorBufferInfo> Material::createDescriptorBufferInfos()
+std::vector<VkWriteDescriptorSet> Material::createPushDescriptorWrites()
 {
-    return std::map<uint32_t, VkDescriptorBufferInfo>{
-        std::make_pair(
-            0,
-            VkDescriptorBufferInfo{
-                .buffer = parameterBuffer.getHandle(),
-                .offset = 0,
-                .range = VK_WHOLE_SIZE,
-            }
-        )
-    };
-}
-
-Buffer Material::createParameterBuffer(const Parameters &params)
-{
-    return Buffer{
-        device.getAllocator(),
-        (void *) &params,
-        sizeof(params),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
-    };
+    std::vector<VkWriteDescriptorSet> writes;
+    for (const auto &binding : descriptorSetLayoutBindings) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstBinding = binding.binding;
+        write.dstArrayElement = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = binding.descriptorType;
+
+        auto imageInfo = descriptorImageInfos.find(binding.binding);
+        if (imageInfo == descriptorImageInfos.end()) {
+            continue;
+        }
+        write.pImageInfo = &imageInfo->second;
+        writes.push_back(write);
+    }
+    return writes;
 }
 
-Buffer Material::createParameterBuffer(const MaterialResource &resource)
+Material::Parameters Material::createParameters()
 {
     const auto &resourceData = resource.getData();
 
-    Parameters params{
+    return Parameters{
         .ambient = resourceData.ambient,
         .diffuse = resourceData.diffuse,
         .specularAndShininess = glm::vec4(resourceData.specular, resourceData.shininess),
     };
-    return createParameterBuffer(params);
+}
+
+ShaderFeatures Material::createShaderFeatures()
+{
+    const auto &resourceData = resource.getData();
+
+    ShaderFeatures features;
+    features.textured = textureCount > 0;
+    // the specular map is not sampled, only the color decides
+    const glm::vec3 &specular = resourceData.specular;
+    features.specular = std::max({specular.x, specular.y, specular.z}) > 0.f;
+    return features;
 }
@@ -1,12 +1,13 @@
 #ifndef MATERIAL_H_
 #define MATERIAL_H_
 
-#include "Buffer.h"
 #include "DeviceAllocator.h"
 #include "GraphicsPipeline.h"
 #include "Image.h"
 #include "Resource.h"
 #include "Shader.h"
+#include "Vertex.h"
+#include "VulkanObjectCache.h"
 
 #include <cstdint>
 #include <filesystem>
@@ -22,6 +23,7 @@ class Device;
 class Material
 {
 public:
+    // std430 layout of MaterialParameters in the fragment shader, stored in the MaterialBuffer by material id
     struct Parameters
     {
         glm::vec3 ambient;
@@ -41,35 +43,49 @@ public:
     ~Material();
 
     uint32_t getId() const;
-    const ShaderResource &getVertexShaderResource() const;
+    const MaterialResource &getResource() const;
+    const Parameters &getParameters() const;
+    bool usesImage(const ImageResource &image) const;
+    // recreates the images, views and image infos after the data of the image resources changed,
+    // descriptor sets still using the old image views have to be updated by the caller
+    void reloadImages();
+    const ShaderResource &getVertexShaderResource(VertexFormat vertexFormat = VertexFormat::STANDARD) const;
     const ShaderResource &getFragmentShaderResource() const;
     VkSampler getSamplerHandle() const;
     const std::vector<VkDescriptorSetLayoutBinding> &getDescriptorSetLayoutBindings() const;
+    // selects the pipeline variant
+    const ShaderFeatures &getShaderFeatures() const;
     const std::map<uint32_t, VkDescriptorImageInfo> &getDescriptorImageInfos() const;
-    const std::map<uint32_t, VkDescriptorBufferInfo> &getDescriptorBufferInfos() const;
+    // one write per binding referring to the infos above, for GraphicsPipeline::pushDescriptorSet()
+    const std::vector<VkWriteDescriptorSet> &getPushDescriptorWrites() const;
 private:
-    std::vector<Image *> createImages(const std::vector<const ImageResource *> &imageResources);
-    std::vector<Image *> createImages(const MaterialResource &resource);
+    std::vector<CacheReference<Image>> createImages(const std::vector<const ImageResource *> &imageResources);
+    std::vector<CacheReference<Image>> createImages(const MaterialResource &resource);
     std::vector<VkImageView>  createImageViews();
     VkSampler requestSampler();
     std::vector<VkDescriptorSetLayoutBinding> createDescriptorSetLayoutBindings();
     std::map<uint32_t, VkDescriptorImageInfo> createDescriptorImageInfos();
-    std::map<uint32_t, VkDescriptorBufferInfo> createDescriptorBufferInfos();
-    Buffer createParameterBuffer(const Parameters &params);
-    Buffer createParameterBuffer(const MaterialResource &resource);
+    std::vector<VkWriteDescriptorSet> createPushDescriptorWrites();
+    ShaderFeatures createShaderFeatures();
+    Parameters createParameters();
+
+    void destroyImageViews();
 
     uint32_t id;
     std::string name;
     Device &device;
-    const ShaderResource &vertexShader;
-    const ShaderResource &fragmentShader;
-    std::vector<Image *> images;
+    const MaterialResource &resource;
+    // of the material resource, images holds the placeholder texture if there are none
+    uint32_t textureCount = 0;
+    // released when the material is destroyed or reloads its images
+    std::vector<CacheReference<Image>> images;
     std::vector<VkImageView> imageViews;
     VkSampler sampler = VK_NULL_HANDLE;
-    Buffer parameterBuffer;
+    Parameters parameters;
     std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings;
     std::map<uint32_t, VkDescriptorImageInfo> descriptorImageInfos;
-    std::map<uint32_t, VkDescriptorBufferInfo> descriptorBufferInfos;
+    std::vector<VkWriteDescriptorSet> pushDescriptorWrites;
+    ShaderFeatures shaderFeatures;
 };
 
 #endif
@@ -0,0 +1,165 @@
+#include "MaterialBuffer.h"
+#include "DeviceAllocator.h"
+
+#include <algorithm>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+MaterialBuffer::MaterialBuffer(DeviceAllocator &allocator, uint32_t frameCount, size_t initialCapacity)
+    : allocator(allocator),
+    buffer(createBuffer(initialCapacity)),
+    stagingBuffers(frameCount)
+{
+    if (frameCount == 0) {
+        throw std::invalid_argument("MaterialBuffer: frameCount must not be 0");
+    }
+}
+
+void MaterialBuffer::set(uint32_t materialId, const Material::Parameters &parameters)
+{
+    if (this->parameters.size() <= materialId) {
+        this->parameters.resize(materialId + 1, Material::Parameters{});
+        pending.resize(materialId + 1, false);
+    }
+    this->parameters[materialId] = parameters;
+
+    if (!pending[materialId]) {
+        pending[materialId] = true;
+        pendingIds.push_back(materialId);
+    }
+}
+
+bool MaterialBuffer::update(uint32_t frameIndex, VkCommandBuffer commandBuffer, uint64_t frame, uint64_t retiredFrame)
+{
+    auto retired = std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), [retiredFrame](const auto &r) {
+        return r.first <= retiredFrame;
+    });
+    retiredBuffers.erase(retired, retiredBuffers.end());
+
+    const size_t entrySize = sizeof(Material::Parameters);
+    if (buffer->getSize() < parameters.size() * entrySize) {
+        size_t capacity = std::max(parameters.size(), 2 * buffer->getSize() / entrySize);
+        // frames still in flight read the old buffer
+        retiredBuffers.emplace_back(frame, std::move(buffer));
+        buffer = createBuffer(capacity);
+        spdlog::info("MaterialBuffer: resized to {} materials", capacity);
+
+        std::fill(pending.begin(), pending.end(), false);
+        lastUpdateCount = parameters.size();
+        pendingIds.clear();
+        return true;
+    }
+
+    lastUpdateCount = pendingIds.size();
+    if (pendingIds.empty()) {
+        return false;
+    }
+
+    std::unique_ptr<MappedBuffer> &staging = stagingBuffers.at(frameIndex);
+    if (!staging || staging->getSize() < pendingIds.size() * entrySize) {
+        staging = std::make_unique<MappedBuffer>(
+            allocator,
+            std::max(pendingIds.size(), parameters.size()) * entrySize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+        );
+    }
+
+    // sorted, so that runs of adjacent ids are copied as one region
+    std::sort(pendingIds.begin(), pendingIds.end());
+    Material::Parameters *staged = reinterpret_cast<Material::Parameters *>(staging->getData());
+    std::vector<VkBufferCopy> regions;
+    for (size_t i = 0; i < pendingIds.size(); ++i) {
+        uint32_t id = pendingIds[i];
+        staged[i] = parameters[id];
+        pending[id] = false;
+
+        VkDeviceSize srcOffset = i * entrySize;
+        VkDeviceSize dstOffset = id * entrySize;
+        if (!regions.empty()
+            && regions.back().srcOffset + regions.back().size == srcOffset
+            && regions.back().dstOffset + regions.back().size == dstOffset
+        ) {
+            regions.back().size += entrySize;
+        }
+        else {
+            regions.push_back(VkBufferCopy{srcOffset, dstOffset, entrySize});
+        }
+    }
+    pendingIds.clear();
+
+    recordCopy(commandBuffer, *staging, regions);
+    return false;
+}
+
+VkDescriptorBufferInfo MaterialBuffer::getDescriptorBufferInfo() const
+{
+    return VkDescriptorBufferInfo{
+        .buffer = buffer->getHandle(),
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+}
+
+size_t MaterialBuffer::getLastUpdateCount() const
+{
+    return lastUpdateCount;
+}
+
+std::unique_ptr<Buffer> MaterialBuffer::createBuffer(size_t capacity)
+{
+    // uploaded with all current entries, nothing is pending afterwards
+    std::vector<Material::Parameters> data(capacity, Material::Parameters{});
+    std::copy(parameters.begin(), parameters.end(), data.begin());
+    return std::make_unique<Buffer>(
+        allocator,
+        static_cast<void *>(data.data()),
+        capacity * sizeof(Material::Parameters),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+}
+
+void MaterialBuffer::recordCopy(
+    VkCommandBuffer commandBuffer,
+    MappedBuffer &staging,
+    const std::vector<VkBufferCopy> &regions
+)
+{
+    // the entries may still be read by earlier frames
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        0, nullptr
+    );
+
+    vkCmdCopyBuffer(
+        commandBuffer,
+        staging.getHandle(),
+        buffer->getHandle(),
+        static_cast<uint32_t>(regions.size()),
+        regions.data()
+    );
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer->getHandle();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        1, &barrier,
+        0, nullptr
+    );
+}
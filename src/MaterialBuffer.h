@@ -0,0 +1,50 @@
+#ifndef MATERIALBUFFER_H_
+#define MATERIALBUFFER_H_
+
+#include "Buffer.h"
+#include "MappedBuffer.h"
+#include "Material.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class DeviceAllocator;
+
+// Device local storage buffer of Material::Parameters indexed by material id, shared by all frames.
+// Changed entries are staged in a host visible buffer of the recording frame and copied while recording.
+class MaterialBuffer
+{
+public:
+    MaterialBuffer(DeviceAllocator &allocator, uint32_t frameCount, size_t initialCapacity = 256);
+    MaterialBuffer(const MaterialBuffer &) = delete;
+    ~MaterialBuffer() = default;
+
+    void set(uint32_t materialId, const Material::Parameters &parameters);
+    // records the copy of the pending entries into commandBuffer, outside of a render pass, using the staging
+    // buffer of the frame, whose fence must have been waited on; frame is the number of the recorded frame,
+    // retiredFrame the last one that finished.
+    // returns true if the buffer had to be recreated to grow, then descriptors referring to it are outdated
+    bool update(uint32_t frameIndex, VkCommandBuffer commandBuffer, uint64_t frame, uint64_t retiredFrame);
+    VkDescriptorBufferInfo getDescriptorBufferInfo() const;
+    // number of entries written by the last update, for statistics
+    size_t getLastUpdateCount() const;
+private:
+    std::unique_ptr<Buffer> createBuffer(size_t capacity);
+    void recordCopy(VkCommandBuffer commandBuffer, MappedBuffer &staging, const std::vector<VkBufferCopy> &regions);
+
+    DeviceAllocator &allocator;
+    std::vector<Material::Parameters> parameters;
+    std::vector<bool> pending;
+    std::vector<uint32_t> pendingIds;
+    std::unique_ptr<Buffer> buffer;
+    // replaced buffers, kept until the frames that may still read them have finished
+    std::vector<std::pair<uint64_t, std::unique_ptr<Buffer>>> retiredBuffers;
+    std::vector<std::unique_ptr<MappedBuffer>> stagingBuffers;
+    size_t lastUpdateCount = 0;
+};
+
+#endif
@@ -1,67 +1,194 @@
 #include "Mesh.h"
+#include "MeshFile.h"
 #include "Utility.h"
+#include <algorithm>
+#include <cstring>
+#include <glm/common.hpp>
 #include <glm/detail/qualifier.hpp>
+#include <glm/ext/matrix_transform.hpp>
 #include <glm/fwd.hpp>
 #include <glm/geometric.hpp>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
+namespace
+{
+	// avoids divisions by zero for flat bounds
+	glm::vec3 getQuantizationScale(const glm::vec3 &extent)
+	{
+		return glm::vec3(
+			extent.x > 0.f ? extent.x : 1.f,
+			extent.y > 0.f ? extent.y : 1.f,
+			extent.z > 0.f ? extent.z : 1.f
+		);
+	}
+}
+
+Mesh::Mesh(
+	std::vector<Vertex> vertices,
+	std::vector<IndexType> indices,
+	std::vector<const MaterialResource *> materials,
+	VertexFormat vertexFormat,
+	std::vector<Lod> lods,
+	std::vector<Meshlet> meshlets,
+	std::vector<Submesh> submeshes
+)
+	: materials(std::move(materials)),
+	vertexFormat(vertexFormat),
+	vertexCount(static_cast<uint32_t>(vertices.size())),
+	indexCount(static_cast<uint32_t>(indices.size())),
+	lods(std::move(lods)),
+	meshlets(std::move(meshlets)),
+	submeshes(std::move(submeshes))
+{
+	if (this->lods.empty()) {
+		this->lods.push_back(Lod{0, indexCount, 0.f});
+	}
+	updateSubmeshes();
+	updateBounds(vertices);
+	encodeVertices(vertices);
+	encodeIndices(indices);
+}
+
+Mesh::Mesh(std::shared_ptr<const MeshFile> file, std::vector<const MaterialResource *> materials)
+	: materials(std::move(materials)),
+	file(std::move(file))
+{
+	const auto &header = this->file->getHeader();
+	vertexFormat = static_cast<VertexFormat>(header.vertexFormat);
+	indexType = header.indexStride == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	vertexCount = header.vertexCount;
+	indexCount = header.indexCount;
+	boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	uvTransform = glm::vec4(header.uvTransform[0], header.uvTransform[1], header.uvTransform[2], header.uvTransform[3]);
+	lods.assign(this->file->getLods(), this->file->getLods() + header.lodCount);
+	meshlets.assign(this->file->getMeshlets(), this->file->getMeshlets() + header.meshletCount);
+	submeshes.assign(this->file->getSubmeshes(), this->file->getSubmeshes() + header.submeshCount);
+	updateSubmeshes();
+}
 
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<IndexType> indices, const MaterialResource *material)
-	: material(material),
-	vertices(std::move(vertices)),
-	indices(std::move(indices))
+const std::vector<const MaterialResource *> &Mesh::getMaterials() const
 {
+	return materials;
 }
 
+VertexFormat Mesh::getVertexFormat() const
+{
+	return vertexFormat;
+}
 
-const MaterialResource *Mesh::getMaterial() const
+uint32_t Mesh::getVertexStride() const
 {
-	return material;
+	return getVertexStride(vertexFormat);
 }
 
-const std::vector<Vertex> &Mesh::getVertexData() const
+const std::byte *Mesh::getVertexData() const
 {
-    return vertices;
+	if (file) {
+		return file->getVertexData();
+	}
+    return vertexData.data();
 }
 
 size_t Mesh::getVertexDataSize() const
 {
-	return vertices.size() * sizeof(vertices[0]);
+	return static_cast<size_t>(vertexCount) * getVertexStride();
 }
 
 uint32_t Mesh::getVertexCount() const
 {
-	return vertices.size();
+	return vertexCount;
 }
 
-const std::vector<Mesh::IndexType> &Mesh::getIndexData() const
+const std::byte *Mesh::getIndexData() const
 {
-    return indices;
+	if (file) {
+		return file->getIndexData();
+	}
+    return indexData.data();
 }
 
 size_t Mesh::getIndexDataSize() const
 {
-	return indices.size() * sizeof(indices[0]);
+	return static_cast<size_t>(indexCount) * getIndexStride(indexType);
 }
 
 uint32_t Mesh::getIndexCount() const
 {
-	return indices.size();
+	return indexCount;
 }
 
 
 VkIndexType Mesh::getIndexType() const
 {
-	return VK_INDEX_TYPE_UINT32;
+	return indexType;
+}
+
+const std::vector<Mesh::Lod> &Mesh::getLods() const
+{
+	return lods;
+}
+
+const std::vector<Mesh::Meshlet> &Mesh::getMeshlets() const
+{
+	return meshlets;
+}
+
+const std::vector<Mesh::Submesh> &Mesh::getSubmeshes() const
+{
+	return submeshes;
+}
+
+const glm::vec3 &Mesh::getBoundsMin() const
+{
+	return boundsMin;
+}
+
+const glm::vec3 &Mesh::getBoundsMax() const
+{
+	return boundsMax;
+}
+
+glm::mat4 Mesh::getPositionTransform() const
+{
+	if (vertexFormat != VertexFormat::COMPRESSED) {
+		return glm::mat4(1.f);
+	}
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 scale = getQuantizationScale((boundsMax - boundsMin) * 0.5f);
+	return glm::scale(glm::translate(glm::mat4(1.f), center), scale);
+}
+
+const glm::vec4 &Mesh::getUvTransform() const
+{
+	return uvTransform;
+}
+
+uint32_t Mesh::getVertexStride(VertexFormat vertexFormat)
+{
+	switch (vertexFormat) {
+	case VertexFormat::STANDARD:
+		return sizeof(Vertex);
+	case VertexFormat::COMPRESSED:
+		return sizeof(CompressedVertex);
+	}
+	throw std::invalid_argument(fmt::format("Mesh: unknown vertex format {}", static_cast<uint32_t>(vertexFormat)));
+}
+
+uint32_t Mesh::getIndexStride(VkIndexType indexType)
+{
+	return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
 }
 
 Mesh Mesh::createRegularPolygon(float r, uint32_t edges, glm::vec3 offset)
 {
-    Mesh mesh;
-	mesh.vertices.reserve(edges + 1);
-	mesh.indices.reserve(edges * 3);
+	std::vector<Vertex> vertices;
+	std::vector<IndexType> indices;
+	vertices.reserve(edges + 1);
+	indices.reserve(edges * 3);
 
 	for (uint32_t i = 0; i < edges; ++i) {
 		float phi = 2 * 3.1415926f / edges * i;
@@ -74,26 +201,25 @@ Mesh Mesh::createRegularPolygon(float r, uint32_t edges, glm::vec3 offset)
 			.color = Utility::colorFromHsl(360.f / edges * i, 1.f, 0.5f),
 			.uv = { 0.f, 0.f },
 		};
-		mesh.vertices.push_back(v);
-		mesh.indices.push_back(edges);
-		mesh.indices.push_back(i);
-		mesh.indices.push_back((i + 1) % edges);
+		vertices.push_back(v);
+		indices.push_back(edges);
+		indices.push_back(i);
+		indices.push_back((i + 1) % edges);
 	}
-	mesh.vertices.emplace_back(Vertex{
+	vertices.emplace_back(Vertex{
 		.position = offset, 
 		.normal = { 0.f, 1.f, 0.f },
 		.color = { 0.f, 0.f, 0.f },
 		.uv = { 0.f, 0.f },
 	});
 
-    return mesh;
+    return Mesh(std::move(vertices), std::move(indices));
 }
 
 Mesh Mesh::createPlane(glm::vec3 a, glm::vec3 b, glm::vec3 offset)
 {
-	Mesh mesh;
 	glm::vec3 normal = glm::normalize(glm::cross(a, b));
-	mesh.vertices = {
+	std::vector<Vertex> vertices = {
 		{
 			.position = offset,
 			.normal = normal,
@@ -119,16 +245,15 @@ Mesh Mesh::createPlane(glm::vec3 a, glm::vec3 b, glm::vec3 offset)
 			.uv = { 0.f, 1.f },
 		},
 	};
-	mesh.indices = { 0, 1, 2, 2, 3, 0};
+	std::vector<IndexType> indices = { 0, 1, 2, 2, 3, 0};
 
-	return mesh;
+	return Mesh(std::move(vertices), std::move(indices));
 }
 
 Mesh Mesh::createTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 offset)
 {
-	Mesh mesh;
 	glm::vec3 normal = glm::normalize(glm::cross(a, b));
-	mesh.vertices = {
+	std::vector<Vertex> vertices = {
 		{
 			.position = offset,
 			.normal = normal,
@@ -148,15 +273,14 @@ Mesh Mesh::createTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 offset)
 			.uv = { 1.f, 1.f },
 		},
 	};
-	mesh.indices = { 0, 1, 2 };
+	std::vector<IndexType> indices = { 0, 1, 2 };
 
-	return mesh;
+	return Mesh(std::move(vertices), std::move(indices));
 }
 
 Mesh Mesh::createUnitCube()
 {
-	Mesh mesh;
-	mesh.vertices = {
+	std::vector<Vertex> vertices = {
         { .position = { -0.5f, -0.5f, -0.5f },  .normal = {0.f, 0.f, -1.f}, .uv = { 0.0f, 0.0f } },
         { .position = { 0.5f, -0.5f, -0.5f }, .normal = {0.f, 0.f, -1.f}, .uv = { 1.0f, 0.0f } },
         { .position = { 0.5f,  0.5f, -0.5f }, .normal = {0.f, 0.f, -1.f}, .uv = { 1.0f, 1.0f } },
@@ -187,7 +311,7 @@ Mesh Mesh::createUnitCube()
         { .position = { 0.5f,  0.5f,  0.5f }, .normal = {0.f, 1.f, 0.f}, .uv = { 1.0f, 0.0f } },
         { .position = { -0.5f,  0.5f,  0.5f }, .normal = {0.f, 1.f, 0.f}, .uv = { 0.0f, 0.0f } },
     };
-	mesh.indices = {
+	std::vector<IndexType> indices = {
 		0, 1, 2, 2, 3, 0, 
 		4, 5, 6, 6, 7, 4, 
 		8, 9, 10, 10, 11, 8, 
@@ -196,5 +320,90 @@ Mesh Mesh::createUnitCube()
 		20, 21, 22, 22, 23, 20,
 	};
 
-	return mesh;
+	return Mesh(std::move(vertices), std::move(indices));
+}
+
+void Mesh::updateSubmeshes()
+{
+	if (materials.empty()) {
+		materials.push_back(nullptr);
+	}
+	if (!submeshes.empty()) {
+		return;
+	}
+	for (uint32_t i = 0; i < lods.size(); ++i) {
+		submeshes.push_back(Submesh{
+			.lod = i,
+			.material = 0,
+			.indexOffset = lods[i].indexOffset,
+			.indexCount = lods[i].indexCount,
+			.meshletOffset = 0,
+			.meshletCount = i == 0 ? static_cast<uint32_t>(meshlets.size()) : 0,
+		});
+	}
+}
+
+void Mesh::updateBounds(const std::vector<Vertex> &vertices)
+{
+	if (vertices.empty()) {
+		boundsMin = glm::vec3(0.f);
+		boundsMax = glm::vec3(0.f);
+		return;
+	}
+
+	boundsMin = vertices[0].position;
+	boundsMax = vertices[0].position;
+	for (const auto &vertex : vertices) {
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+}
+
+void Mesh::encodeVertices(const std::vector<Vertex> &vertices)
+{
+	if (vertexFormat == VertexFormat::STANDARD) {
+		vertexData.resize(vertices.size() * sizeof(Vertex));
+		std::memcpy(vertexData.data(), vertices.data(), vertexData.size());
+		return;
+	}
+
+	glm::vec2 uvMin(0.f);
+	glm::vec2 uvMax(1.f);
+	if (!vertices.empty()) {
+		uvMin = vertices[0].uv;
+		uvMax = vertices[0].uv;
+		for (const auto &vertex : vertices) {
+			uvMin = glm::min(uvMin, vertex.uv);
+			uvMax = glm::max(uvMax, vertex.uv);
+		}
+	}
+	glm::vec2 uvExtent = uvMax - uvMin;
+	glm::vec2 uvScale(uvExtent.x > 0.f ? uvExtent.x : 1.f, uvExtent.y > 0.f ? uvExtent.y : 1.f);
+	uvTransform = glm::vec4(uvScale, uvMin);
+
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 scale = getQuantizationScale((boundsMax - boundsMin) * 0.5f);
+
+	std::vector<CompressedVertex> compressed;
+	compressed.reserve(vertices.size());
+	for (const auto &vertex : vertices) {
+		compressed.push_back(CompressedVertex::encode(vertex, center, scale, uvMin, uvScale));
+	}
+	vertexData.resize(compressed.size() * sizeof(CompressedVertex));
+	std::memcpy(vertexData.data(), compressed.data(), vertexData.size());
+}
+
+void Mesh::encodeIndices(const std::vector<IndexType> &indices)
+{
+	if (vertexCount >= SHORT_INDEX_VERTEX_LIMIT) {
+		indexType = VK_INDEX_TYPE_UINT32;
+		indexData.resize(indices.size() * sizeof(IndexType));
+		std::memcpy(indexData.data(), indices.data(), indexData.size());
+		return;
+	}
+
+	indexType = VK_INDEX_TYPE_UINT16;
+	std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+	indexData.resize(shortIndices.size() * sizeof(uint16_t));
+	std::memcpy(indexData.data(), shortIndices.data(), indexData.size());
 }
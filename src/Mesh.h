@@ -4,37 +4,129 @@
 #include "Resource.h"
 #include "Vertex.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <glm/fwd.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+class MeshFile;
+
 class Mesh
 {
 public:
     typedef uint32_t IndexType;
+    // meshes with fewer vertices than this are stored with 16 bit indices
+    static constexpr uint32_t SHORT_INDEX_VERTEX_LIMIT = 65536;
+
+    // range of the index buffer drawing one level of detail, level 0 being the full mesh
+    struct Lod
+    {
+        uint32_t indexOffset;
+        uint32_t indexCount;
+        // upper bound of the geometric deviation from the full mesh in model space
+        float error;
+    };
+
+    // cluster of triangles of the first level of detail, stored as a contiguous index range
+    struct Meshlet
+    {
+        uint32_t indexOffset;
+        uint32_t indexCount;
+        // bounding sphere in model space
+        glm::vec3 center;
+        float radius;
+        // all triangles face away from the camera if
+        // dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+        glm::vec3 coneAxis;
+        float coneCutoff;
+    };
+
+    // index range of one level of detail drawn with one material; the submeshes of a level
+    // are stored next to each other and together cover the range of the level
+    struct Submesh
+    {
+        uint32_t lod;
+        // slot in getMaterials()
+        uint32_t material;
+        uint32_t indexOffset;
+        uint32_t indexCount;
+        // meshlets covering the index range, only present on the first level of detail
+        uint32_t meshletOffset;
+        uint32_t meshletCount;
+    };
 
     Mesh() = default;
-    Mesh(std::vector<Vertex> vertices, std::vector<IndexType> indices, const MaterialResource *material = nullptr);
+    // without submeshes, every level of detail is drawn with the first material
+    Mesh(
+        std::vector<Vertex> vertices,
+        std::vector<IndexType> indices,
+        std::vector<const MaterialResource *> materials = {},
+        VertexFormat vertexFormat = VertexFormat::STANDARD,
+        std::vector<Lod> lods = {},
+        std::vector<Meshlet> meshlets = {},
+        std::vector<Submesh> submeshes = {}
+    );
+    // vertex and index data stay in the mapped file and are never copied into vectors
+    Mesh(std::shared_ptr<const MeshFile> file, std::vector<const MaterialResource *> materials = {});
+    Mesh(const Mesh &) = delete;
+    Mesh(Mesh &&) = default;
     ~Mesh() = default;
 
-    const MaterialResource *getMaterial() const;
-    const std::vector<Vertex> &getVertexData() const;
+    Mesh &operator =(Mesh &&) = default;
+
+    // there is always at least one slot, which is nullptr for meshes without materials
+    const std::vector<const MaterialResource *> &getMaterials() const;
+    VertexFormat getVertexFormat() const;
+    uint32_t getVertexStride() const;
+    const std::byte *getVertexData() const;
     size_t getVertexDataSize() const;
     uint32_t getVertexCount() const;
-    const std::vector<IndexType> &getIndexData() const;
+    const std::byte *getIndexData() const;
     size_t getIndexDataSize() const;
     uint32_t getIndexCount() const;
     VkIndexType getIndexType() const;
+    const std::vector<Lod> &getLods() const;
+    const std::vector<Meshlet> &getMeshlets() const;
+    const std::vector<Submesh> &getSubmeshes() const;
+    const glm::vec3 &getBoundsMin() const;
+    const glm::vec3 &getBoundsMax() const;
+    // maps stored positions to model space; identity unless the vertices are compressed
+    glm::mat4 getPositionTransform() const;
+    // uv = stored uv * xy + zw
+    const glm::vec4 &getUvTransform() const;
+
+    static uint32_t getVertexStride(VertexFormat vertexFormat);
+    static uint32_t getIndexStride(VkIndexType indexType);
 
     static Mesh createRegularPolygon(float r, uint32_t edges, glm::vec3 offset = glm::vec3(0.f));
     static Mesh createPlane(glm::vec3 a, glm::vec3 b, glm::vec3 offset = glm::vec3(0.f));
     static Mesh createTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 offset = glm::vec3(0.f));
     static Mesh createUnitCube();
 private:
-    const MaterialResource *material;
-    std::vector<Vertex> vertices;
-    std::vector<IndexType> indices;
+    void updateBounds(const std::vector<Vertex> &vertices);
+    void encodeVertices(const std::vector<Vertex> &vertices);
+    void encodeIndices(const std::vector<IndexType> &indices);
+    void updateSubmeshes();
+
+    std::vector<const MaterialResource *> materials;
+    VertexFormat vertexFormat = VertexFormat::STANDARD;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    std::vector<Lod> lods;
+    std::vector<Meshlet> meshlets;
+    std::vector<Submesh> submeshes;
+    std::vector<std::byte> vertexData;
+    std::vector<std::byte> indexData;
+    std::shared_ptr<const MeshFile> file;
+    glm::vec3 boundsMin{0.f};
+    glm::vec3 boundsMax{0.f};
+    glm::vec4 uvTransform{1.f, 1.f, 0.f, 0.f};
 };
 
 #endif
@@ -0,0 +1,42 @@
+#include "MeshBuffer.h"
+#include "Mesh.h"
+
+#include <memory>
+#include <vulkan/vulkan_core.h>
+
+MeshBuffer::MeshBuffer(DeviceAllocator &allocator, const Mesh &mesh)
+    : vertexBuffer(
+        allocator,
+        (void *) mesh.getVertexData(),
+        mesh.getVertexDataSize(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+    ),
+    indexBuffer(
+        mesh.getIndexCount() > 0
+        ? std::make_unique<Buffer>(
+            allocator,
+            (void *) mesh.getIndexData(),
+            mesh.getIndexDataSize(),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+        : nullptr
+    ),
+    indexType(mesh.getIndexType())
+{
+}
+
+
+size_t MeshBuffer::getSize() const
+{
+    return vertexBuffer.getSize() + (indexBuffer ? indexBuffer->getSize() : 0);
+}
+
+void MeshBuffer::bind(VkCommandBuffer commandBuffer) const
+{
+    VkBuffer vertexBuffers[] = {vertexBuffer.getHandle()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+    if (indexBuffer) {
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getHandle(), 0, indexType);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef MESHBUFFER_H_
+#define MESHBUFFER_H_
+
+#include "Buffer.h"
+#include "DeviceAllocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <vulkan/vulkan_core.h>
+
+class Mesh;
+
+// device local vertex and index buffer of one mesh, shared by all objects drawing it
+class MeshBuffer
+{
+public:
+    MeshBuffer(DeviceAllocator &allocator, const Mesh &mesh);
+    MeshBuffer(const MeshBuffer &) = delete;
+    MeshBuffer(MeshBuffer &&) = default;
+    ~MeshBuffer() = default;
+
+    size_t getSize() const;
+    // binds the index buffer too if the mesh has one
+    void bind(VkCommandBuffer commandBuffer) const;
+private:
+    Buffer vertexBuffer;
+    std::unique_ptr<Buffer> indexBuffer;
+    VkIndexType indexType;
+};
+
+#endif
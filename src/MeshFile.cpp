@@ -0,0 +1,295 @@
+#include "MeshFile.h"
+#include "Mesh.h"
+#include "Vertex.h"
+
+#include <cstring>
+#include <fstream>
+#include <spdlog/fmt/fmt.h>
+#include <stdexcept>
+#include <system_error>
+
+namespace
+{
+    struct SourceStamp
+    {
+        uint64_t size;
+        int64_t modificationTime;
+    };
+
+    SourceStamp getSourceStamp(const std::filesystem::path &source)
+    {
+        return SourceStamp{
+            .size = static_cast<uint64_t>(std::filesystem::file_size(source)),
+            .modificationTime = static_cast<int64_t>(
+                std::filesystem::last_write_time(source).time_since_epoch().count()
+            ),
+        };
+    }
+
+    uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + MeshFile::BLOB_ALIGNMENT - 1) / MeshFile::BLOB_ALIGNMENT * MeshFile::BLOB_ALIGNMENT;
+    }
+
+    void writePadding(std::ofstream &file, uint64_t targetOffset)
+    {
+        static const char zeros[MeshFile::BLOB_ALIGNMENT] = {};
+        uint64_t offset = static_cast<uint64_t>(file.tellp());
+        file.write(zeros, static_cast<std::streamsize>(targetOffset - offset));
+    }
+}
+
+MeshFile::MeshFile(const std::filesystem::path &path)
+    : mapping(std::make_shared<const MappedFile>(path)),
+    data(mapping->getData()),
+    size(mapping->getSize()),
+    header(reinterpret_cast<const Header *>(data))
+{
+    validate();
+}
+
+MeshFile::MeshFile(std::shared_ptr<const MappedFile> mapping, uint64_t offset, uint64_t size)
+    : mapping(std::move(mapping)),
+    data(this->mapping->getData() + offset),
+    size(static_cast<size_t>(size)),
+    header(reinterpret_cast<const Header *>(data))
+{
+    if (offset > this->mapping->getSize() || size > this->mapping->getSize() - offset) {
+        throw std::runtime_error(fmt::format(
+            "MeshFile {}: range exceeds file size", this->mapping->getPath().string()
+        ));
+    }
+    validate();
+}
+
+
+const MeshFile::Header &MeshFile::getHeader() const
+{
+    return *header;
+}
+
+const MeshFile::MaterialRecord *MeshFile::getMaterialRecords() const
+{
+    return reinterpret_cast<const MaterialRecord *>(data + header->materialOffset);
+}
+
+const Mesh::Lod *MeshFile::getLods() const
+{
+    return reinterpret_cast<const Mesh::Lod *>(data + header->lodOffset);
+}
+
+const Mesh::Meshlet *MeshFile::getMeshlets() const
+{
+    return reinterpret_cast<const Mesh::Meshlet *>(data + header->meshletOffset);
+}
+
+const Mesh::Submesh *MeshFile::getSubmeshes() const
+{
+    return reinterpret_cast<const Mesh::Submesh *>(data + header->submeshOffset);
+}
+
+const std::byte *MeshFile::getVertexData() const
+{
+    return data + header->vertexOffset;
+}
+
+size_t MeshFile::getVertexDataSize() const
+{
+    return static_cast<size_t>(header->vertexCount) * header->vertexStride;
+}
+
+const std::byte *MeshFile::getIndexData() const
+{
+    return data + header->indexOffset;
+}
+
+size_t MeshFile::getIndexDataSize() const
+{
+    return static_cast<size_t>(header->indexCount) * header->indexStride;
+}
+
+bool MeshFile::isUpToDate(const std::filesystem::path &source, uint64_t importSettings) const
+{
+    if (header->importSettings != importSettings) {
+        return false;
+    }
+
+    std::error_code error;
+    if (!std::filesystem::exists(source, error)) {
+        // nothing to compare against, the cache is all there is
+        return true;
+    }
+    SourceStamp stamp = getSourceStamp(source);
+    return stamp.size == header->sourceSize && stamp.modificationTime == header->sourceModificationTime;
+}
+
+std::filesystem::path MeshFile::getCachePath(const std::filesystem::path &source)
+{
+    std::filesystem::path cachePath = source;
+    cachePath.replace_extension(EXTENSION);
+    return cachePath;
+}
+
+void MeshFile::write(
+    const std::filesystem::path &path,
+    const std::filesystem::path &source,
+    const Mesh &mesh,
+    const std::vector<MaterialRecord> &materials,
+    uint64_t importSettings
+)
+{
+    SourceStamp stamp = getSourceStamp(source);
+
+    Header header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.sourceSize = stamp.size;
+    header.sourceModificationTime = stamp.modificationTime;
+    header.importSettings = importSettings;
+    header.vertexFormat = static_cast<uint32_t>(mesh.getVertexFormat());
+    header.vertexStride = mesh.getVertexStride();
+    header.vertexCount = mesh.getVertexCount();
+    header.indexStride = Mesh::getIndexStride(mesh.getIndexType());
+    header.indexCount = mesh.getIndexCount();
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = mesh.getBoundsMin()[i];
+        header.boundsMax[i] = mesh.getBoundsMax()[i];
+    }
+    for (int i = 0; i < 4; ++i) {
+        header.uvTransform[i] = mesh.getUvTransform()[i];
+    }
+    header.materialCount = static_cast<uint32_t>(materials.size());
+    header.lodCount = static_cast<uint32_t>(mesh.getLods().size());
+    header.materialOffset = alignOffset(sizeof(Header));
+    header.lodOffset = alignOffset(header.materialOffset + materials.size() * sizeof(MaterialRecord));
+    header.meshletCount = static_cast<uint32_t>(mesh.getMeshlets().size());
+    header.meshletOffset = alignOffset(header.lodOffset + mesh.getLods().size() * sizeof(Mesh::Lod));
+    header.submeshCount = static_cast<uint32_t>(mesh.getSubmeshes().size());
+    header.submeshOffset = alignOffset(header.meshletOffset + mesh.getMeshlets().size() * sizeof(Mesh::Meshlet));
+    header.vertexOffset = alignOffset(header.submeshOffset + mesh.getSubmeshes().size() * sizeof(Mesh::Submesh));
+    header.indexOffset = alignOffset(header.vertexOffset + mesh.getVertexDataSize());
+
+    // write to a temporary file first so that a crash never leaves a truncated cache behind
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error(fmt::format("MeshFile: could not open {} for writing", temporaryPath.string()));
+        }
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writePadding(file, header.materialOffset);
+        file.write(
+            reinterpret_cast<const char *>(materials.data()),
+            static_cast<std::streamsize>(materials.size() * sizeof(MaterialRecord))
+        );
+        writePadding(file, header.lodOffset);
+        file.write(
+            reinterpret_cast<const char *>(mesh.getLods().data()),
+            static_cast<std::streamsize>(mesh.getLods().size() * sizeof(Mesh::Lod))
+        );
+        writePadding(file, header.meshletOffset);
+        file.write(
+            reinterpret_cast<const char *>(mesh.getMeshlets().data()),
+            static_cast<std::streamsize>(mesh.getMeshlets().size() * sizeof(Mesh::Meshlet))
+        );
+        writePadding(file, header.submeshOffset);
+        file.write(
+            reinterpret_cast<const char *>(mesh.getSubmeshes().data()),
+            static_cast<std::streamsize>(mesh.getSubmeshes().size() * sizeof(Mesh::Submesh))
+        );
+        writePadding(file, header.vertexOffset);
+        file.write(
+            reinterpret_cast<const char *>(mesh.getVertexData()),
+            static_cast<std::streamsize>(mesh.getVertexDataSize())
+        );
+        writePadding(file, header.indexOffset);
+        file.write(
+            reinterpret_cast<const char *>(mesh.getIndexData()),
+            static_cast<std::streamsize>(mesh.getIndexDataSize())
+        );
+
+        if (!file) {
+            throw std::runtime_error(fmt::format("MeshFile: writing {} failed", temporaryPath.string()));
+        }
+    }
+    std::filesystem::rename(temporaryPath, path);
+}
+
+void MeshFile::copyName(char (&destination)[NAME_LENGTH], const std::string &name)
+{
+    if (name.size() >= NAME_LENGTH) {
+        throw std::length_error(fmt::format(
+            "MeshFile: name '{}' exceeds {} characters", name, NAME_LENGTH - 1
+        ));
+    }
+    std::memset(destination, 0, NAME_LENGTH);
+    std::memcpy(destination, name.data(), name.size());
+}
+
+void MeshFile::validate() const
+{
+    const std::string fileName = mapping->getPath().string();
+
+    if (size < sizeof(Header)) {
+        throw std::runtime_error(fmt::format("MeshFile {}: file too small", fileName));
+    }
+    if (header->magic != MAGIC) {
+        throw std::runtime_error(fmt::format("MeshFile {}: invalid magic number", fileName));
+    }
+    if (header->version != VERSION) {
+        throw std::runtime_error(fmt::format(
+            "MeshFile {}: version {} is not supported (expected {})", fileName, header->version, VERSION
+        ));
+    }
+    if (header->vertexFormat > static_cast<uint32_t>(VertexFormat::COMPRESSED)
+        || header->vertexStride != Mesh::getVertexStride(static_cast<VertexFormat>(header->vertexFormat))
+        || (header->indexStride != sizeof(uint16_t) && header->indexStride != sizeof(uint32_t))
+    ) {
+        throw std::runtime_error(fmt::format("MeshFile {}: incompatible vertex or index layout", fileName));
+    }
+    // offset + blobSize could wrap around
+    auto exceeds = [this](uint64_t offset, uint64_t blobSize) {
+        return offset > size || blobSize > size - offset;
+    };
+    if (exceeds(header->materialOffset, header->materialCount * sizeof(MaterialRecord))
+        || exceeds(header->lodOffset, header->lodCount * sizeof(Mesh::Lod))
+        || exceeds(header->meshletOffset, header->meshletCount * sizeof(Mesh::Meshlet))
+        || exceeds(header->submeshOffset, header->submeshCount * sizeof(Mesh::Submesh))
+        || exceeds(header->vertexOffset, getVertexDataSize())
+        || exceeds(header->indexOffset, getIndexDataSize())
+    ) {
+        throw std::runtime_error(fmt::format("MeshFile {}: blob exceeds file size", fileName));
+    }
+    if (header->lodOffset % BLOB_ALIGNMENT
+        || header->meshletOffset % BLOB_ALIGNMENT
+        || header->submeshOffset % BLOB_ALIGNMENT
+        || header->vertexOffset % BLOB_ALIGNMENT
+        || header->indexOffset % BLOB_ALIGNMENT
+    ) {
+        throw std::runtime_error(fmt::format("MeshFile {}: misaligned blob", fileName));
+    }
+    for (uint32_t i = 0; i < header->lodCount; ++i) {
+        const Mesh::Lod &lod = getLods()[i];
+        if (static_cast<uint64_t>(lod.indexOffset) + lod.indexCount > header->indexCount) {
+            throw std::runtime_error(fmt::format("MeshFile {}: level of detail {} exceeds index count", fileName, i));
+        }
+    }
+    for (uint32_t i = 0; i < header->meshletCount; ++i) {
+        const Mesh::Meshlet &meshlet = getMeshlets()[i];
+        if (static_cast<uint64_t>(meshlet.indexOffset) + meshlet.indexCount > header->indexCount) {
+            throw std::runtime_error(fmt::format("MeshFile {}: meshlet {} exceeds index count", fileName, i));
+        }
+    }
+    for (uint32_t i = 0; i < header->submeshCount; ++i) {
+        const Mesh::Submesh &submesh = getSubmeshes()[i];
+        if (static_cast<uint64_t>(submesh.indexOffset) + submesh.indexCount > header->indexCount
+            || submesh.lod >= header->lodCount
+            || (header->materialCount > 0 && submesh.material >= header->materialCount)
+            || static_cast<uint64_t>(submesh.meshletOffset) + submesh.meshletCount > header->meshletCount
+        ) {
+            throw std::runtime_error(fmt::format("MeshFile {}: submesh {} is out of range", fileName, i));
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef MESHFILE_H_
+#define MESHFILE_H_
+
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary mesh cache written after the first import of a mesh source file (e.g. .obj).
+// Layout: Header | MaterialRecord[materialCount] | Mesh::Lod[lodCount] | Mesh::Meshlet[meshletCount]
+// | Mesh::Submesh[submeshCount] | vertex blob | index blob,
+// every blob starting at a multiple of BLOB_ALIGNMENT.
+class MeshFile
+{
+public:
+    static constexpr uint32_t MAGIC = 0x4853454d; // "MESH"
+    static constexpr uint32_t VERSION = 6;
+    static constexpr size_t BLOB_ALIGNMENT = 16;
+    static constexpr size_t NAME_LENGTH = 64;
+    static constexpr const char *EXTENSION = ".meshbin";
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        // size and modification time of the source file, used to detect stale caches
+        uint64_t sourceSize;
+        int64_t sourceModificationTime;
+        // hash of the import settings the data was processed with, e.g. MeshOptimizer::Settings
+        uint64_t importSettings;
+        // VertexFormat of the vertex blob
+        uint32_t vertexFormat;
+        uint32_t vertexStride;
+        uint32_t vertexCount;
+        // 2 or 4 bytes
+        uint32_t indexStride;
+        uint32_t indexCount;
+        float boundsMin[3];
+        float boundsMax[3];
+        float uvTransform[4];
+        uint32_t materialCount;
+        uint64_t materialOffset;
+        uint32_t lodCount;
+        uint64_t lodOffset;
+        uint32_t meshletCount;
+        uint64_t meshletOffset;
+        uint32_t submeshCount;
+        uint64_t submeshOffset;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+    };
+
+    // everything needed to resolve (or recreate) a MaterialResource without parsing the source again
+    struct MaterialRecord
+    {
+        char name[NAME_LENGTH];
+        float ambient[3];
+        float diffuse[3];
+        float specular[3];
+        float shininess;
+        char ambientTexture[NAME_LENGTH];
+        char diffuseTexture[NAME_LENGTH];
+        char specularTexture[NAME_LENGTH];
+        char normalTexture[NAME_LENGTH];
+    };
+
+    MeshFile(const std::filesystem::path &path);
+    // a mesh file stored at offset within a larger mapping, e.g. an asset pack
+    MeshFile(std::shared_ptr<const MappedFile> mapping, uint64_t offset, uint64_t size);
+    MeshFile(const MeshFile &) = delete;
+    MeshFile(MeshFile &&) = default;
+    ~MeshFile() = default;
+
+    const Header &getHeader() const;
+    const MaterialRecord *getMaterialRecords() const;
+    const Mesh::Lod *getLods() const;
+    const Mesh::Meshlet *getMeshlets() const;
+    const Mesh::Submesh *getSubmeshes() const;
+    const std::byte *getVertexData() const;
+    size_t getVertexDataSize() const;
+    const std::byte *getIndexData() const;
+    size_t getIndexDataSize() const;
+    bool isUpToDate(const std::filesystem::path &source, uint64_t importSettings) const;
+
+    static std::filesystem::path getCachePath(const std::filesystem::path &source);
+    static void write(
+        const std::filesystem::path &path,
+        const std::filesystem::path &source,
+        const Mesh &mesh,
+        // one record per material slot of the mesh
+        const std::vector<MaterialRecord> &materials,
+        uint64_t importSettings
+    );
+    static void copyName(char (&destination)[NAME_LENGTH], const std::string &name);
+private:
+    void validate() const;
+
+    std::shared_ptr<const MappedFile> mapping;
+    const std::byte *data;
+    size_t size;
+    const Header *header;
+};
+
+#endif
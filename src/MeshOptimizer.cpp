@@ -0,0 +1,361 @@
+#include "MeshOptimizer.h"
+#include "Utility.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    constexpr Mesh::IndexType INVALID_INDEX = std::numeric_limits<Mesh::IndexType>::max();
+
+    // triangles adjacent to each vertex, stored as one flat array
+    struct Adjacency
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+        std::vector<uint32_t> liveCounts;
+
+        Adjacency(const std::vector<Mesh::IndexType> &indices, size_t vertexCount)
+            : offsets(vertexCount + 1, 0),
+            triangles(indices.size()),
+            liveCounts(vertexCount, 0)
+        {
+            for (Mesh::IndexType index : indices) {
+                ++liveCounts[index];
+            }
+            for (size_t v = 0; v < vertexCount; ++v) {
+                offsets[v + 1] = offsets[v] + liveCounts[v];
+            }
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+    };
+}
+
+bool MeshOptimizer::Settings::isEnabled() const
+{
+    return vertexCache || overdraw || vertexFetch;
+}
+
+uint64_t MeshOptimizer::Settings::getHash() const
+{
+    using namespace Utility;
+
+    size_t result = 0;
+    hash_combine(result, vertexCache);
+    hash_combine(result, overdraw);
+    hash_combine(result, vertexFetch);
+    hash_combine(result, cacheSize);
+    hash_combine(result, overdrawThreshold);
+    return result;
+}
+
+
+MeshOptimizer::MeshOptimizer(const Settings &settings)
+    : settings(settings)
+{
+}
+
+
+const MeshOptimizer::Settings &MeshOptimizer::getSettings() const
+{
+    return settings;
+}
+
+MeshOptimizer::Result MeshOptimizer::optimize(
+    std::vector<Vertex> &vertices,
+    std::vector<Mesh::IndexType> &indices
+) const
+{
+    Mesh::Submesh submesh{};
+    submesh.indexCount = static_cast<uint32_t>(indices.size());
+    return optimize(vertices, indices, {submesh});
+}
+
+MeshOptimizer::Result MeshOptimizer::optimize(
+    std::vector<Vertex> &vertices,
+    std::vector<Mesh::IndexType> &indices,
+    const std::vector<Mesh::Submesh> &submeshes
+) const
+{
+    auto firstLodIndices = [&]() {
+        std::vector<Mesh::IndexType> result;
+        for (const Mesh::Submesh &submesh : submeshes) {
+            if (submesh.lod == 0) {
+                auto begin = indices.begin() + submesh.indexOffset;
+                result.insert(result.end(), begin, begin + submesh.indexCount);
+            }
+        }
+        return result;
+    };
+
+    Result result;
+    result.before = analyzeVertexCache(firstLodIndices(), vertices.size(), settings.cacheSize);
+
+    if (settings.vertexCache || settings.overdraw) {
+        for (const Mesh::Submesh &submesh : submeshes) {
+            auto begin = indices.begin() + submesh.indexOffset;
+            std::vector<Mesh::IndexType> submeshIndices(begin, begin + submesh.indexCount);
+            optimizeIndexOrder(vertices, submeshIndices);
+            std::copy(submeshIndices.begin(), submeshIndices.end(), begin);
+        }
+    }
+    // all levels share the vertices of the first one, which therefore determines the order
+    if (settings.vertexFetch) {
+        optimizeVertexFetch(vertices, indices);
+    }
+
+    result.after = analyzeVertexCache(firstLodIndices(), vertices.size(), settings.cacheSize);
+    return result;
+}
+
+MeshOptimizer::Statistics MeshOptimizer::analyzeVertexCache(
+    const std::vector<Mesh::IndexType> &indices,
+    size_t vertexCount,
+    uint32_t cacheSize
+)
+{
+    Statistics statistics;
+    if (indices.empty() || vertexCount == 0) {
+        return statistics;
+    }
+
+    // simulated FIFO cache: a vertex is a hit if it was inserted within the last cacheSize misses
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (Mesh::IndexType index : indices) {
+        if (time - timestamps[index] > cacheSize) {
+            timestamps[index] = time++;
+            ++misses;
+        }
+        if (!used[index]) {
+            used[index] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    statistics.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return statistics;
+}
+
+void MeshOptimizer::optimizeIndexOrder(
+    const std::vector<Vertex> &vertices,
+    std::vector<Mesh::IndexType> &indices
+) const
+{
+    if (indices.empty()) {
+        return;
+    }
+
+    float originalAcmr = analyzeVertexCache(indices, vertices.size(), settings.cacheSize).acmr;
+    std::vector<size_t> clusters;
+    std::vector<Mesh::IndexType> cacheOptimized = optimizeVertexCache(indices, vertices.size(), clusters);
+    if (settings.overdraw) {
+        std::vector<Mesh::IndexType> overdrawOptimized = optimizeOverdraw(cacheOptimized, vertices, clusters);
+        float cacheAcmr = analyzeVertexCache(cacheOptimized, vertices.size(), settings.cacheSize).acmr;
+        float overdrawAcmr = analyzeVertexCache(overdrawOptimized, vertices.size(), settings.cacheSize).acmr;
+        if (overdrawAcmr <= cacheAcmr * settings.overdrawThreshold) {
+            cacheOptimized = std::move(overdrawOptimized);
+        }
+    }
+    // overdraw sorting alone keeps the Tipsify clusters, but never worsens the original order
+    if (settings.vertexCache
+        || analyzeVertexCache(cacheOptimized, vertices.size(), settings.cacheSize).acmr
+            <= originalAcmr * settings.overdrawThreshold
+    ) {
+        indices = std::move(cacheOptimized);
+    }
+}
+
+std::vector<Mesh::IndexType> MeshOptimizer::optimizeVertexCache(
+    const std::vector<Mesh::IndexType> &indices,
+    size_t vertexCount,
+    std::vector<size_t> &clusters
+) const
+{
+    const size_t triangleCount = indices.size() / 3;
+    const uint32_t cacheSize = settings.cacheSize;
+
+    Adjacency adjacency(indices, vertexCount);
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<Mesh::IndexType> deadEnds;
+    std::vector<Mesh::IndexType> candidates;
+    std::vector<Mesh::IndexType> result;
+    result.reserve(indices.size());
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    clusters.clear();
+
+    // vertex with live triangles from the dead end stack or, failing that, in input order
+    auto skipDeadEnd = [&]() -> Mesh::IndexType {
+        while (!deadEnds.empty()) {
+            Mesh::IndexType vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (adjacency.liveCounts[vertex] > 0) {
+                return vertex;
+            }
+        }
+        while (cursor < vertexCount) {
+            if (adjacency.liveCounts[cursor] > 0) {
+                return static_cast<Mesh::IndexType>(cursor);
+            }
+            ++cursor;
+        }
+        return INVALID_INDEX;
+    };
+
+    Mesh::IndexType fanningVertex = skipDeadEnd();
+    while (fanningVertex != INVALID_INDEX) {
+        candidates.clear();
+
+        for (uint32_t i = adjacency.offsets[fanningVertex]; i < adjacency.offsets[fanningVertex + 1]; ++i) {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (size_t corner = 0; corner < 3; ++corner) {
+                Mesh::IndexType vertex = indices[3 * triangle + corner];
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --adjacency.liveCounts[vertex];
+                if (time - timestamps[vertex] > cacheSize) {
+                    timestamps[vertex] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // prefer the candidate that stays in the cache longest while all of its triangles are emitted
+        Mesh::IndexType nextVertex = INVALID_INDEX;
+        int bestPriority = -1;
+        for (Mesh::IndexType vertex : candidates) {
+            if (adjacency.liveCounts[vertex] == 0) {
+                continue;
+            }
+            int priority = 0;
+            if (time - timestamps[vertex] + 2 * adjacency.liveCounts[vertex] <= cacheSize) {
+                priority = static_cast<int>(time - timestamps[vertex]);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+        if (nextVertex == INVALID_INDEX) {
+            // the cache is cold from here on, which makes this a good cluster boundary for overdraw sorting
+            nextVertex = skipDeadEnd();
+            if (nextVertex != INVALID_INDEX) {
+                clusters.push_back(result.size() / 3);
+            }
+        }
+        fanningVertex = nextVertex;
+    }
+
+    if (clusters.empty() || clusters.front() != 0) {
+        clusters.insert(clusters.begin(), 0);
+    }
+    return result;
+}
+
+std::vector<Mesh::IndexType> MeshOptimizer::optimizeOverdraw(
+    const std::vector<Mesh::IndexType> &indices,
+    const std::vector<Vertex> &vertices,
+    const std::vector<size_t> &clusters
+) const
+{
+    const size_t triangleCount = indices.size() / 3;
+
+    struct Cluster
+    {
+        size_t begin;
+        size_t end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float area;
+        float sortKey;
+    };
+
+    std::vector<Cluster> sortedClusters;
+    sortedClusters.reserve(clusters.size());
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        Cluster cluster{};
+        cluster.begin = clusters[i];
+        cluster.end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+        cluster.centroid = glm::vec3(0.f);
+        cluster.normal = glm::vec3(0.f);
+
+        for (size_t t = cluster.begin; t < cluster.end; ++t) {
+            const glm::vec3 &a = vertices[indices[3 * t]].position;
+            const glm::vec3 &b = vertices[indices[3 * t + 1]].position;
+            const glm::vec3 &c = vertices[indices[3 * t + 2]].position;
+            // front faces are clockwise, so this points outwards; its length is twice the area
+            glm::vec3 normal = glm::cross(c - a, b - a);
+            float area = glm::length(normal);
+
+            cluster.centroid += (a + b + c) * (area / 3.f);
+            cluster.normal += normal;
+            cluster.area += area;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += cluster.area;
+        if (cluster.area > 0.f) {
+            cluster.centroid /= cluster.area;
+        }
+        sortedClusters.push_back(cluster);
+    }
+    if (meshArea > 0.f) {
+        meshCentroid /= meshArea;
+    }
+
+    for (Cluster &cluster : sortedClusters) {
+        float normalLength = glm::length(cluster.normal);
+        glm::vec3 normal = normalLength > 0.f ? cluster.normal / normalLength : glm::vec3(0.f);
+        cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, normal);
+    }
+
+    // clusters facing away from the center are likely to occlude the rest of the mesh, so draw them first
+    std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster &a, const Cluster &b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<Mesh::IndexType> result;
+    result.reserve(indices.size());
+    for (const Cluster &cluster : sortedClusters) {
+        result.insert(result.end(), indices.begin() + 3 * cluster.begin, indices.begin() + 3 * cluster.end);
+    }
+    return result;
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<Mesh::IndexType> &indices) const
+{
+    std::vector<Mesh::IndexType> remap(vertices.size(), INVALID_INDEX);
+    std::vector<Vertex> newVertices;
+    newVertices.reserve(vertices.size());
+
+    // unreferenced vertices are dropped
+    for (Mesh::IndexType &index : indices) {
+        if (remap[index] == INVALID_INDEX) {
+            remap[index] = static_cast<Mesh::IndexType>(newVertices.size());
+            newVertices.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(newVertices);
+}
@@ -0,0 +1,83 @@
+#ifndef MESHOPTIMIZER_H_
+#define MESHOPTIMIZER_H_
+
+#include "Mesh.h"
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reorders imported index and vertex data so that the GPU does less work per draw:
+// 1. vertex cache: triangles are reordered with Tipsify (Sander et al. 2007)
+// 2. overdraw: the clusters produced by Tipsify are sorted so that outward-facing
+//    parts of the mesh are drawn first
+// 3. vertex fetch: vertices are stored in the order they are first referenced
+class MeshOptimizer
+{
+public:
+    struct Settings
+    {
+        bool vertexCache = true;
+        bool overdraw = true;
+        bool vertexFetch = true;
+        // number of post-transform cache entries that Tipsify optimizes for
+        uint32_t cacheSize = 16;
+        // the overdraw order is dropped if it makes the ACMR worse than this factor
+        float overdrawThreshold = 1.05f;
+
+        bool isEnabled() const;
+        uint64_t getHash() const;
+    };
+
+    struct Statistics
+    {
+        // average cache miss ratio: transformed vertices per triangle
+        float acmr = 0.f;
+        // average transform to vertex ratio: transformed vertices per unique vertex
+        float atvr = 0.f;
+    };
+
+    struct Result
+    {
+        Statistics before;
+        Statistics after;
+    };
+
+    MeshOptimizer(const Settings &settings);
+    MeshOptimizer(const MeshOptimizer &) = delete;
+    MeshOptimizer(MeshOptimizer &&) = default;
+    ~MeshOptimizer() = default;
+
+    const Settings &getSettings() const;
+    Result optimize(std::vector<Vertex> &vertices, std::vector<Mesh::IndexType> &indices) const;
+    // optimizes every submesh on its own, statistics refer to the first level of detail
+    Result optimize(
+        std::vector<Vertex> &vertices,
+        std::vector<Mesh::IndexType> &indices,
+        const std::vector<Mesh::Submesh> &submeshes
+    ) const;
+
+    static Statistics analyzeVertexCache(
+        const std::vector<Mesh::IndexType> &indices,
+        size_t vertexCount,
+        uint32_t cacheSize
+    );
+private:
+    void optimizeIndexOrder(const std::vector<Vertex> &vertices, std::vector<Mesh::IndexType> &indices) const;
+    std::vector<Mesh::IndexType> optimizeVertexCache(
+        const std::vector<Mesh::IndexType> &indices,
+        size_t vertexCount,
+        std::vector<size_t> &clusters
+    ) const;
+    std::vector<Mesh::IndexType> optimizeOverdraw(
+        const std::vector<Mesh::IndexType> &indices,
+        const std::vector<Vertex> &vertices,
+        const std::vector<size_t> &clusters
+    ) const;
+    void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<Mesh::IndexType> &indices) const;
+
+    Settings settings;
+};
+
+#endif
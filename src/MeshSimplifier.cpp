@@ -0,0 +1,341 @@
+#include "MeshSimplifier.h"
+#include "Utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/geometric.hpp>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // symmetric 4x4 matrix accumulating squared distances to a set of planes
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+        double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+        double a22 = 0.0, a23 = 0.0;
+        double a33 = 0.0;
+
+        static Quadric fromPlane(double a, double b, double c, double d)
+        {
+            Quadric q;
+            q.a00 = a * a; q.a01 = a * b; q.a02 = a * c; q.a03 = a * d;
+            q.a11 = b * b; q.a12 = b * c; q.a13 = b * d;
+            q.a22 = c * c; q.a23 = c * d;
+            q.a33 = d * d;
+            return q;
+        }
+
+        Quadric &operator +=(const Quadric &o)
+        {
+            a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+            a11 += o.a11; a12 += o.a12; a13 += o.a13;
+            a22 += o.a22; a23 += o.a23;
+            a33 += o.a33;
+            return *this;
+        }
+
+        Quadric operator +(const Quadric &o) const
+        {
+            Quadric q = *this;
+            q += o;
+            return q;
+        }
+
+        double evaluate(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double result = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+                + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+                + a22 * z * z + 2.0 * a23 * z
+                + a33;
+            return std::max(result, 0.0);
+        }
+    };
+
+    struct Collapse
+    {
+        Mesh::IndexType from;
+        Mesh::IndexType to;
+        double cost;
+    };
+
+    uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+        return a < b
+            ? (static_cast<uint64_t>(a) << 32) | b
+            : (static_cast<uint64_t>(b) << 32) | a;
+    }
+
+    glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+    {
+        return glm::cross(b - a, c - a);
+    }
+}
+
+uint64_t MeshSimplifier::Settings::getHash() const
+{
+    using namespace Utility;
+
+    size_t result = 0;
+    hash_combine(result, levelCount);
+    hash_combine(result, reduction);
+    hash_combine(result, targetError);
+    hash_combine(result, errorGrowth);
+    hash_combine(result, minReduction);
+    return result;
+}
+
+
+MeshSimplifier::MeshSimplifier(const Settings &settings)
+    : settings(settings)
+{
+}
+
+
+const MeshSimplifier::Settings &MeshSimplifier::getSettings() const
+{
+    return settings;
+}
+
+std::vector<Mesh::Lod> MeshSimplifier::generateLods(
+    const std::vector<Vertex> &vertices,
+    std::vector<Mesh::IndexType> &indices
+) const
+{
+    std::vector<Mesh::Lod> lods = {
+        Mesh::Lod{
+            .indexOffset = 0,
+            .indexCount = static_cast<uint32_t>(indices.size()),
+            .error = 0.f,
+        },
+    };
+    if (vertices.empty() || indices.empty()) {
+        return lods;
+    }
+
+    glm::vec3 boundsMin = vertices[0].position;
+    glm::vec3 boundsMax = vertices[0].position;
+    for (const auto &vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+    std::vector<Mesh::IndexType> previous = indices;
+    float levelError = settings.targetError * radius;
+    for (uint32_t level = 1; level <= settings.levelCount; ++level, levelError *= settings.errorGrowth) {
+        // simplification starts from the previous level, so its error is already used up
+        float budget = levelError - lods.back().error;
+        if (budget <= 0.f) {
+            continue;
+        }
+
+        size_t targetIndexCount = static_cast<size_t>(previous.size() / 3 * settings.reduction) * 3;
+        float error = 0.f;
+        std::vector<Mesh::IndexType> simplified = simplify(vertices, previous, targetIndexCount, budget, error);
+        if (simplified.empty()
+            || simplified.size() > previous.size() * (1.f - settings.minReduction)
+        ) {
+            break;
+        }
+
+        lods.push_back(Mesh::Lod{
+            .indexOffset = static_cast<uint32_t>(indices.size()),
+            .indexCount = static_cast<uint32_t>(simplified.size()),
+            .error = lods.back().error + error,
+        });
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
+    }
+
+    return lods;
+}
+
+std::vector<Mesh::IndexType> MeshSimplifier::simplify(
+    const std::vector<Vertex> &vertices,
+    const std::vector<Mesh::IndexType> &indices,
+    size_t targetIndexCount,
+    float targetError,
+    float &error
+)
+{
+    const size_t vertexCount = vertices.size();
+    error = 0.f;
+
+    // vertices sharing a position differ in normal or uv only; the first one represents the group
+    std::vector<Mesh::IndexType> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    auto positionLess = [&](Mesh::IndexType a, Mesh::IndexType b) {
+        const glm::vec3 &pa = vertices[a].position;
+        const glm::vec3 &pb = vertices[b].position;
+        return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+    };
+    std::sort(order.begin(), order.end(), positionLess);
+
+    std::vector<Mesh::IndexType> group(vertexCount);
+    std::vector<uint32_t> groupSize(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        bool sameAsPrevious = i > 0 && !positionLess(order[i - 1], order[i]) && !positionLess(order[i], order[i - 1]);
+        group[order[i]] = sameAsPrevious ? group[order[i - 1]] : order[i];
+        ++groupSize[group[order[i]]];
+    }
+
+    // attribute seams, borders and non-manifold edges stay where they are
+    std::vector<bool> locked(vertexCount, false);
+    std::unordered_map<uint64_t, uint32_t> edgeCounts;
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        for (size_t corner = 0; corner < 3; ++corner) {
+            ++edgeCounts[edgeKey(group[indices[t + corner]], group[indices[t + (corner + 1) % 3]])];
+        }
+    }
+    for (const auto &edge : edgeCounts) {
+        if (edge.second != 2) {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & 0xffffffff] = true;
+        }
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (groupSize[group[v]] > 1) {
+            locked[group[v]] = true;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        const glm::vec3 &a = vertices[indices[t]].position;
+        const glm::vec3 &b = vertices[indices[t + 1]].position;
+        const glm::vec3 &c = vertices[indices[t + 2]].position;
+        glm::vec3 normal = triangleNormal(a, b, c);
+        float length = glm::length(normal);
+        if (length == 0.f) {
+            continue;
+        }
+        normal /= length;
+        Quadric q = Quadric::fromPlane(normal.x, normal.y, normal.z, -glm::dot(normal, a));
+        quadrics[group[indices[t]]] += q;
+        quadrics[group[indices[t + 1]]] += q;
+        quadrics[group[indices[t + 2]]] += q;
+    }
+
+    const double maxCost = static_cast<double>(targetError) * targetError;
+    std::vector<Mesh::IndexType> result = indices;
+    std::vector<Collapse> collapses;
+    std::vector<Mesh::IndexType> collapseTarget(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+    std::vector<uint32_t> triangles;
+
+    while (result.size() > targetIndexCount) {
+        // triangles around each vertex of the current result
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (Mesh::IndexType index : result) {
+            ++triangleOffsets[index + 1];
+        }
+        std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+        triangles.resize(result.size());
+        std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            triangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < result.size(); t += 3) {
+            for (size_t corner = 0; corner < 3; ++corner) {
+                for (size_t other = 1; other < 3; ++other) {
+                    Mesh::IndexType from = result[t + corner];
+                    Mesh::IndexType to = result[t + (corner + other) % 3];
+                    if (locked[group[from]]) {
+                        continue;
+                    }
+                    double cost = (quadrics[group[from]] + quadrics[group[to]]).evaluate(vertices[to].position);
+                    if (cost <= maxCost) {
+                        collapses.push_back(Collapse{from, to, cost});
+                    }
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.cost < b.cost;
+        });
+
+        std::iota(collapseTarget.begin(), collapseTarget.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t removableTriangles = (result.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        size_t collapseCount = 0;
+
+        for (const Collapse &collapse : collapses) {
+            if (removedTriangles >= removableTriangles) {
+                break;
+            }
+            Mesh::IndexType fromGroup = group[collapse.from];
+            Mesh::IndexType toGroup = group[collapse.to];
+            if (touched[fromGroup] || touched[toGroup]) {
+                continue;
+            }
+
+            // reject collapses that flip any of the remaining triangles around the moved vertex
+            const glm::vec3 &target = vertices[collapse.to].position;
+            bool flips = false;
+            size_t removed = 0;
+            for (uint32_t i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; ++i) {
+                const Mesh::IndexType *corners = &result[3 * triangles[i]];
+                if (group[corners[0]] == toGroup || group[corners[1]] == toGroup || group[corners[2]] == toGroup) {
+                    ++removed;
+                    continue;
+                }
+                glm::vec3 positions[3];
+                glm::vec3 moved[3];
+                for (size_t corner = 0; corner < 3; ++corner) {
+                    positions[corner] = vertices[corners[corner]].position;
+                    moved[corner] = corners[corner] == collapse.from ? target : positions[corner];
+                }
+                glm::vec3 before = triangleNormal(positions[0], positions[1], positions[2]);
+                glm::vec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+                if (glm::dot(before, after) <= 0.f) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            collapseTarget[collapse.from] = collapse.to;
+            quadrics[toGroup] += quadrics[fromGroup];
+            error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+            removedTriangles += removed;
+            ++collapseCount;
+            for (uint32_t i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; ++i) {
+                const Mesh::IndexType *corners = &result[3 * triangles[i]];
+                touched[group[corners[0]]] = true;
+                touched[group[corners[1]]] = true;
+                touched[group[corners[2]]] = true;
+            }
+        }
+
+        if (collapseCount == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t t = 0; t < result.size(); t += 3) {
+            Mesh::IndexType a = collapseTarget[result[t]];
+            Mesh::IndexType b = collapseTarget[result[t + 1]];
+            Mesh::IndexType c = collapseTarget[result[t + 2]];
+            if (group[a] == group[b] || group[b] == group[c] || group[c] == group[a]) {
+                continue;
+            }
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    return result;
+}
@@ -0,0 +1,58 @@
+#ifndef MESHSIMPLIFIER_H_
+#define MESHSIMPLIFIER_H_
+
+#include "Mesh.h"
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Generates levels of detail by quadric error metric edge collapse (Garland and Heckbert 1997).
+// Collapses move a vertex onto one of its neighbors, so every level indexes into the vertex
+// buffer of the base mesh. Vertices on borders and attribute seams are never moved to avoid cracks.
+class MeshSimplifier
+{
+public:
+    struct Settings
+    {
+        // number of simplified levels in addition to the base mesh
+        uint32_t levelCount = 3;
+        // each level aims for this fraction of the triangles of the previous one
+        float reduction = 0.5f;
+        // error bound of the first level relative to the radius of the mesh bounds,
+        // every further level allows errorGrowth times the error of the previous one
+        float targetError = 0.01f;
+        float errorGrowth = 2.f;
+        // levels removing fewer triangles than this fraction are dropped and end the chain
+        float minReduction = 0.1f;
+
+        uint64_t getHash() const;
+    };
+
+    MeshSimplifier(const Settings &settings);
+    MeshSimplifier(const MeshSimplifier &) = delete;
+    MeshSimplifier(MeshSimplifier &&) = default;
+    ~MeshSimplifier() = default;
+
+    const Settings &getSettings() const;
+    // appends the indices of all simplified levels to indices and returns the ranges of all levels, base first
+    std::vector<Mesh::Lod> generateLods(
+        const std::vector<Vertex> &vertices,
+        std::vector<Mesh::IndexType> &indices
+    ) const;
+
+    // collapses edges until the index count drops to targetIndexCount or the next collapse
+    // would exceed targetError (object space distance); error receives the largest error introduced
+    static std::vector<Mesh::IndexType> simplify(
+        const std::vector<Vertex> &vertices,
+        const std::vector<Mesh::IndexType> &indices,
+        size_t targetIndexCount,
+        float targetError,
+        float &error
+    );
+private:
+    Settings settings;
+};
+
+#endif
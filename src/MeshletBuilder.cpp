@@ -0,0 +1,202 @@
+#include "MeshletBuilder.h"
+#include "Utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/geometric.hpp>
+#include <vector>
+
+uint64_t MeshletBuilder::Settings::getHash() const
+{
+    using namespace Utility;
+
+    size_t result = 0;
+    hash_combine(result, maxVertices);
+    hash_combine(result, maxTriangles);
+    hash_combine(result, minTriangles);
+    return result;
+}
+
+
+MeshletBuilder::MeshletBuilder(const Settings &settings)
+    : settings(settings)
+{
+}
+
+
+const MeshletBuilder::Settings &MeshletBuilder::getSettings() const
+{
+    return settings;
+}
+
+std::vector<Mesh::Meshlet> MeshletBuilder::build(
+    const std::vector<Vertex> &vertices,
+    std::vector<Mesh::IndexType> &indices,
+    uint32_t indexOffset,
+    uint32_t indexCount
+) const
+{
+    std::vector<Mesh::Meshlet> meshlets;
+    if (indexCount / 3 < settings.minTriangles || settings.maxVertices < 3 || settings.maxTriangles == 0) {
+        return meshlets;
+    }
+
+    const uint32_t triangleCount = indexCount / 3;
+    const std::vector<Mesh::IndexType> source(
+        indices.begin() + indexOffset,
+        indices.begin() + indexOffset + indexCount
+    );
+    auto corner = [&](uint32_t triangle, uint32_t i) {
+        return source[triangle * 3 + i];
+    };
+
+    // triangles adjacent to each vertex, in compressed row storage
+    std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            ++adjacencyOffsets[corner(t, i) + 1];
+        }
+    }
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            adjacency[fill[corner(t, i)]++] = t;
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<bool> inMeshlet(vertices.size(), false);
+    std::vector<Mesh::IndexType> meshletVertices;
+    std::vector<uint32_t> candidates;
+    std::vector<Mesh::IndexType> reordered;
+    reordered.reserve(indexCount);
+    uint32_t nextSeed = 0;
+    uint32_t begin = indexOffset;
+
+    // grows each meshlet from a seed triangle over shared vertices, preferring triangles that
+    // add the fewest new vertices, so that meshlets are compact and their normal cones narrow
+    while (reordered.size() < indexCount) {
+        while (emitted[nextSeed]) {
+            ++nextSeed;
+        }
+        candidates.assign(1, nextSeed);
+        uint32_t meshletTriangles = 0;
+
+        while (meshletTriangles < settings.maxTriangles) {
+            uint32_t best = UINT32_MAX;
+            uint32_t bestNewVertices = 4;
+            for (uint32_t t : candidates) {
+                if (emitted[t]) {
+                    continue;
+                }
+                uint32_t newVertices = 0;
+                for (uint32_t i = 0; i < 3; ++i) {
+                    newVertices += inMeshlet[corner(t, i)] ? 0 : 1;
+                }
+                if (newVertices < bestNewVertices) {
+                    best = t;
+                    bestNewVertices = newVertices;
+                }
+            }
+            if (best == UINT32_MAX || meshletVertices.size() + bestNewVertices > settings.maxVertices) {
+                break;
+            }
+
+            emitted[best] = true;
+            ++meshletTriangles;
+            for (uint32_t i = 0; i < 3; ++i) {
+                Mesh::IndexType vertex = corner(best, i);
+                reordered.push_back(vertex);
+                if (!inMeshlet[vertex]) {
+                    inMeshlet[vertex] = true;
+                    meshletVertices.push_back(vertex);
+                    for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a) {
+                        if (!emitted[adjacency[a]]) {
+                            candidates.push_back(adjacency[a]);
+                        }
+                    }
+                }
+            }
+            candidates.erase(
+                std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t t) { return emitted[t]; }),
+                candidates.end()
+            );
+        }
+
+        uint32_t end = indexOffset + static_cast<uint32_t>(reordered.size());
+        std::copy(reordered.begin() + (begin - indexOffset), reordered.end(), indices.begin() + begin);
+        meshlets.push_back(createMeshlet(vertices, indices, begin, end - begin, meshletVertices));
+        for (Mesh::IndexType vertex : meshletVertices) {
+            inMeshlet[vertex] = false;
+        }
+        meshletVertices.clear();
+        begin = end;
+    }
+
+    return meshlets;
+}
+
+Mesh::Meshlet MeshletBuilder::createMeshlet(
+    const std::vector<Vertex> &vertices,
+    const std::vector<Mesh::IndexType> &indices,
+    uint32_t indexOffset,
+    uint32_t indexCount,
+    const std::vector<Mesh::IndexType> &meshletVertices
+) const
+{
+    Mesh::Meshlet meshlet{};
+    meshlet.indexOffset = indexOffset;
+    meshlet.indexCount = indexCount;
+
+    glm::vec3 boundsMin = vertices[meshletVertices[0]].position;
+    glm::vec3 boundsMax = boundsMin;
+    for (Mesh::IndexType vertex : meshletVertices) {
+        boundsMin = glm::min(boundsMin, vertices[vertex].position);
+        boundsMax = glm::max(boundsMax, vertices[vertex].position);
+    }
+    meshlet.center = (boundsMin + boundsMax) * 0.5f;
+    meshlet.radius = 0.f;
+    for (Mesh::IndexType vertex : meshletVertices) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].position - meshlet.center));
+    }
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(indexCount / 3);
+    glm::vec3 axis(0.f);
+    for (uint32_t i = indexOffset; i < indexOffset + indexCount; i += 3) {
+        const glm::vec3 &a = vertices[indices[i]].position;
+        const glm::vec3 &b = vertices[indices[i + 1]].position;
+        const glm::vec3 &c = vertices[indices[i + 2]].position;
+        // front faces are clockwise, so this points outwards
+        glm::vec3 normal = glm::cross(c - a, b - a);
+        float length = glm::length(normal);
+        if (length > 0.f) {
+            normals.push_back(normal / length);
+            axis += normal / length;
+        }
+    }
+
+    // a cutoff of 1 can never satisfy the culling test, which is used for cones of 90 degrees and more
+    meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+    meshlet.coneCutoff = 1.f;
+    float axisLength = glm::length(axis);
+    if (axisLength > 0.f) {
+        axis /= axisLength;
+        float minDot = 1.f;
+        for (const glm::vec3 &normal : normals) {
+            minDot = std::min(minDot, glm::dot(axis, normal));
+        }
+        meshlet.coneAxis = axis;
+        if (minDot > 0.f) {
+            // sine of the cone angle: the view direction has to be within 90 degrees minus that angle of the axis
+            meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+        }
+    }
+
+    return meshlet;
+}
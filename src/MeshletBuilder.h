@@ -0,0 +1,52 @@
+#ifndef MESHLETBUILDER_H_
+#define MESHLETBUILDER_H_
+
+#include "Mesh.h"
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Splits an index range into meshlets, reordering its triangles so that every
+// meshlet is a contiguous index range that can be drawn with an indirect command of its own.
+// Triangles keep their relative order within a meshlet where possible, so most of the vertex
+// cache locality produced by MeshOptimizer survives.
+class MeshletBuilder
+{
+public:
+    struct Settings
+    {
+        uint32_t maxVertices = 64;
+        uint32_t maxTriangles = 124;
+        // smaller meshes are cheaper to draw in one piece than to cull
+        uint32_t minTriangles = 4096;
+
+        uint64_t getHash() const;
+    };
+
+    MeshletBuilder(const Settings &settings);
+    MeshletBuilder(const MeshletBuilder &) = delete;
+    MeshletBuilder(MeshletBuilder &&) = default;
+    ~MeshletBuilder() = default;
+
+    const Settings &getSettings() const;
+    std::vector<Mesh::Meshlet> build(
+        const std::vector<Vertex> &vertices,
+        std::vector<Mesh::IndexType> &indices,
+        uint32_t indexOffset,
+        uint32_t indexCount
+    ) const;
+private:
+    Mesh::Meshlet createMeshlet(
+        const std::vector<Vertex> &vertices,
+        const std::vector<Mesh::IndexType> &indices,
+        uint32_t indexOffset,
+        uint32_t indexCount,
+        const std::vector<Mesh::IndexType> &meshletVertices
+    ) const;
+
+    Settings settings;
+};
+
+#endif
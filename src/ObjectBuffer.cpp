@@ -0,0 +1,92 @@
+#include "ObjectBuffer.h"
+#include "DeviceAllocator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+ObjectBuffer::ObjectBuffer(DeviceAllocator &allocator, uint32_t frameCount, size_t initialCapacity)
+    : allocator(allocator),
+    pendingIds(frameCount)
+{
+    if (frameCount == 0 || frameCount > 32) {
+        throw std::invalid_argument(fmt::format("ObjectBuffer: unsupported frame count {}", frameCount));
+    }
+    for (uint32_t i = 0; i < frameCount; ++i) {
+        buffers.push_back(createBuffer(initialCapacity));
+    }
+}
+
+void ObjectBuffer::set(uint32_t objectId, const ObjectData &data)
+{
+    if (objects.size() <= objectId) {
+        objects.resize(objectId + 1, ObjectData{glm::mat4{1.f}, glm::mat4{1.f}});
+        pendingFrames.resize(objectId + 1, 0);
+    }
+    objects[objectId] = data;
+
+    const uint32_t allFrames = static_cast<uint32_t>((uint64_t{1} << buffers.size()) - 1);
+    for (uint32_t frame = 0; frame < buffers.size(); ++frame) {
+        if (!(pendingFrames[objectId] & (1u << frame))) {
+            pendingIds[frame].push_back(objectId);
+        }
+    }
+    pendingFrames[objectId] = allFrames;
+}
+
+bool ObjectBuffer::update(uint32_t frameIndex)
+{
+    std::unique_ptr<MappedBuffer> &buffer = buffers.at(frameIndex);
+    std::vector<uint32_t> &ids = pendingIds[frameIndex];
+    const uint32_t frameBit = 1u << frameIndex;
+
+    if (buffer->getSize() < objects.size() * sizeof(ObjectData)) {
+        size_t capacity = std::max(objects.size(), 2 * buffer->getSize() / sizeof(ObjectData));
+        buffer.reset();
+        buffer = createBuffer(capacity);
+        spdlog::info("ObjectBuffer: copy of frame {} resized to {} objects", frameIndex, capacity);
+
+        // the new copy starts out empty
+        std::memcpy(buffer->getData(), objects.data(), objects.size() * sizeof(ObjectData));
+        for (uint32_t &pending : pendingFrames) {
+            pending &= ~frameBit;
+        }
+        lastUpdateCount = objects.size();
+        ids.clear();
+        return true;
+    }
+
+    ObjectData *data = reinterpret_cast<ObjectData *>(buffer->getData());
+    for (uint32_t id : ids) {
+        data[id] = objects[id];
+        pendingFrames[id] &= ~frameBit;
+    }
+    lastUpdateCount = ids.size();
+    ids.clear();
+    return false;
+}
+
+VkDescriptorBufferInfo ObjectBuffer::getDescriptorBufferInfo(uint32_t frameIndex) const
+{
+    return VkDescriptorBufferInfo{
+        .buffer = buffers.at(frameIndex)->getHandle(),
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+}
+
+size_t ObjectBuffer::getLastUpdateCount() const
+{
+    return lastUpdateCount;
+}
+
+std::unique_ptr<MappedBuffer> ObjectBuffer::createBuffer(size_t capacity)
+{
+    return std::make_unique<MappedBuffer>(
+        allocator,
+        capacity * sizeof(ObjectData),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+    );
+}
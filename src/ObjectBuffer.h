@@ -0,0 +1,52 @@
+#ifndef OBJECTBUFFER_H_
+#define OBJECTBUFFER_H_
+
+#include "MappedBuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class DeviceAllocator;
+
+// per object shader data, std430 layout of ObjectData in the vertex shaders
+struct ObjectData
+{
+    // includes Mesh::getPositionTransform()
+    glm::mat4 transform;
+    // only the upper 3x3 part is used for normals, the last column carries Mesh::getUvTransform()
+    glm::mat4 normalTransform;
+};
+
+// Storage buffer of ObjectData indexed by object id. Every frame in flight has its own copy,
+// to which only the entries changed since the frame last drew are written.
+class ObjectBuffer
+{
+public:
+    ObjectBuffer(DeviceAllocator &allocator, uint32_t frameCount, size_t initialCapacity = 1024);
+    ObjectBuffer(const ObjectBuffer &) = delete;
+    ~ObjectBuffer() = default;
+
+    void set(uint32_t objectId, const ObjectData &data);
+    // writes the pending entries to the copy of the frame, whose fence must have been waited on;
+    // returns true if the copy had to be recreated to grow, then descriptors referring to it are outdated
+    bool update(uint32_t frameIndex);
+    VkDescriptorBufferInfo getDescriptorBufferInfo(uint32_t frameIndex) const;
+    // number of entries written by the last update, for statistics
+    size_t getLastUpdateCount() const;
+private:
+    std::unique_ptr<MappedBuffer> createBuffer(size_t capacity);
+
+    DeviceAllocator &allocator;
+    std::vector<ObjectData> objects;
+    // bit i is set while the entry has not been written to the copy of frame i
+    std::vector<uint32_t> pendingFrames;
+    std::vector<std::vector<uint32_t>> pendingIds;
+    std::vector<std::unique_ptr<MappedBuffer>> buffers;
+    size_t lastUpdateCount = 0;
+};
+
+#endif
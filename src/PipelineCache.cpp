@@ -0,0 +1,136 @@
+#include "PipelineCache.h"
+#include "Utility.h"
+#include "VkHelpers.h"
+
+#include <cstring>
+#include <fstream>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <vector>
+
+PipelineCache::PipelineCache(
+    VkDevice device,
+    const VkPhysicalDeviceProperties &properties,
+    const std::filesystem::path &path
+)
+    : device(device),
+    properties(properties),
+    path(path),
+    savedAt(Clock::now())
+{
+    std::vector<std::byte> data = loadValidData();
+
+    VkPipelineCacheCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.data(),
+    };
+    VK_ASSERT(vkCreatePipelineCache(device, &createInfo, nullptr, &cache));
+}
+
+PipelineCache::~PipelineCache()
+{
+    if (unsavedPipelines > 0) {
+        try {
+            save();
+        }
+        catch (std::exception &e) {
+            spdlog::warn("PipelineCache: could not save {}: {}", path.string(), e.what());
+        }
+    }
+    vkDestroyPipelineCache(device, cache, nullptr);
+}
+
+VkPipelineCache PipelineCache::getHandle() const
+{
+    return cache;
+}
+
+void PipelineCache::notifyPipelineCreated()
+{
+    ++unsavedPipelines;
+}
+
+void PipelineCache::saveIfDue()
+{
+    if (unsavedPipelines == 0 || Clock::now() - savedAt < SAVE_INTERVAL) {
+        return;
+    }
+    try {
+        save();
+    }
+    catch (std::exception &e) {
+        spdlog::warn("PipelineCache: could not save {}: {}", path.string(), e.what());
+        savedAt = Clock::now();
+    }
+}
+
+void PipelineCache::save()
+{
+    uint32_t pipelineCount = unsavedPipelines.exchange(0);
+    savedAt = Clock::now();
+
+    size_t size = 0;
+    VK_ASSERT(vkGetPipelineCacheData(device, cache, &size, nullptr));
+    std::vector<std::byte> data(size);
+    VK_ASSERT(vkGetPipelineCacheData(device, cache, &size, data.data()));
+    data.resize(size);
+
+    // write to a temporary file first so that a crash never leaves a truncated cache behind
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error(fmt::format("PipelineCache: could not open {} for writing", temporaryPath.string()));
+        }
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            throw std::runtime_error(fmt::format("PipelineCache: writing {} failed", temporaryPath.string()));
+        }
+    }
+    std::filesystem::rename(temporaryPath, path);
+
+    spdlog::info("PipelineCache: saved {} bytes to {}, {} new pipelines", data.size(), path.string(), pipelineCount);
+}
+
+std::vector<std::byte> PipelineCache::loadValidData() const
+{
+    if (path.empty() || !std::filesystem::exists(path)) {
+        spdlog::info("PipelineCache: no cache at {}, pipelines are compiled from scratch", path.string());
+        return {};
+    }
+
+    std::vector<std::byte> data;
+    try {
+        data = Utility::readFile(path);
+    }
+    catch (std::exception &e) {
+        spdlog::warn("PipelineCache: ignoring {}: {}", path.string(), e.what());
+        return {};
+    }
+    if (!isValid(data)) {
+        spdlog::warn("PipelineCache: ignoring {}, it was saved by another driver or device", path.string());
+        return {};
+    }
+
+    spdlog::info("PipelineCache: loaded {} bytes from {}", data.size(), path.string());
+    return data;
+}
+
+bool PipelineCache::isValid(const std::vector<std::byte> &data) const
+{
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header)
+        && header.headerSize <= data.size()
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && !std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
@@ -0,0 +1,46 @@
+#ifndef PIPELINECACHE_H_
+#define PIPELINECACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Device-wide VkPipelineCache persisted across runs. Data saved by another driver or device is discarded
+// instead of handed to the driver, the header is checked against the vendor, device and cache UUID.
+class PipelineCache
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr const char *DEFAULT_PATH = "pipeline.cache";
+    static constexpr std::chrono::seconds SAVE_INTERVAL{30};
+
+    PipelineCache(VkDevice device, const VkPhysicalDeviceProperties &properties, const std::filesystem::path &path);
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache(PipelineCache &&) = delete;
+    // saves pipelines compiled since the last save
+    ~PipelineCache();
+
+    VkPipelineCache getHandle() const;
+    // to be called after every pipeline creation using the cache, may be called from any thread
+    void notifyPipelineCreated();
+    // saves if pipelines were compiled since the last save and SAVE_INTERVAL has passed
+    void saveIfDue();
+    void save();
+private:
+    std::vector<std::byte> loadValidData() const;
+    bool isValid(const std::vector<std::byte> &data) const;
+
+    VkDevice device;
+    VkPhysicalDeviceProperties properties;
+    std::filesystem::path path;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::atomic<uint32_t> unsavedPipelines = 0;
+    Clock::time_point savedAt;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+PipelineCompiler::PipelineCompiler(uint32_t threadCount)
+{
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&PipelineCompiler::run, this);
+    }
+    spdlog::info("PipelineCompiler: {} threads", threadCount);
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        jobs.clear();
+    }
+    condition.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+std::future<VkPipeline> PipelineCompiler::enqueue(std::function<VkPipeline()> compile)
+{
+    std::packaged_task<VkPipeline()> job(std::move(compile));
+    std::future<VkPipeline> result = job.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    condition.notify_one();
+    return result;
+}
+
+uint32_t PipelineCompiler::getDefaultThreadCount()
+{
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    return std::clamp(hardwareThreads, 2u, 5u) - 1;
+}
+
+void PipelineCompiler::run()
+{
+    while (true) {
+        std::packaged_task<VkPipeline()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() {
+                return !running || !jobs.empty();
+            });
+            if (!running) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        // exceptions end up in the future
+        job();
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef PIPELINECOMPILER_H_
+#define PIPELINECOMPILER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Worker threads compiling pipelines, so that the render thread never waits for the driver.
+class PipelineCompiler
+{
+public:
+    PipelineCompiler(uint32_t threadCount = getDefaultThreadCount());
+    PipelineCompiler(const PipelineCompiler &) = delete;
+    PipelineCompiler(PipelineCompiler &&) = delete;
+    // waits for the running jobs, jobs that have not started are dropped and their futures
+    // report std::future_errc::broken_promise
+    ~PipelineCompiler();
+
+    std::future<VkPipeline> enqueue(std::function<VkPipeline()> compile);
+
+    // one thread is left to the render thread
+    static uint32_t getDefaultThreadCount();
+private:
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::packaged_task<VkPipeline()>> jobs;
+    bool running = true;
+    std::vector<std::thread> threads;
+};
+
+#endif
@@ -1,83 +1,99 @@
 #include "RenderObject.h"
+#include "Camera.h"
 #include "Device.h"
 #include "Mesh.h"
 #include "Material.h"
+#include "MeshBuffer.h"
 
+#include <algorithm>
+#include <array>
 #include <glm/ext/matrix_float4x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/geometric.hpp>
 #include <utility>
 #include <vulkan/vulkan_core.h>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
 
 RenderObject::RenderObject(
     uint32_t id,
     Device &device,
     const MeshResource &mesh,
-    const Material &material,
+    std::string meshName,
+    std::shared_ptr<const MeshBuffer> buffer,
+    std::vector<const Material *> materials,
     std::string name
 )
     : device(&device),
-    material(&material),
+    materials(std::move(materials)),
     transform(1.f), 
+    vertexFormat(mesh.getData().getVertexFormat()),
+    positionTransform(mesh.getData().getPositionTransform()),
+    uvTransform(mesh.getData().getUvTransform()),
+    boundsCenter((mesh.getData().getBoundsMin() + mesh.getData().getBoundsMax()) * 0.5f),
+    boundsRadius(glm::length(mesh.getData().getBoundsMax() - mesh.getData().getBoundsMin()) * 0.5f),
+    meshResource(&mesh),
+    meshName(std::move(meshName)),
+    mesh(&mesh.getData()),
     indexCount(mesh.getData().getIndexCount()),
     vertexCount(mesh.getData().getVertexCount()),
-    indexType(mesh.getData().getIndexType()),
-    vertexBuffer(
-        device.getAllocator(), 
-        (void *) mesh.getData().getVertexData().data(), 
-        mesh.getData().getVertexDataSize(), 
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
-    ),
-    indexBuffer(
-        indexCount > 0 
-        ? std::make_unique<Buffer>(
-            device.getAllocator(), 
-            (void *) mesh.getData().getIndexData().data(), 
-            mesh.getData().getIndexDataSize(), 
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
-        : nullptr
-    ),
+    buffer(std::move(buffer)),
     id(id),
     name(name)
 {
+    validateMaterials();
 }
 
 RenderObject::RenderObject(RenderObject &&other)
     : device(other.device),
-    material(other.material),
+    materials(std::move(other.materials)),
     transform(other.transform),
+    vertexFormat(other.vertexFormat),
+    positionTransform(other.positionTransform),
+    uvTransform(other.uvTransform),
+    boundsCenter(other.boundsCenter),
+    boundsRadius(other.boundsRadius),
+    objectDataChanged(other.objectDataChanged),
+    meshResource(other.meshResource),
+    meshName(std::move(other.meshName)),
+    mesh(other.mesh),
+    lod(other.lod),
     indexCount(other.indexCount),
     vertexCount(other.vertexCount),
-    indexType(other.indexType),
-    vertexBuffer(std::move(other.vertexBuffer)),
-    indexBuffer(std::move(other.indexBuffer)),
+    buffer(std::move(other.buffer)),
     id(other.id),
     name(std::move(other.name))
 {
     other.device = nullptr;
-    other.material = nullptr;
 }
 
 RenderObject::~RenderObject()
 {
-    indexBuffer.reset();
 }
 
 
 RenderObject &RenderObject::operator =(RenderObject &&other)
 {
     device = other.device;
-    material = other.material;
+    materials = std::move(other.materials);
     transform = other.transform;
+    vertexFormat = other.vertexFormat;
+    positionTransform = other.positionTransform;
+    uvTransform = other.uvTransform;
+    boundsCenter = other.boundsCenter;
+    boundsRadius = other.boundsRadius;
+    objectDataChanged = other.objectDataChanged;
+    meshResource = other.meshResource;
+    meshName = std::move(other.meshName);
+    mesh = other.mesh;
+    lod = other.lod;
     indexCount = other.indexCount;
     vertexCount = other.vertexCount;
-    indexType = other.indexType;
-    vertexBuffer = std::move(other.vertexBuffer);
-    indexBuffer = std::move(other.indexBuffer);
+    buffer = std::move(other.buffer);
     id = other.id;
     name = std::move(other.name);
 
     other.device = nullptr;
-    other.material = nullptr;
 
     return *this;
 }
@@ -93,6 +109,22 @@ std::vector<VkDescriptorSetLayoutBinding> RenderObject::getGlobalUniformDataLayo
 			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 			.pImmutableSamplers = nullptr,
 		},
+		// ObjectBuffer
+		VkDescriptorSetLayoutBinding{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+			.pImmutableSamplers = nullptr,
+		},
+		// MaterialBuffer
+		VkDescriptorSetLayoutBinding{
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = nullptr,
+		},
 	};
 }
 
@@ -109,32 +141,274 @@ const glm::mat4 &RenderObject::getTransform() const
 void RenderObject::setTransform(const glm::mat4 &transform)
 {
     this->transform = transform;
+    objectDataChanged = true;
+}
+
+ObjectData RenderObject::getObjectData() const
+{
+    ObjectData data{
+        // dequantization of compressed positions is folded into the model transform
+        .transform = transform * positionTransform,
+        .normalTransform = glm::transpose(glm::inverse(transform)),
+    };
+    data.normalTransform[3] = uvTransform;
+    return data;
+}
+
+bool RenderObject::takeObjectDataChanged()
+{
+    bool changed = objectDataChanged;
+    objectDataChanged = false;
+    return changed;
+}
+
+const std::vector<const Material *> &RenderObject::getMaterials() const
+{
+    return materials;
+}
+
+const MeshResource &RenderObject::getMeshResource() const
+{
+    return *meshResource;
+}
+
+const std::string &RenderObject::getMeshName() const
+{
+    return meshName;
+}
+
+void RenderObject::setMesh(const MeshResource &mesh, std::shared_ptr<const MeshBuffer> buffer)
+{
+    const Mesh &data = mesh.getData();
+    vertexFormat = data.getVertexFormat();
+    positionTransform = data.getPositionTransform();
+    uvTransform = data.getUvTransform();
+    boundsCenter = (data.getBoundsMin() + data.getBoundsMax()) * 0.5f;
+    boundsRadius = glm::length(data.getBoundsMax() - data.getBoundsMin()) * 0.5f;
+    meshResource = &mesh;
+    this->mesh = &data;
+    lod = data.getLods().empty() ? 0 : std::min<uint32_t>(lod, static_cast<uint32_t>(data.getLods().size()) - 1);
+    indexCount = data.getIndexCount();
+    vertexCount = data.getVertexCount();
+    this->buffer = std::move(buffer);
+    objectDataChanged = true;
+    validateMaterials();
+}
+
+VertexFormat RenderObject::getVertexFormat() const
+{
+    return vertexFormat;
+}
+
+const glm::mat4 &RenderObject::getPositionTransform() const
+{
+    return positionTransform;
+}
+
+const glm::vec4 &RenderObject::getUvTransform() const
+{
+    return uvTransform;
 }
 
-const Material &RenderObject::getMaterial() const
+uint32_t RenderObject::getLodCount() const
 {
-    return *material;
+    return static_cast<uint32_t>(mesh->getLods().size());
 }
 
-void RenderObject::enqueueDrawCommands(VkCommandBuffer commandBuffer) const
+uint32_t RenderObject::getLod() const
 {
-    VkBuffer vertexBuffers[] = {vertexBuffer.getHandle()};
-	VkDeviceSize offsets[] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    return lod;
+}
 
-    if (indexCount > 0) {
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getHandle(), 0, indexType);
+uint32_t RenderObject::getTriangleCount(uint32_t lod) const
+{
+    return indexCount > 0 ? mesh->getLods()[lod].indexCount / 3 : vertexCount / 3;
+}
 
-        vkCmdDrawIndexed(
-            commandBuffer, 
-            indexCount, 
-            1, 
-            0, 
-            0, 
-            0
-        );
+uint32_t RenderObject::selectLod(const Camera &camera, float viewportHeight, const LodSelection &selection)
+{
+    if (mesh->getLods().empty()) {
+        return lod;
+    }
+    uint32_t finest = std::min(selection.minLod, getLodCount() - 1);
+    lod = finest;
+    if (boundsRadius <= 0.f) {
+        return lod;
     }
-    else {
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+
+    glm::vec3 center = glm::vec3(transform * glm::vec4(boundsCenter, 1.f));
+    float scale = std::max({
+        glm::length(glm::vec3(transform[0])),
+        glm::length(glm::vec3(transform[1])),
+        glm::length(glm::vec3(transform[2])),
+    });
+    float projectedSize = camera.getProjectedSize(center, boundsRadius * scale, viewportHeight);
+    // both the projected size and the model space diameter include the scale
+    float pixelsPerUnit = projectedSize / (2.f * boundsRadius);
+
+    for (uint32_t i = getLodCount() - 1; i > finest; --i) {
+        if (mesh->getLods()[i].error * pixelsPerUnit <= selection.maxPixelError) {
+            lod = i;
+            break;
+        }
+    }
+    return lod;
+}
+
+uint32_t RenderObject::getMeshletCount() const
+{
+    return static_cast<uint32_t>(mesh->getMeshlets().size());
+}
+
+bool RenderObject::usesMeshlets() const
+{
+    return lod == 0 && indexCount > 0 && !mesh->getMeshlets().empty();
+}
+
+void RenderObject::enqueueDrawCommands(VkCommandBuffer commandBuffer, const MaterialBinder &bindMaterial) const
+{
+    buffer->bind(commandBuffer);
+
+    if (indexCount == 0) {
+        if (bindMaterial(*materials[0])) {
+            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+        }
+        return;
+    }
+
+    const Material *boundMaterial = nullptr;
+    bool drawable = false;
+    for (const Mesh::Submesh &submesh : mesh->getSubmeshes()) {
+        if (submesh.lod != lod || submesh.indexCount == 0) {
+            continue;
+        }
+        const Material *material = materials[submesh.material];
+        if (material != boundMaterial) {
+            drawable = bindMaterial(*material);
+            boundMaterial = material;
+        }
+        if (!drawable) {
+            continue;
+        }
+        vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.indexOffset, 0, 0);
+    }
+}
+
+uint32_t RenderObject::enqueueMeshletDrawCommands(
+    VkCommandBuffer commandBuffer,
+    const Camera &camera,
+    const ClusterCulling &culling,
+    IndirectCommands &indirect,
+    const MaterialBinder &bindMaterial
+) const
+{
+    bool buffersBound = false;
+    const Material *boundMaterial = nullptr;
+    bool drawable = false;
+    uint32_t total = 0;
+    for (const Mesh::Submesh &submesh : mesh->getSubmeshes()) {
+        if (submesh.lod != 0 || submesh.indexCount == 0) {
+            continue;
+        }
+        // submeshes too small to be split into meshlets are drawn whole
+        uint32_t drawCount = submesh.meshletCount > 0
+            ? cullMeshlets(submesh, camera, culling, indirect.commands + indirect.count)
+            : 0;
+        if (submesh.meshletCount > 0 && drawCount == 0) {
+            continue;
+        }
+
+        if (!buffersBound) {
+            buffer->bind(commandBuffer);
+            buffersBound = true;
+        }
+        const Material *material = materials[submesh.material];
+        if (material != boundMaterial) {
+            drawable = bindMaterial(*material);
+            boundMaterial = material;
+        }
+        // the culled commands are overwritten by the next submesh
+        if (!drawable) {
+            continue;
+        }
+        if (submesh.meshletCount == 0) {
+            vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.indexOffset, 0, 0);
+            continue;
+        }
+
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        VkDeviceSize offset = static_cast<VkDeviceSize>(indirect.count) * stride;
+        if (indirect.multiDraw) {
+            vkCmdDrawIndexedIndirect(commandBuffer, indirect.buffer, offset, drawCount, stride);
+        }
+        else {
+            for (uint32_t i = 0; i < drawCount; ++i) {
+                vkCmdDrawIndexedIndirect(commandBuffer, indirect.buffer, offset + i * stride, 1, stride);
+            }
+        }
+        indirect.count += drawCount;
+        total += drawCount;
+    }
+    return total;
+}
+
+void RenderObject::validateMaterials() const
+{
+    for (const Mesh::Submesh &submesh : mesh->getSubmeshes()) {
+        if (submesh.material >= materials.size() || !materials[submesh.material]) {
+            throw std::runtime_error(fmt::format(
+                "RenderObject {}: no material for slot {} of the mesh", name, submesh.material
+            ));
+        }
+    }
+}
+
+uint32_t RenderObject::cullMeshlets(
+    const Mesh::Submesh &submesh,
+    const Camera &camera,
+    const ClusterCulling &culling,
+    VkDrawIndexedIndirectCommand *commands
+) const
+{
+    std::array<glm::vec4, 6> planes = camera.getFrustumPlanes();
+    // the cone test is done in model space, the frustum test in world space
+    glm::vec3 eye = glm::vec3(glm::inverse(transform) * glm::vec4(camera.getEye(), 1.f));
+    float scale = std::max({
+        glm::length(glm::vec3(transform[0])),
+        glm::length(glm::vec3(transform[1])),
+        glm::length(glm::vec3(transform[2])),
+    });
+
+    uint32_t count = 0;
+    for (uint32_t i = submesh.meshletOffset; i < submesh.meshletOffset + submesh.meshletCount; ++i) {
+        const Mesh::Meshlet &meshlet = mesh->getMeshlets()[i];
+        if (culling.backface) {
+            glm::vec3 view = meshlet.center - eye;
+            if (glm::dot(view, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(view) + meshlet.radius) {
+                continue;
+            }
+        }
+        if (culling.frustum) {
+            glm::vec3 center = glm::vec3(transform * glm::vec4(meshlet.center, 1.f));
+            float radius = meshlet.radius * scale;
+            bool outside = false;
+            for (const glm::vec4 &plane : planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    outside = true;
+                    break;
+                }
+            }
+            if (outside) {
+                continue;
+            }
+        }
+        commands[count++] = VkDrawIndexedIndirectCommand{
+            .indexCount = meshlet.indexCount,
+            .instanceCount = 1,
+            .firstIndex = meshlet.indexOffset,
+            .vertexOffset = 0,
+            .firstInstance = 0,
+        };
     }
+    return count;
 }
@@ -1,18 +1,40 @@
 #ifndef RENDEROBJECT_H_
 #define RENDEROBJECT_H_
 
-#include "Buffer.h"
 #include "Image.h"
+#include "Mesh.h"
+#include "MeshBuffer.h"
+#include "ObjectBuffer.h"
 #include "Resource.h"
+#include "Vertex.h"
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <vulkan/vulkan_core.h>
 #include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
 
 class Material;
 class Device;
+class Camera;
+
+struct LodSelection
+{
+    // the coarsest level whose error projects to at most this many pixels is drawn
+    float maxPixelError = 1.f;
+    // finer levels than this are never drawn
+    uint32_t minLod = 0;
+};
+
+struct ClusterCulling
+{
+    // objects drawn at their first level of detail are drawn meshlet by meshlet if this is set
+    bool enabled = true;
+    bool frustum = true;
+    bool backface = true;
+};
 
 struct GlobalUniformData
 {
@@ -29,11 +51,28 @@ struct GlobalUniformData
 class RenderObject
 {
 public:
+    // called whenever the following draws use a different material than the previous ones,
+    // returns false if the material cannot be drawn yet, then its draws are skipped
+    typedef std::function<bool(const Material &)> MaterialBinder;
+
+    // host visible buffer that culled meshlet draws are written to and drawn from
+    struct IndirectCommands
+    {
+        VkBuffer buffer;
+        VkDrawIndexedIndirectCommand *commands;
+        uint32_t count;
+        // without multiDrawIndirect, one indirect draw is issued per command
+        bool multiDraw;
+    };
+
+    // materials has one entry per material slot of the mesh, meshName is the name mesh was resolved by
     RenderObject(
         uint32_t id,
         Device &device,
         const MeshResource &mesh,
-        const Material &material,
+        std::string meshName,
+        std::shared_ptr<const MeshBuffer> buffer,
+        std::vector<const Material *> materials,
         std::string name = ""
     );
     RenderObject(const RenderObject &) = delete;
@@ -47,18 +86,64 @@ public:
     uint32_t getId() const;
     const glm::mat4 &getTransform() const;
     void setTransform(const glm::mat4 &transform);
-    const Material &getMaterial() const;
+    ObjectData getObjectData() const;
+    // true if the object data changed since the last call, starts out true
+    bool takeObjectDataChanged();
+    const std::vector<const Material *> &getMaterials() const;
+    const MeshResource &getMeshResource() const;
+    const std::string &getMeshName() const;
+    // switches to the reloaded data of the mesh resource
+    void setMesh(const MeshResource &mesh, std::shared_ptr<const MeshBuffer> buffer);
+    VertexFormat getVertexFormat() const;
+    // see Mesh::getPositionTransform() and Mesh::getUvTransform()
+    const glm::mat4 &getPositionTransform() const;
+    const glm::vec4 &getUvTransform() const;
+    uint32_t getLodCount() const;
+    uint32_t getLod() const;
+    uint32_t getTriangleCount(uint32_t lod) const;
+    // picks the level of detail drawn by enqueueDrawCommands from the projected size of the bounds
+    uint32_t selectLod(const Camera &camera, float viewportHeight, const LodSelection &selection);
+    uint32_t getMeshletCount() const;
+    // true if the selected level of detail is split into meshlets
+    bool usesMeshlets() const;
 
-    void enqueueDrawCommands(VkCommandBuffer commandBuffer) const;
+    // binds the buffers once and issues one ranged draw per submesh of the selected level of detail
+    void enqueueDrawCommands(VkCommandBuffer commandBuffer, const MaterialBinder &bindMaterial) const;
+    // appends one command per meshlet passing the enabled tests to indirect and draws them,
+    // submeshes of the first level without meshlets get a ranged draw; returns the number of commands
+    uint32_t enqueueMeshletDrawCommands(
+        VkCommandBuffer commandBuffer,
+        const Camera &camera,
+        const ClusterCulling &culling,
+        IndirectCommands &indirect,
+        const MaterialBinder &bindMaterial
+    ) const;
 private:
+    void validateMaterials() const;
+    uint32_t cullMeshlets(
+        const Mesh::Submesh &submesh,
+        const Camera &camera,
+        const ClusterCulling &culling,
+        VkDrawIndexedIndirectCommand *commands
+    ) const;
+
     Device *device;
-    const Material *material;
+    std::vector<const Material *> materials;
     glm::mat4 transform;
+    VertexFormat vertexFormat;
+    glm::mat4 positionTransform;
+    glm::vec4 uvTransform;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    bool objectDataChanged = true;
+    // owned by the resource repository, which outlives all objects
+    const MeshResource *meshResource;
+    std::string meshName;
+    const Mesh *mesh;
+    uint32_t lod = 0;
     uint32_t indexCount;
     uint32_t vertexCount;
-    VkIndexType indexType;
-    Buffer vertexBuffer;
-    std::unique_ptr<Buffer> indexBuffer;
+    std::shared_ptr<const MeshBuffer> buffer;
     uint32_t id;
     std::string name;
 };
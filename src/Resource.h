@@ -1,6 +1,7 @@
 #ifndef RESOURCE_H_
 #define RESOURCE_H_
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <glm/vec3.hpp>
@@ -16,6 +17,40 @@ class Mesh;
 
 typedef uint64_t ResourceId;
 
+// Compact reference to a resource of type T: an index into the dense array of such resources
+// in the ResourceRepository. Names are resolved to handles once, afterwards handles are compared
+// and dereferenced as integers. Unlike the ResourceId, a handle stays the same when the resource is reloaded,
+// unless its name shared the handle with other names, see ResourceRepository::apply().
+template<typename T>
+struct ResourceHandle
+{
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    uint32_t index = INVALID_INDEX;
+
+    bool isValid() const;
+    bool operator==(const ResourceHandle<T> &other) const;
+    bool operator!=(const ResourceHandle<T> &other) const;
+};
+
+template<typename T>
+bool ResourceHandle<T>::isValid() const
+{
+    return index != INVALID_INDEX;
+}
+
+template<typename T>
+bool ResourceHandle<T>::operator==(const ResourceHandle<T> &other) const
+{
+    return index == other.index;
+}
+
+template<typename T>
+bool ResourceHandle<T>::operator!=(const ResourceHandle<T> &other) const
+{
+    return index != other.index;
+}
+
 template<typename T>
 class Resource
 {
@@ -73,14 +108,19 @@ struct ShaderResourceData
     std::unordered_map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> bindings;
 };
 typedef Resource<ShaderResourceData> ShaderResource;
+typedef ResourceHandle<ShaderResourceData> ShaderHandle;
 
 struct ImageResourceData
 {
     uint32_t width;
     uint32_t height;
+    // RGBA8 pixels, owned by the repository unless storage is set
     void *data;
+    // keeps memory that data points into alive, e.g. a mapped asset pack
+    std::shared_ptr<const void> storage;
 };
 typedef Resource<ImageResourceData> ImageResource;
+typedef ResourceHandle<ImageResourceData> ImageHandle;
 
 struct MaterialResourceData
 {
@@ -93,14 +133,25 @@ struct MaterialResourceData
     const ImageResource *diffuseTexture;
     const ImageResource *specularTexture;
     const ImageResource *normalTexture;
+    // bound in place of the textures if there are none, the fragment shader declares tex0 in every variant
+    const ImageResource *placeholderTexture;
 
     const ShaderResource *vertexShader;
+    // used for meshes with VertexFormat::COMPRESSED
+    const ShaderResource *compressedVertexShader;
     const ShaderResource *fragmentShader;
 
+    // the names the textures and shaders above were resolved by, in the same order;
+    // reloading one of several names sharing a resource only repoints the pointers resolved by that name
+    std::array<std::string, 4> textureNames;
+    std::array<std::string, 3> shaderNames;
+
     std::string name;
 };
 typedef Resource<MaterialResourceData> MaterialResource;
+typedef ResourceHandle<MaterialResourceData> MaterialHandle;
 
 typedef Resource<Mesh> MeshResource;
+typedef ResourceHandle<Mesh> MeshHandle;
 
 #endif
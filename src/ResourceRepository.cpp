@@ -1,20 +1,28 @@
 #include "ResourceRepository.h"
 #include "Mesh.h"
+#include "MeshFile.h"
 #include "Resource.h"
+#include "ShaderLayout.h"
+#include "StartupProfiler.h"
 #include "Utility.h"
 #include "Vertex.h"
 #include "third-party/stb_image.h"
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <ios>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <spdlog/spdlog.h>
@@ -25,32 +33,329 @@
 
 using namespace std::filesystem;
 
-ResourceRepository::ResourceRepository(const ResourceKey &defaultImage)
+namespace
 {
-    loadAll();
-    const auto &imageIter = images.find(defaultImage);
-    if (imageIter != images.end()) {
-        this->defaultImage = &imageIter->second;
+    // startup phases per ResourceRepository::ResourceType
+    const char *const LOAD_PHASES[] = {"load mesh", "load image", "load vertex shader", "load fragment shader"};
+}
+
+uint64_t MeshImportSettings::getHash() const
+{
+    size_t result = 0;
+    Utility::hash_combine(result, optimizer.getHash());
+    Utility::hash_combine(result, lod.getHash());
+    Utility::hash_combine(result, meshlets.getHash());
+    return result;
+}
+
+std::unordered_map<ResourceKey, MeshImportSettings> MeshImportSettings::loadOverrides(
+    const std::filesystem::path &path,
+    const MeshImportSettings &defaults
+)
+{
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error(fmt::format("MeshImportSettings: could not open {}", path.string()));
+    }
+
+    std::unordered_map<ResourceKey, MeshImportSettings> result;
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        // mesh names may contain spaces, settings never contain ':'
+        size_t separator = line.rfind(':');
+        if (separator == std::string::npos || separator == 0) {
+            throw std::runtime_error(fmt::format(
+                "MeshImportSettings: {}:{}: expected '<mesh name>: <setting>=<value> ...'",
+                path.string(), lineNumber
+            ));
+        }
+        MeshImportSettings &settings = result.emplace(line.substr(0, separator), defaults).first->second;
+
+        std::istringstream assignments(line.substr(separator + 1));
+        std::string assignment;
+        while (assignments >> assignment) {
+            size_t equals = assignment.find('=');
+            std::string key = assignment.substr(0, equals);
+            std::string value = equals != std::string::npos ? assignment.substr(equals + 1) : "";
+            auto toBool = [&]() {
+                if (value != "true" && value != "false") {
+                    throw std::invalid_argument("expected true or false");
+                }
+                return value == "true";
+            };
+            auto toUint = [&]() { return static_cast<uint32_t>(std::stoul(value)); };
+            auto toFloat = [&]() { return std::stof(value); };
+
+            try {
+                if (key == "optimizer.vertexCache") {
+                    settings.optimizer.vertexCache = toBool();
+                }
+                else if (key == "optimizer.overdraw") {
+                    settings.optimizer.overdraw = toBool();
+                }
+                else if (key == "optimizer.vertexFetch") {
+                    settings.optimizer.vertexFetch = toBool();
+                }
+                else if (key == "optimizer.cacheSize") {
+                    settings.optimizer.cacheSize = toUint();
+                }
+                else if (key == "optimizer.overdrawThreshold") {
+                    settings.optimizer.overdrawThreshold = toFloat();
+                }
+                else if (key == "lod.levelCount") {
+                    settings.lod.levelCount = toUint();
+                }
+                else if (key == "lod.reduction") {
+                    settings.lod.reduction = toFloat();
+                }
+                else if (key == "lod.targetError") {
+                    settings.lod.targetError = toFloat();
+                }
+                else if (key == "lod.errorGrowth") {
+                    settings.lod.errorGrowth = toFloat();
+                }
+                else if (key == "lod.minReduction") {
+                    settings.lod.minReduction = toFloat();
+                }
+                else if (key == "meshlets.maxVertices") {
+                    settings.meshlets.maxVertices = toUint();
+                }
+                else if (key == "meshlets.maxTriangles") {
+                    settings.meshlets.maxTriangles = toUint();
+                }
+                else if (key == "meshlets.minTriangles") {
+                    settings.meshlets.minTriangles = toUint();
+                }
+                else {
+                    throw std::invalid_argument("unknown setting");
+                }
+            } catch (const std::exception &e) {
+                throw std::runtime_error(fmt::format(
+                    "MeshImportSettings: {}:{}: invalid '{}': {}",
+                    path.string(), lineNumber, assignment, e.what()
+                ));
+            }
+        }
+    }
+
+    spdlog::info("MeshImportSettings: {} mesh overrides from {}", result.size(), path.string());
+    return result;
+}
+
+
+template<typename T>
+ResourceHandle<T> ResourceRepository::ResourceTable<T>::find(const ResourceKey &name) const
+{
+    auto i = handles.find(name);
+    return i != handles.end() ? ResourceHandle<T>{i->second} : ResourceHandle<T>{};
+}
+
+template<typename T>
+const Resource<T> &ResourceRepository::ResourceTable<T>::get(ResourceHandle<T> handle) const
+{
+    if (handle.index >= resources.size()) {
+        throw std::out_of_range(fmt::format("ResourceRepository: invalid resource handle {}", handle.index));
+    }
+    return resources[handle.index];
+}
+
+template<typename T>
+Resource<T> &ResourceRepository::ResourceTable<T>::get(ResourceHandle<T> handle)
+{
+    return const_cast<Resource<T> &>(static_cast<const ResourceTable<T> *>(this)->get(handle));
+}
+
+template<typename T>
+ResourceHandle<T> ResourceRepository::ResourceTable<T>::add(const ResourceKey &name, Resource<T> resource)
+{
+    if (handles.find(name) != handles.end()) {
+        throw std::runtime_error(fmt::format("ResourceRepository: Resource {} already exists", name));
+    }
+    if (resources.size() >= ResourceHandle<T>::INVALID_INDEX) {
+        throw std::length_error("ResourceRepository: too many resources of one type");
+    }
+    ResourceHandle<T> handle{static_cast<uint32_t>(resources.size())};
+    resources.push_back(std::move(resource));
+    names.push_back(name);
+    handles.emplace(name, handle.index);
+    return handle;
+}
+
+template<typename T>
+void ResourceRepository::ResourceTable<T>::alias(const ResourceKey &name, ResourceHandle<T> handle)
+{
+    if (!handles.emplace(name, handle.index).second) {
+        throw std::runtime_error(fmt::format("ResourceRepository: Resource {} already exists", name));
+    }
+}
+
+template<typename T>
+void ResourceRepository::ResourceTable<T>::forgetContent(ResourceHandle<T> handle)
+{
+    for (auto i = contents.begin(); i != contents.end();) {
+        i = i->second == handle.index ? contents.erase(i) : std::next(i);
+    }
+}
+
+template<typename T>
+bool ResourceRepository::ResourceTable<T>::isShared(ResourceHandle<T> handle) const
+{
+    size_t count = 0;
+    for (const auto &h : handles) {
+        if (h.second == handle.index && ++count > 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T>
+ResourceHandle<T> ResourceRepository::ResourceTable<T>::split(const ResourceKey &name, Resource<T> resource)
+{
+    auto i = handles.find(name);
+    if (i == handles.end()) {
+        throw std::runtime_error(fmt::format("ResourceRepository: Resource {} does not exist", name));
+    }
+    if (resources.size() >= ResourceHandle<T>::INVALID_INDEX) {
+        throw std::length_error("ResourceRepository: too many resources of one type");
+    }
+    uint32_t oldIndex = i->second;
+    ResourceHandle<T> handle{static_cast<uint32_t>(resources.size())};
+    resources.push_back(std::move(resource));
+    names.push_back(name);
+    i->second = handle.index;
+
+    // the old resource is listed under one of the names still sharing it
+    if (names[oldIndex] == name) {
+        for (const auto &h : handles) {
+            if (h.second == oldIndex) {
+                names[oldIndex] = h.first;
+                break;
+            }
+        }
+    }
+    return handle;
+}
+
+
+ResourceRepository::ResourceRepository(
+    const ResourceKey &defaultImage,
+    const MeshImportSettings &defaultMeshSettings,
+    std::unordered_map<ResourceKey, MeshImportSettings> meshSettings,
+    const std::filesystem::path &assetPackPath
+)
+    : root(current_path()),
+    defaultMeshSettings(defaultMeshSettings),
+    meshSettings(std::move(meshSettings))
+{
+    if (!assetPackPath.empty()) {
+        mountAssetPack(assetPackPath);
+    }
+    else {
+        buildIndex();
+    }
+    ImageHandle defaultImageHandle = findImage(defaultImage);
+    if (defaultImageHandle.isValid()) {
+        this->defaultImage = &get(defaultImageHandle);
+        defaultImageName = defaultImage;
     }
 }
 
 ResourceRepository::~ResourceRepository()
 {
-    for (auto &i : images) {
-        stbi_image_free(i.second.getData().data);
+    for (auto &i : images.resources) {
+        if (!i.getData().storage) {
+            stbi_image_free(i.getData().data);
+        }
     }
 }
 
 
 bool ResourceRepository::hasImage(const ResourceKey &name) const
 {
-    return images.find(name) != images.end();
+    return images.find(name).isValid() || getIndex(ResourceType::IMAGE).count(name) > 0;
+}
+
+const MeshImportSettings &ResourceRepository::getMeshSettings(const ResourceKey &name) const
+{
+    const auto &i = meshSettings.find(name);
+    return i != meshSettings.end() ? i->second : defaultMeshSettings;
+}
+
+MeshHandle ResourceRepository::findMesh(const ResourceKey &name)
+{
+    MeshHandle handle = meshes.find(name);
+    if (!handle.isValid() && loadIndexed(ResourceType::MESH, name)) {
+        handle = meshes.find(name);
+    }
+    return handle;
+}
+
+MaterialHandle ResourceRepository::findMaterial(const ResourceKey &name)
+{
+    MaterialHandle handle = materials.find(name);
+    // materials are defined by meshes, only the one the index recorded for it is loaded
+    if (!handle.isValid()) {
+        auto i = materialMeshes.find(name);
+        if (i != materialMeshes.end() && loadIndexed(ResourceType::MESH, i->second)) {
+            handle = materials.find(name);
+        }
+    }
+    return handle;
+}
+
+ImageHandle ResourceRepository::findImage(const ResourceKey &name)
+{
+    ImageHandle handle = images.find(name);
+    if (!handle.isValid() && loadIndexed(ResourceType::IMAGE, name)) {
+        handle = images.find(name);
+    }
+    return handle;
 }
 
-const MeshResource &ResourceRepository::getMesh(const ResourceKey &name) const
+ShaderHandle ResourceRepository::findFragmentShader(const ResourceKey &name)
 {
-    const auto &i = meshes.find(name);
-    if (i == meshes.end()) {
+    return findShader(ResourceType::FRAGMENT_SHADER, name);
+}
+
+ShaderHandle ResourceRepository::findVertexShader(const ResourceKey &name)
+{
+    return findShader(ResourceType::VERTEX_SHADER, name);
+}
+
+const MeshResource &ResourceRepository::get(MeshHandle handle) const
+{
+    return meshes.get(handle);
+}
+
+const MaterialResource &ResourceRepository::get(MaterialHandle handle) const
+{
+    return materials.get(handle);
+}
+
+const ImageResource &ResourceRepository::get(ImageHandle handle) const
+{
+    return images.get(handle);
+}
+
+const ShaderResource &ResourceRepository::get(ShaderHandle handle) const
+{
+    return shaders.get(handle);
+}
+
+const ResourceKey &ResourceRepository::getName(MeshHandle handle) const
+{
+    meshes.get(handle);
+    return meshes.names[handle.index];
+}
+
+const MeshResource &ResourceRepository::getMesh(const ResourceKey &name)
+{
+    MeshHandle handle = findMesh(name);
+    if (!handle.isValid()) {
         if (defaultMesh == nullptr) {
             throw std::runtime_error(fmt::format(
                 "ResourceRepository::get*: Resource {} does not exist", name
@@ -60,24 +365,24 @@ const MeshResource &ResourceRepository::getMesh(const ResourceKey &name) const
             return *defaultMesh;
         }
     }
-    return i->second;
+    return get(handle);
 }
 
-const MaterialResource &ResourceRepository::getMaterial(const ResourceKey &name) const
+const MaterialResource &ResourceRepository::getMaterial(const ResourceKey &name)
 {
-    const auto &i = materials.find(name);
-    if (i == materials.end()) {
+    MaterialHandle handle = findMaterial(name);
+    if (!handle.isValid()) {
         throw std::runtime_error(fmt::format(
             "ResourceRepository::get*: Resource {} does not exist", name
         ));
     }
-    return i->second;
+    return get(handle);
 }
 
-const ImageResource &ResourceRepository::getImage(const ResourceKey &name) const
+const ImageResource &ResourceRepository::getImage(const ResourceKey &name)
 {
-    const auto &i = images.find(name);
-    if (i == images.end()) {
+    ImageHandle handle = findImage(name);
+    if (!handle.isValid()) {
         if (defaultImage == nullptr) {
             throw std::runtime_error(fmt::format(
                 "ResourceRepository::get*: Resource {} does not exist", name
@@ -87,31 +392,53 @@ const ImageResource &ResourceRepository::getImage(const ResourceKey &name) const
             return *defaultImage;
         }
     }
-    return i->second;
+    return get(handle);
 }
 
-const ShaderResource &ResourceRepository::getFragmentShader(const ResourceKey &name) const
+const ShaderResource &ResourceRepository::getFragmentShader(const ResourceKey &name)
 {
-    const auto &i = fragmentShaders.find(name);
-    if (i == fragmentShaders.end()) {
+    ShaderHandle handle = findFragmentShader(name);
+    if (!handle.isValid()) {
         throw std::runtime_error(fmt::format("ResourceRepository::get*: Resource {} does not exist", name));
     }
-    return i->second;
+    return get(handle);
 }
 
-const ShaderResource &ResourceRepository::getVertexShader(const ResourceKey &name) const
+const ShaderResource &ResourceRepository::getVertexShader(const ResourceKey &name)
 {
-    const auto &i = vertexShaders.find(name);
-    if (i == vertexShaders.end()) {
+    ShaderHandle handle = findVertexShader(name);
+    if (!handle.isValid()) {
         throw std::runtime_error(fmt::format("ResourceRepository::get*: Resource {} does not exist", name));
     }
-    return i->second;
+    return get(handle);
+}
+
+void ResourceRepository::prefetch(const std::vector<ResourceKey> &names)
+{
+    for (const ResourceKey &name : names) {
+        for (size_t type = 0; type < RESOURCE_TYPE_COUNT; ++type) {
+            loadIndexed(static_cast<ResourceType>(type), name);
+        }
+    }
 }
 
 void ResourceRepository::loadObj(const ResourceKey &name, const std::filesystem::path &path)
 {
+    if (loadCachedObj(name, path)) {
+        return;
+    }
+
     spdlog::info("Loading .obj object {} ", path.string());
+    std::unique_ptr<Mesh> mesh = createObjMesh(name, path, decodeObj(name, path, getMeshSettings(name)));
+    addUnique(meshes, name, std::move(mesh));
+}
 
+ResourceRepository::ObjData ResourceRepository::decodeObj(
+    const ResourceKey &name,
+    const std::filesystem::path &path,
+    const MeshImportSettings &settings
+)
+{
     tinyobj::attrib_t attrib{};
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -123,23 +450,27 @@ void ResourceRepository::loadObj(const ResourceKey &name, const std::filesystem:
         }
     }
 
-    bool ok = tinyobj::LoadObj(
-        &attrib,
-        &shapes,
-        &materials,
-        &error,
-        path.c_str(),
-        mtlBasePath.c_str()
-    );
+    std::unordered_map<size_t, size_t> vertexHashIndexMap;
+    std::vector<Vertex> newVertices;
+    // triangles grouped by material id, -1 for faces without a material
+    std::map<int, std::vector<Mesh::IndexType>> materialIndices;
+
+    bool ok;
+    {
+        StartupProfiler::Scope scope("parse obj", name);
+        ok = tinyobj::LoadObj(
+            &attrib,
+            &shapes,
+            &materials,
+            &error,
+            path.c_str(),
+            mtlBasePath.c_str()
+        );
+    }
     if (!ok || !error.empty()) {
         throw std::runtime_error(fmt::format("Failed to load mesh {}: {}", name, error));
     }
 
-    std::unordered_map<size_t, size_t> vertexHashIndexMap;
-    std::vector<Vertex> newVertices;
-    std::vector<Mesh::IndexType> newIndices;
-    int materialIdx = -1;
-
     for (const auto &shape : shapes) {
         size_t indexOffset = 0;
         const auto &mesh = shape.mesh;
@@ -150,9 +481,7 @@ void ResourceRepository::loadObj(const ResourceKey &name, const std::filesystem:
                     fmt::format("Failed to load mesh {}: At least one face is not triangular", name)
                 );
             }
-            if (materialIdx == -1) {
-                materialIdx = mesh.material_ids[faceIndex];
-            }
+            std::vector<Mesh::IndexType> &faceIndices = materialIndices[mesh.material_ids[faceIndex]];
 
             // 3 vertices per face for a triangle, inverting winding order
             std::array<size_t, 3> triangleIndices = {0, 2, 1};
@@ -193,12 +522,12 @@ void ResourceRepository::loadObj(const ResourceKey &name, const std::filesystem:
                 size_t hash = hasher(vertex);
                 auto vertexHashIndexIter = vertexHashIndexMap.find(hash);
                 if (vertexHashIndexIter != vertexHashIndexMap.end()) {
-                    newIndices.push_back(vertexHashIndexIter->second);
+                    faceIndices.push_back(vertexHashIndexIter->second);
                 }
                 else {
                     size_t vi = newVertices.size();
                     newVertices.push_back(vertex);
-                    newIndices.push_back(vi);
+                    faceIndices.push_back(vi);
                     vertexHashIndexMap.insert(std::make_pair(hash, vi));
                 }
             }
@@ -207,26 +536,151 @@ void ResourceRepository::loadObj(const ResourceKey &name, const std::filesystem:
     }
 
 
-    std::map<int, const MaterialResource *> materialResources;
-    for (int i = 0; i < static_cast<int>(materials.size()); ++i) {
-        materialResources[i] = loadObjMaterial(materials[i]);
+    // faces without a material use the first material of the mesh, as long as there is one
+    auto withoutMaterial = materialIndices.find(-1);
+    if (withoutMaterial != materialIndices.end() && materialIndices.size() > 1) {
+        std::vector<Mesh::IndexType> &target = std::next(withoutMaterial)->second;
+        target.insert(target.end(), withoutMaterial->second.begin(), withoutMaterial->second.end());
+        materialIndices.erase(withoutMaterial);
     }
-    // TODO: actually assign all materials and not just the first
-    const auto iter = materialResources.find(materialIdx);
-    const MaterialResource *mat =  iter != materialResources.end() ? iter->second : nullptr;
-    meshes.emplace(
-        name,
-        MeshResource{
-            nextResourceId++,
-            std::make_unique<Mesh>(std::move(newVertices), std::move(newIndices), mat)
+
+    // every material gets its own chain of levels, so material borders are never simplified away;
+    // level i of the mesh holds level i of every material, or its coarsest one if the chain is shorter
+    MeshSimplifier simplifier(settings.lod);
+    std::vector<std::vector<Mesh::Lod>> materialLods;
+    size_t levelCount = 1;
+    {
+        StartupProfiler::Scope scope("generate lods", name);
+        for (auto &i : materialIndices) {
+            materialLods.push_back(simplifier.generateLods(newVertices, i.second));
+            levelCount = std::max(levelCount, materialLods.back().size());
+        }
+    }
+
+    std::vector<Mesh::IndexType> newIndices;
+    std::vector<Mesh::Lod> lods;
+    std::vector<Mesh::Submesh> submeshes;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        Mesh::Lod lod{static_cast<uint32_t>(newIndices.size()), 0, 0.f};
+        size_t group = 0;
+        for (const auto &i : materialIndices) {
+            const std::vector<Mesh::Lod> &groupLods = materialLods[group++];
+            const Mesh::Lod &groupLod = groupLods[std::min<size_t>(level, groupLods.size() - 1)];
+            submeshes.push_back(Mesh::Submesh{
+                .lod = level,
+                .material = i.first < 0 ? 0 : static_cast<uint32_t>(i.first),
+                .indexOffset = static_cast<uint32_t>(newIndices.size()),
+                .indexCount = groupLod.indexCount,
+                .meshletOffset = 0,
+                .meshletCount = 0,
+            });
+            auto begin = i.second.begin() + groupLod.indexOffset;
+            newIndices.insert(newIndices.end(), begin, begin + groupLod.indexCount);
+            lod.error = std::max(lod.error, groupLod.error);
+        }
+        lod.indexCount = static_cast<uint32_t>(newIndices.size()) - lod.indexOffset;
+        lods.push_back(lod);
+    }
+    if (lods.size() > 1) {
+        std::string levels;
+        for (size_t i = 0; i < lods.size(); ++i) {
+            levels += fmt::format(" {}: {} triangles (error {:.4f})", i, lods[i].indexCount / 3, lods[i].error);
+        }
+        spdlog::info("Generated levels of detail for mesh {}:{}", name, levels);
+    }
+
+    if (settings.optimizer.isEnabled() && !newIndices.empty()) {
+        StartupProfiler::Scope scope("optimize mesh", name);
+        MeshOptimizer optimizer(settings.optimizer);
+        MeshOptimizer::Result result = optimizer.optimize(newVertices, newIndices, submeshes);
+        spdlog::info(
+            "Optimized mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+            name,
+            result.before.acmr,
+            result.after.acmr,
+            result.before.atvr,
+            result.after.atvr
+        );
+    }
+
+    MeshletBuilder meshletBuilder(settings.meshlets);
+    std::vector<Mesh::Meshlet> meshlets;
+    {
+        StartupProfiler::Scope scope("build meshlets", name);
+        for (Mesh::Submesh &submesh : submeshes) {
+            if (submesh.lod != 0) {
+                continue;
+            }
+            std::vector<Mesh::Meshlet> submeshMeshlets = meshletBuilder.build(
+                newVertices,
+                newIndices,
+                submesh.indexOffset,
+                submesh.indexCount
+            );
+            submesh.meshletOffset = static_cast<uint32_t>(meshlets.size());
+            submesh.meshletCount = static_cast<uint32_t>(submeshMeshlets.size());
+            meshlets.insert(meshlets.end(), submeshMeshlets.begin(), submeshMeshlets.end());
         }
+    }
+    if (!meshlets.empty()) {
+        spdlog::info("Split mesh {} into {} meshlets", name, meshlets.size());
+    }
+
+    spdlog::info("Mesh {} has {} submeshes per level of detail", name, materialIndices.size());
+
+    return ObjData{
+        .vertices = std::move(newVertices),
+        .indices = std::move(newIndices),
+        .lods = std::move(lods),
+        .meshlets = std::move(meshlets),
+        .submeshes = std::move(submeshes),
+        .materials = std::move(materials),
+    };
+}
+
+std::unique_ptr<Mesh> ResourceRepository::createObjMesh(
+    const ResourceKey &name,
+    const std::filesystem::path &path,
+    ObjData data
+)
+{
+    std::vector<const MaterialResource *> materialResources;
+    for (const auto &material : data.materials) {
+        materialResources.push_back(loadObjMaterial(material));
+    }
+    // .obj files carry no vertex colors, so nothing is lost by compressing
+    auto mesh = std::make_unique<Mesh>(
+        std::move(data.vertices),
+        std::move(data.indices),
+        std::move(materialResources),
+        VertexFormat::COMPRESSED,
+        std::move(data.lods),
+        std::move(data.meshlets),
+        std::move(data.submeshes)
     );
+
+    try {
+        StartupProfiler::Scope scope("write mesh cache", name);
+        writeObjCache(name, path, *mesh, data.materials);
+    }
+    catch (std::exception &e) {
+        spdlog::warn("ResourceRepository: could not write mesh cache for {}: {}", name, e.what());
+    }
+    return mesh;
 }
 
 void ResourceRepository::loadImage(const ResourceKey &name, const std::filesystem::path &path)
 {
     spdlog::info("Loading image {} ", path.string());
+    addUnique(images, name, decodeImage(name, path));
+}
 
+std::unique_ptr<ImageResourceData> ResourceRepository::decodeImage(
+    const ResourceKey &name,
+    const std::filesystem::path &path
+)
+{
+    StartupProfiler::Scope scope("decode image", name);
     int wdt;
     int hgt;
     int channels;
@@ -242,72 +696,334 @@ void ResourceRepository::loadImage(const ResourceKey &name, const std::filesyste
         throw std::runtime_error(fmt::format("Failed to load image {}", name));
     }
 
-    images.emplace(name, ImageResource{
-        nextResourceId++,
-        std::unique_ptr<ImageResourceData>(new ImageResourceData{
-            (uint32_t) wdt,
-            (uint32_t) hgt,
-            (void *) imageData
-        })
+    return std::unique_ptr<ImageResourceData>(new ImageResourceData{
+        (uint32_t) wdt,
+        (uint32_t) hgt,
+        (void *) imageData
     });
 }
 
 void ResourceRepository::loadFragmentShader(const ResourceKey &name, const std::filesystem::path &path)
 {
     spdlog::info("Loading fragment shader {} ", path.string());
-    auto shaderCode = readShaderFile(path);
-    spv_reflect::ShaderModule reflectModule{shaderCode.size(), shaderCode.data()};
-
-    fragmentShaders.emplace(name, ShaderResource{
-        nextResourceId++,
-        std::unique_ptr<ShaderResourceData>(new ShaderResourceData{
-            VK_SHADER_STAGE_FRAGMENT_BIT,
-            std::move(shaderCode),
-            getShaderBindings(reflectModule),
-        }),
-    });
+    addUnique(shaders, name, decodeShader(path, VK_SHADER_STAGE_FRAGMENT_BIT));
 }
 
 void ResourceRepository::loadVertexShader(const ResourceKey &name, const std::filesystem::path &path)
 {
     spdlog::info("Loading vertex shader {} ", path.string());
-    auto shaderCode = readShaderFile(path);
-    spv_reflect::ShaderModule reflectModule{shaderCode.size(), shaderCode.data()};
-    
-    vertexShaders.emplace(name, ShaderResource{
-        nextResourceId++,
-        std::unique_ptr<ShaderResourceData>(new ShaderResourceData{
-            VK_SHADER_STAGE_VERTEX_BIT,
-            std::move(shaderCode),
-            getShaderBindings(reflectModule),
-        })
+    addUnique(shaders, name, decodeShader(path, VK_SHADER_STAGE_VERTEX_BIT));
+}
+
+std::unique_ptr<ShaderResourceData> ResourceRepository::decodeShader(
+    const std::filesystem::path &path,
+    VkShaderStageFlags stage
+)
+{
+    std::vector<std::byte> code;
+    {
+        StartupProfiler::Scope scope("read shader", path.string());
+        code = readShaderFile(path);
+    }
+    return createShaderData(std::move(code), stage);
+}
+
+std::unique_ptr<ShaderResourceData> ResourceRepository::createShaderData(
+    std::vector<std::byte> code,
+    VkShaderStageFlags stage
+)
+{
+    // shaders compiled with the application come with their layout, only others are reflected
+    Shader::DescriptorSetLayoutBindingMap bindings;
+    const ShaderLayout *layout = ShaderLayout::find(code);
+    if (layout && (layout->stage & stage)) {
+        bindings = layout->getBindingMap();
+    }
+    else {
+        StartupProfiler::Scope scope("reflect shader");
+        spv_reflect::ShaderModule reflectModule{code.size(), code.data()};
+        bindings = getShaderBindings(reflectModule);
+    }
+
+    return std::unique_ptr<ShaderResourceData>(new ShaderResourceData{
+        stage,
+        std::move(code),
+        std::move(bindings),
     });
 }
 
-std::string ResourceRepository::resourceTree(size_t indentationLevel) const
+void ResourceRepository::writeAssetPack(const std::filesystem::path &path)
 {
-    size_t count = meshes.size()
-        + materials.size()
-        + images.size()
-        + vertexShaders.size()
-        + fragmentShaders.size();
-    std::vector<std::string> keys;
-    keys.reserve(count);
+    if (assetPack) {
+        throw std::runtime_error("ResourceRepository::writeAssetPack: resources are already served from a pack");
+    }
+
+    auto appendBytes = [](std::vector<std::byte> &destination, const void *source, size_t size) {
+        const std::byte *bytes = static_cast<const std::byte *>(source);
+        destination.insert(destination.end(), bytes, bytes + size);
+    };
+
+    // a copy, loading removes the entries from the index
+    const auto files = index;
+    std::vector<AssetPack::Blob> blobs;
+    size_t totalSize = 0;
+    for (size_t t = 0; t < RESOURCE_TYPE_COUNT; ++t) {
+        const ResourceType type = static_cast<ResourceType>(t);
+        for (const auto &file : files[t]) {
+            const ResourceKey &name = file.first;
+            loadIndexed(type, name);
 
-    for (const auto &i : meshes) {
-        keys.push_back(fmt::format("{} ({})", i.first, i.second.getId()));
+            AssetPack::Blob blob{static_cast<uint32_t>(type), name, {}};
+            if (type == ResourceType::MESH && meshes.find(name).isValid()) {
+                // the mesh cache holds the processed mesh in exactly the layout the pack needs
+                std::filesystem::path cachePath = MeshFile::getCachePath(file.second.path);
+                if (!exists(cachePath)
+                    || !MeshFile(cachePath).isUpToDate(file.second.path, getMeshSettings(name).getHash())
+                ) {
+                    spdlog::error("ResourceRepository: no up to date mesh cache for {}, not packed", name);
+                    continue;
+                }
+                blob.data = Utility::readFile(cachePath);
+            }
+            else if (type == ResourceType::IMAGE && images.find(name).isValid()) {
+                const ImageResourceData &image = images.get(images.find(name)).getData();
+                AssetPack::ImageHeader imageHeader{image.width, image.height, 0};
+                appendBytes(blob.data, &imageHeader, sizeof(imageHeader));
+                appendBytes(blob.data, image.data, size_t(image.width) * image.height * 4);
+            }
+            else if ((type == ResourceType::VERTEX_SHADER || type == ResourceType::FRAGMENT_SHADER)
+                && shaders.find(name).isValid()
+            ) {
+                blob.data = shaders.get(shaders.find(name)).getData().code;
+            }
+            else {
+                spdlog::error("ResourceRepository: {} could not be loaded, not packed", name);
+                continue;
+            }
+            totalSize += blob.data.size();
+            blobs.push_back(std::move(blob));
+        }
+    }
+
+    size_t count = blobs.size();
+    AssetPack::write(path, std::move(blobs));
+    spdlog::info(
+        "ResourceRepository: wrote {} resources ({:.1f} MiB) to {}",
+        count,
+        static_cast<double>(totalSize) / (1024. * 1024.),
+        path.string()
+    );
+}
+
+std::vector<ResourceKey> ResourceRepository::getMeshNames() const
+{
+    const auto &meshIndex = getIndex(ResourceType::MESH);
+    std::vector<ResourceKey> names;
+    names.reserve(meshes.names.size() + meshIndex.size());
+    names.insert(names.end(), meshes.names.begin(), meshes.names.end());
+    for (const auto &i : meshIndex) {
+        names.push_back(i.first);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::vector<ResourceKey> ResourceRepository::getMaterialNames() const
+{
+    std::vector<ResourceKey> names = materials.names;
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+MeshHandle ResourceRepository::addMesh(const ResourceKey &name, Mesh mesh)
+{
+    return meshes.add(name, MeshResource{nextResourceId++, std::make_unique<Mesh>(std::move(mesh))});
+}
+
+MaterialHandle ResourceRepository::addMaterial(const ResourceKey &name, const MaterialResourceData &data)
+{
+    return materials.add(name, MaterialResource{nextResourceId++, std::make_unique<MaterialResourceData>(data)});
+}
+
+std::optional<ResourceRepository::ReloadRequest> ResourceRepository::getReloadRequest(
+    const std::filesystem::path &path
+) const
+{
+    auto resource = classify(path);
+    if (!resource) {
+        return std::nullopt;
+    }
+    // resources that are not loaded yet are read from the changed file anyway
+    const ResourceKey &name = resource->second;
+    bool loaded = false;
+    switch (resource->first) {
+    case ResourceType::MESH:
+        loaded = meshes.find(name).isValid();
+        break;
+    case ResourceType::IMAGE:
+        loaded = images.find(name).isValid();
+        break;
+    case ResourceType::VERTEX_SHADER:
+    case ResourceType::FRAGMENT_SHADER:
+        loaded = shaders.find(name).isValid();
+        break;
+    }
+    if (!loaded) {
+        return std::nullopt;
+    }
+    return ReloadRequest{resource->first, name, path, getMeshSettings(name)};
+}
+
+ResourceRepository::Reload ResourceRepository::decode(const ReloadRequest &request)
+{
+    Reload reload{request.type, request.name, request.path, nullptr, nullptr, nullptr};
+    switch (request.type) {
+    case ResourceType::MESH:
+        reload.mesh = std::make_unique<ObjData>(decodeObj(request.name, request.path, request.meshSettings));
+        break;
+    case ResourceType::IMAGE:
+        reload.image = decodeImage(request.name, request.path);
+        break;
+    case ResourceType::VERTEX_SHADER:
+    case ResourceType::FRAGMENT_SHADER:
+        reload.shader = decodeShader(request.path, getShaderStage(request.type));
+        break;
+    }
+    return reload;
+}
+
+std::optional<ResourceId> ResourceRepository::apply(Reload reload)
+{
+    switch (reload.type) {
+    case ResourceType::MESH:
+        return replace(meshes, reload.name, createObjMesh(reload.name, reload.path, std::move(*reload.mesh)));
+    case ResourceType::IMAGE: {
+        ImageHandle handle = images.find(reload.name);
+        void *oldData = handle.isValid() && !images.get(handle).getData().storage
+            ? images.get(handle).getData().data
+            : nullptr;
+        std::optional<ResourceId> oldId = replace(images, reload.name, std::move(reload.image));
+        if (oldId) {
+            stbi_image_free(oldData);
+        }
+        else {
+            repointMaterials(reload.name);
+        }
+        return oldId;
+    }
+    case ResourceType::VERTEX_SHADER:
+    case ResourceType::FRAGMENT_SHADER: {
+        std::optional<ResourceId> oldId = replace(shaders, reload.name, std::move(reload.shader));
+        if (!oldId) {
+            repointMaterials(reload.name);
+        }
+        return oldId;
+    }
+    }
+    throw std::invalid_argument("ResourceRepository::apply: invalid resource type");
+}
+
+template<typename T>
+std::optional<ResourceId> ResourceRepository::replace(
+    ResourceTable<T> &table,
+    const ResourceKey &name,
+    std::unique_ptr<T> data
+)
+{
+    auto handle = table.find(name);
+    if (!handle.isValid()) {
+        throw std::runtime_error(fmt::format("ResourceRepository::apply: Resource {} is not loaded", name));
     }
-    for (const auto &i : materials) {
-        keys.push_back(fmt::format("{} ({})", i.first, i.second.getId()));
+    uint64_t size = 0;
+    Utility::Hash128 hash = hashContent(*data, size);
+
+    // an alias no longer has the content of the others, which keep the old resource
+    if (table.isShared(handle)) {
+        ResourceHandle<T> splitHandle = table.split(name, Resource<T>{nextResourceId++, std::move(data)});
+        table.contents.emplace(hash, splitHandle.index);
+        spdlog::info("ResourceRepository: {} no longer has the same content as {}", name, table.names[handle.index]);
+        return std::nullopt;
     }
-    for (const auto &i : images) {
-        keys.push_back(fmt::format("{} ({})", i.first, i.second.getId()));
+
+    // the resource stays in its slot, so handles and pointers to it remain valid
+    auto &resource = table.get(handle);
+    table.forgetContent(handle);
+    ResourceId oldId = resource.id;
+    resource.id = nextResourceId++;
+    resource.data = std::move(data);
+    table.contents.emplace(hash, handle.index);
+    return oldId;
+}
+
+void ResourceRepository::repointMaterials(const ResourceKey &name)
+{
+    ImageHandle image = images.find(name);
+    bool defaultImageSplit = image.isValid() && name == defaultImageName;
+    if (defaultImageSplit) {
+        defaultImage = &images.get(image);
     }
-    for (const auto &i : vertexShaders) {
-        keys.push_back(fmt::format("{} ({})", i.first, i.second.getId()));
+    ShaderHandle shader = shaders.find(name);
+    for (MaterialResource &material : materials.resources) {
+        MaterialResourceData &data = material.getData();
+        if (defaultImageSplit && data.placeholderTexture) {
+            data.placeholderTexture = defaultImage;
+        }
+        std::array<const ImageResource **, 4> textures = {
+            &data.ambientTexture,
+            &data.diffuseTexture,
+            &data.specularTexture,
+            &data.normalTexture,
+        };
+        for (size_t i = 0; i < textures.size(); ++i) {
+            if (image.isValid() && *textures[i] && data.textureNames[i] == name) {
+                *textures[i] = &images.get(image);
+            }
+        }
+        std::array<const ShaderResource **, 3> materialShaders = {
+            &data.vertexShader,
+            &data.compressedVertexShader,
+            &data.fragmentShader,
+        };
+        for (size_t i = 0; i < materialShaders.size(); ++i) {
+            if (shader.isValid() && *materialShaders[i] && data.shaderNames[i] == name) {
+                *materialShaders[i] = &shaders.get(shader);
+            }
+        }
     }
-    for (const auto &i : fragmentShaders) {
-        keys.push_back(fmt::format("{} ({})", i.first, i.second.getId()));
+}
+
+const ResourceRepository::DeduplicationStatistics &ResourceRepository::getDeduplicationStatistics() const
+{
+    return deduplicationStatistics;
+}
+
+std::string ResourceRepository::resourceTree(size_t indentationLevel) const
+{
+    size_t count = meshes.resources.size()
+        + materials.resources.size()
+        + images.resources.size()
+        + shaders.resources.size();
+    std::vector<std::string> keys;
+    keys.reserve(count);
+
+    auto addKeys = [&keys](const auto &table) {
+        for (size_t i = 0; i < table.resources.size(); ++i) {
+            keys.push_back(fmt::format("{} ({})", table.names[i], table.resources[i].getId()));
+        }
+        for (const auto &i : table.handles) {
+            if (table.names[i.second] != i.first) {
+                keys.push_back(fmt::format("{} (same as {})", i.first, table.names[i.second]));
+            }
+        }
+    };
+    addKeys(meshes);
+    addKeys(materials);
+    addKeys(images);
+    addKeys(shaders);
+    for (const auto &typeIndex : index) {
+        for (const auto &i : typeIndex) {
+            keys.push_back(fmt::format("{} (not loaded, {} bytes)", i.first, i.second.size));
+        }
     }
 
     std::sort(keys.begin(), keys.end());
@@ -321,70 +1037,345 @@ std::string ResourceRepository::resourceTree(size_t indentationLevel) const
     return output;
 }
 
-void ResourceRepository::load(const path &path, const std::string extension)
+void ResourceRepository::buildIndex()
 {
-    std::string resourceName = path.lexically_relative(current_path()).generic_string();
-    resourceName = resourceName.substr(0, resourceName.size() - extension.size());
+    StartupProfiler::Scope scope("index resources", root.string());
+    auto startTime = std::chrono::high_resolution_clock::now();
+    uintmax_t totalSize = 0;
+    size_t count = 0;
 
-    try {
-        if (extension == ".obj") {
-            loadObj(resourceName, path);
+    // only names, types and sizes are recorded, nothing is read but the material names of meshes
+    for (recursive_directory_iterator i(root), end; i != end; ++i) {
+        const std::string fileName = i->path().filename().string();
+        if (i->is_directory()) {
+            // hidden trees like .git never contain resources
+            if (!fileName.empty() && fileName[0] == '.') {
+                i.disable_recursion_pending();
+            }
+            continue;
         }
-        else if (extension == ".png" || extension == ".jpg") {
-            loadImage(resourceName, path);
+        if (!i->is_regular_file()) {
+            continue;
         }
-        else if(extension == ".spv") {
-            if (resourceName.rfind(".frag") != std::string::npos) {
-                loadFragmentShader(resourceName, path);
-            }
-            else if (resourceName.rfind(".vert") != std::string::npos) {
-                loadVertexShader(resourceName, path);
+
+        auto resource = classify(i->path());
+        if (!resource) {
+            continue;
+        }
+
+        uintmax_t size = i->file_size();
+        getIndex(resource->first).emplace(resource->second, IndexEntry{i->path(), size, resource->first});
+        if (resource->first == ResourceType::MESH) {
+            indexObjMaterials(resource->second, i->path());
+        }
+        totalSize += size;
+        ++count;
+    }
+
+    auto duration = std::chrono::duration<double, std::chrono::milliseconds::period>(
+        std::chrono::high_resolution_clock::now() - startTime
+    );
+    spdlog::info(
+        "ResourceRepository: indexed {} resources ({:.1f} MiB) in {:.1f} ms",
+        count,
+        static_cast<double>(totalSize) / (1024. * 1024.),
+        duration.count()
+    );
+}
+
+void ResourceRepository::mountAssetPack(const std::filesystem::path &path)
+{
+    StartupProfiler::Scope scope("mount asset pack", path.string());
+    auto startTime = std::chrono::high_resolution_clock::now();
+    assetPack = std::make_unique<AssetPack>(path);
+
+    // the table of contents is used in place, nothing but the names is copied
+    const AssetPack::Header &header = assetPack->getHeader();
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+        const AssetPack::Entry &entry = assetPack->getEntries()[i];
+        if (entry.type >= RESOURCE_TYPE_COUNT) {
+            spdlog::warn("ResourceRepository: skipping {} of unknown type {}", assetPack->getName(entry), entry.type);
+            continue;
+        }
+        ResourceType type = static_cast<ResourceType>(entry.type);
+        const ResourceKey name = assetPack->getName(entry);
+        getIndex(type).emplace(name, IndexEntry{path, entry.size, type, &entry});
+        if (type == ResourceType::MESH) {
+            // only the header and material records of the mesh file are read
+            MeshFile file(assetPack->getMapping(), entry.offset, entry.size);
+            const MeshFile::MaterialRecord *records = file.getMaterialRecords();
+            for (uint32_t r = 0; r < file.getHeader().materialCount; ++r) {
+                ResourceKey material(records[r].name, strnlen(records[r].name, MeshFile::NAME_LENGTH));
+                materialMeshes.emplace(material, name);
             }
         }
-        else {
-            spdlog::warn("No loader for resource {}{}", resourceName, extension);
+    }
+
+    auto duration = std::chrono::duration<double, std::chrono::milliseconds::period>(
+        std::chrono::high_resolution_clock::now() - startTime
+    );
+    spdlog::info(
+        "ResourceRepository: mounted {} with {} resources in {:.1f} ms",
+        path.string(),
+        header.entryCount,
+        duration.count()
+    );
+}
+
+void ResourceRepository::loadPacked(ResourceType type, const ResourceKey &name, const AssetPack::Entry &entry)
+{
+    spdlog::info("Loading {} from asset pack", name);
+    {
+        StartupProfiler::Scope scope("verify pack blob", name);
+        assetPack->verify(entry);
+    }
+
+    const std::byte *data = assetPack->getData(entry);
+    switch (type) {
+    case ResourceType::MESH:
+        loadMeshFile(name, std::make_shared<const MeshFile>(assetPack->getMapping(), entry.offset, entry.size));
+        break;
+    case ResourceType::IMAGE: {
+        const auto &imageHeader = *reinterpret_cast<const AssetPack::ImageHeader *>(data);
+        if (entry.size < sizeof(imageHeader)
+            || entry.size - sizeof(imageHeader) < uint64_t(imageHeader.width) * imageHeader.height * 4
+        ) {
+            throw std::runtime_error(fmt::format("Image {} in asset pack is truncated", name));
         }
+        // the pixels are uploaded straight from the mapping, which is never written to
+        addUnique(images, name, std::unique_ptr<ImageResourceData>(new ImageResourceData{
+            imageHeader.width,
+            imageHeader.height,
+            const_cast<std::byte *>(data + sizeof(imageHeader)),
+            assetPack->getMapping(),
+        }));
+        break;
+    }
+    case ResourceType::VERTEX_SHADER:
+    case ResourceType::FRAGMENT_SHADER: {
+        // shader code is small and handed to vkCreateShaderModule once, so it is copied
+        addUnique(
+            shaders,
+            name,
+            createShaderData(std::vector<std::byte>(data, data + entry.size), getShaderStage(type))
+        );
+        break;
     }
-    catch (std::exception &e) {
-        spdlog::error("ResourceRepository: Loading resource {} failed: {}!", resourceName, e.what());
     }
 }
 
-void ResourceRepository::loadAll()
+std::optional<std::pair<ResourceRepository::ResourceType, ResourceKey>> ResourceRepository::classify(
+    const std::filesystem::path &path
+) const
 {
-    std::array<std::string, 2> loadLastExtensions = {
-        ".obj",
-    };
-    std::unordered_map<std::string, std::vector<path>> resourcePaths;
-    std::unordered_map<std::string, std::vector<path>> loadLastResourcePaths;
+    const std::string extension = path.extension().string();
+    std::string resourceName = path.lexically_relative(root).generic_string();
+    resourceName = resourceName.substr(0, resourceName.size() - extension.size());
 
-    auto currentPath = current_path();
-    recursive_directory_iterator iterator(currentPath);
+    if (extension == ".obj") {
+        return std::make_pair(ResourceType::MESH, resourceName);
+    }
+    else if (extension == ".png" || extension == ".jpg") {
+        return std::make_pair(ResourceType::IMAGE, resourceName);
+    }
+    else if (extension == ".spv" && resourceName.rfind(".frag") != std::string::npos) {
+        return std::make_pair(ResourceType::FRAGMENT_SHADER, resourceName);
+    }
+    else if (extension == ".spv" && resourceName.rfind(".vert") != std::string::npos) {
+        return std::make_pair(ResourceType::VERTEX_SHADER, resourceName);
+    }
+    // mesh caches are picked up by the loader of their source file, anything else is no resource
+    return std::nullopt;
+}
 
-    for (auto &i : iterator) {
-        if (i.is_regular_file()) {
-            std::string extension = i.path().extension();
-            if (std::find(loadLastExtensions.begin(), loadLastExtensions.end(), extension)
-                != loadLastExtensions.end()
-            ) {
-                loadLastResourcePaths[extension].push_back(i.path());
+void ResourceRepository::indexObjMaterials(const ResourceKey &name, const std::filesystem::path &path)
+{
+    std::ifstream obj(path);
+    std::string line;
+    // mtllib statements precede the geometry, the rest of the file is not read
+    while (std::getline(obj, line) && (line.empty() || (line[0] != 'v' && line[0] != 'f'))) {
+        const std::string mtllib = "mtllib ";
+        if (line.rfind(mtllib, 0) != 0) {
+            continue;
+        }
+        std::istringstream libraries(line.substr(mtllib.size()));
+        std::string library;
+        while (libraries >> library) {
+            std::ifstream mtl(path.parent_path() / library);
+            if (!mtl) {
+                spdlog::warn("ResourceRepository: material library {} of {} not found", library, name);
+                continue;
             }
-            else {
-                resourcePaths[extension].push_back(i.path());
+            const std::string newmtl = "newmtl ";
+            std::string mtlLine;
+            while (std::getline(mtl, mtlLine)) {
+                if (mtlLine.rfind(newmtl, 0) == 0) {
+                    std::istringstream material(mtlLine.substr(newmtl.size()));
+                    ResourceKey materialName;
+                    if (material >> materialName) {
+                        materialMeshes.emplace(materialName, name);
+                    }
+                }
             }
         }
     }
+}
 
-    for (const auto &extAndPaths : resourcePaths) {
-        for (const auto &path : extAndPaths.second) {
-            load(path, extAndPaths.first);
-        }
+bool ResourceRepository::loadIndexed(ResourceType type, const ResourceKey &name)
+{
+    auto &typeIndex = getIndex(type);
+    auto i = typeIndex.find(name);
+    if (i == typeIndex.end()) {
+        return false;
     }
+    // removed before loading, so that a failing resource is not tried again on every access
+    IndexEntry entry = std::move(i->second);
+    typeIndex.erase(i);
 
-    for (const auto &extAndPaths : loadLastResourcePaths) {
-        for (const auto &path : extAndPaths.second) {
-            load(path, extAndPaths.first);
+    StartupProfiler::Scope scope(LOAD_PHASES[static_cast<size_t>(type)], name);
+    try {
+        if (entry.packEntry) {
+            loadPacked(type, name, *entry.packEntry);
+            return true;
         }
+        switch (type) {
+        case ResourceType::MESH:
+            loadObj(name, entry.path);
+            break;
+        case ResourceType::IMAGE:
+            loadImage(name, entry.path);
+            break;
+        case ResourceType::VERTEX_SHADER:
+            loadVertexShader(name, entry.path);
+            break;
+        case ResourceType::FRAGMENT_SHADER:
+            loadFragmentShader(name, entry.path);
+            break;
+        }
+    }
+    catch (std::exception &e) {
+        spdlog::error("ResourceRepository: Loading resource {} failed: {}!", name, e.what());
+        return false;
+    }
+    return true;
+}
+
+ShaderHandle ResourceRepository::findShader(ResourceType type, const ResourceKey &name)
+{
+    ShaderHandle handle = shaders.find(name);
+    if (!handle.isValid() && loadIndexed(type, name)) {
+        handle = shaders.find(name);
+    }
+    if (handle.isValid() && shaders.get(handle).getData().stage != getShaderStage(type)) {
+        return ShaderHandle{};
+    }
+    return handle;
+}
+
+std::unordered_map<ResourceKey, ResourceRepository::IndexEntry> &ResourceRepository::getIndex(ResourceType type)
+{
+    return index[static_cast<size_t>(type)];
+}
+
+const std::unordered_map<ResourceKey, ResourceRepository::IndexEntry> &ResourceRepository::getIndex(
+    ResourceType type
+) const
+{
+    return index[static_cast<size_t>(type)];
+}
+
+template<typename T>
+ResourceHandle<T> ResourceRepository::addUnique(ResourceTable<T> &table, const ResourceKey &name, std::unique_ptr<T> data)
+{
+    uint64_t size = 0;
+    Utility::Hash128 hash;
+    {
+        StartupProfiler::Scope scope("hash content", name);
+        hash = hashContent(*data, size);
+    }
+    auto i = table.contents.find(hash);
+    if (i == table.contents.end()) {
+        ResourceHandle<T> handle = table.add(name, Resource<T>{nextResourceId++, std::move(data)});
+        table.contents.emplace(hash, handle.index);
+        return handle;
+    }
+
+    // the duplicate is dropped before anything is created from it on the GPU
+    ResourceHandle<T> handle{i->second};
+    table.alias(name, handle);
+    releaseData(*data);
+    ++deduplicationStatistics.aliasCount;
+    deduplicationStatistics.bytesSaved += size;
+    spdlog::info(
+        "ResourceRepository: {} has the same content as {}, {} KiB saved ({:.1f} MiB in total)",
+        name,
+        table.names[handle.index],
+        size / 1024,
+        static_cast<double>(deduplicationStatistics.bytesSaved) / (1024. * 1024.)
+    );
+    return handle;
+}
+
+Utility::Hash128 ResourceRepository::hashContent(const Mesh &mesh, uint64_t &size)
+{
+    Utility::ContentHasher hasher;
+    VertexFormat vertexFormat = mesh.getVertexFormat();
+    hasher.update(&vertexFormat, sizeof(vertexFormat));
+    hasher.update(mesh.getVertexData(), mesh.getVertexDataSize());
+    hasher.update(mesh.getIndexData(), mesh.getIndexDataSize());
+    // compressed vertices only match if they are decompressed the same way
+    hasher.update(&mesh.getBoundsMin(), sizeof(glm::vec3));
+    hasher.update(&mesh.getBoundsMax(), sizeof(glm::vec3));
+    hasher.update(&mesh.getUvTransform(), sizeof(glm::vec4));
+    hasher.update(mesh.getLods());
+    hasher.update(mesh.getMeshlets());
+    hasher.update(mesh.getSubmeshes());
+    // the same geometry with other materials is another mesh
+    hasher.update(mesh.getMaterials());
+    size = mesh.getVertexDataSize() + mesh.getIndexDataSize();
+    return hasher.finish();
+}
+
+Utility::Hash128 ResourceRepository::hashContent(const ImageResourceData &image, uint64_t &size)
+{
+    Utility::ContentHasher hasher;
+    hasher.update(&image.width, sizeof(image.width));
+    hasher.update(&image.height, sizeof(image.height));
+    size = uint64_t(image.width) * image.height * 4;
+    hasher.update(image.data, size);
+    return hasher.finish();
+}
+
+Utility::Hash128 ResourceRepository::hashContent(const ShaderResourceData &shader, uint64_t &size)
+{
+    Utility::ContentHasher hasher;
+    hasher.update(&shader.stage, sizeof(shader.stage));
+    hasher.update(shader.code);
+    size = shader.code.size();
+    return hasher.finish();
+}
+
+void ResourceRepository::releaseData(ImageResourceData &image)
+{
+    if (!image.storage) {
+        stbi_image_free(image.data);
+    }
+}
+
+template<typename T>
+void ResourceRepository::releaseData(T &)
+{
+}
+
+VkShaderStageFlags ResourceRepository::getShaderStage(ResourceType type)
+{
+    switch (type) {
+    case ResourceType::VERTEX_SHADER:
+        return VK_SHADER_STAGE_VERTEX_BIT;
+    case ResourceType::FRAGMENT_SHADER:
+        return VK_SHADER_STAGE_FRAGMENT_BIT;
+    default:
+        throw std::invalid_argument("ResourceRepository::getShaderStage: not a shader type");
     }
 }
 
@@ -437,14 +1428,19 @@ std::vector<std::byte> ResourceRepository::readShaderFile(const std::filesystem:
 
 const MaterialResource *ResourceRepository::loadObjMaterial(const tinyobj::material_t &material)
 {
-    const auto iter = materials.find(material.name);
-    if (iter != materials.end()) {
-        return &iter->second;
+    MaterialHandle handle = materials.find(material.name);
+    if (handle.isValid()) {
+        return &materials.get(handle);
     }
 
     spdlog::info("Loading material {}, ambient texture {} ", material.name, material.ambient_texname);
 
-    return &materials.emplace(material.name, 
+    // every texture name is resolved once, materials without a texture keep a null pointer
+    auto findTexture = [this](const std::string &name) -> const ImageResource * {
+        ImageHandle texture = findImage(name);
+        return texture.isValid() ? &images.get(texture) : nullptr;
+    };
+    return &materials.get(materials.add(material.name,
         MaterialResource{
             nextResourceId++,
             std::unique_ptr<MaterialResourceData>(new MaterialResourceData{
@@ -452,13 +1448,107 @@ const MaterialResource *ResourceRepository::loadObjMaterial(const tinyobj::mater
                 .diffuse = glm::vec3(material.diffuse[0], material.diffuse[1], material.diffuse[2]),
                 .specular = glm::vec3(material.specular[0], material.specular[1], material.specular[2]),
                 .shininess = material.shininess,
-                .ambientTexture = hasImage(material.ambient_texname) ? &getImage(material.ambient_texname) : nullptr,
-                .diffuseTexture = hasImage(material.diffuse_texname) ? &getImage(material.diffuse_texname) : nullptr,
-                .specularTexture = hasImage(material.specular_texname) ? &getImage(material.specular_texname) : nullptr,
-                .normalTexture = hasImage(material.normal_texname) ? &getImage(material.normal_texname) : nullptr,
+                .ambientTexture = findTexture(material.ambient_texname),
+                .diffuseTexture = findTexture(material.diffuse_texname),
+                .specularTexture = findTexture(material.specular_texname),
+                .normalTexture = findTexture(material.normal_texname),
+                .placeholderTexture = defaultImage,
                 .vertexShader = &getVertexShader("shader/shader.vert"),
+                .compressedVertexShader = &getVertexShader("shader/shader.compressed.vert"),
                 .fragmentShader = &getFragmentShader("shader/shader.frag"),
+                .textureNames = {
+                    material.ambient_texname,
+                    material.diffuse_texname,
+                    material.specular_texname,
+                    material.normal_texname,
+                },
+                .shaderNames = {"shader/shader.vert", "shader/shader.compressed.vert", "shader/shader.frag"},
                 .name{material.name},
         }),
-    }).first->second;
-}
\ No newline at end of file
+    }));
+}
+
+bool ResourceRepository::loadCachedObj(const ResourceKey &name, const std::filesystem::path &path)
+{
+    std::filesystem::path cachePath = MeshFile::getCachePath(path);
+    if (!exists(cachePath)) {
+        return false;
+    }
+
+    StartupProfiler::Scope scope("read mesh cache", name);
+    std::shared_ptr<const MeshFile> file;
+    try {
+        file = std::make_shared<const MeshFile>(cachePath);
+    }
+    catch (std::exception &e) {
+        spdlog::warn("ResourceRepository: ignoring mesh cache {}: {}", cachePath.string(), e.what());
+        return false;
+    }
+    if (!file->isUpToDate(path, getMeshSettings(name).getHash())) {
+        spdlog::info("ResourceRepository: mesh cache {} is outdated", cachePath.string());
+        return false;
+    }
+
+    spdlog::info("Loading cached .obj object {} ", cachePath.string());
+    loadMeshFile(name, std::move(file));
+    return true;
+}
+
+void ResourceRepository::loadMeshFile(const ResourceKey &name, std::shared_ptr<const MeshFile> file)
+{
+    const MeshFile::Header &header = file->getHeader();
+    const MeshFile::MaterialRecord *records = file->getMaterialRecords();
+    std::vector<const MaterialResource *> materialResources(header.materialCount, nullptr);
+    for (uint32_t i = 0; i < header.materialCount; ++i) {
+        const MeshFile::MaterialRecord &record = records[i];
+
+        tinyobj::material_t material{};
+        material.name = record.name;
+        std::copy(std::begin(record.ambient), std::end(record.ambient), std::begin(material.ambient));
+        std::copy(std::begin(record.diffuse), std::end(record.diffuse), std::begin(material.diffuse));
+        std::copy(std::begin(record.specular), std::end(record.specular), std::begin(material.specular));
+        material.shininess = record.shininess;
+        material.ambient_texname = record.ambientTexture;
+        material.diffuse_texname = record.diffuseTexture;
+        material.specular_texname = record.specularTexture;
+        material.normal_texname = record.normalTexture;
+
+        materialResources[i] = loadObjMaterial(material);
+    }
+
+    addUnique(meshes, name, std::make_unique<Mesh>(std::move(file), std::move(materialResources)));
+}
+
+void ResourceRepository::writeObjCache(
+    const ResourceKey &name,
+    const std::filesystem::path &path,
+    const Mesh &mesh,
+    const std::vector<tinyobj::material_t> &materials
+)
+{
+    std::vector<MeshFile::MaterialRecord> records(materials.size(), MeshFile::MaterialRecord{});
+    for (size_t i = 0; i < materials.size(); ++i) {
+        const tinyobj::material_t &material = materials[i];
+        MeshFile::MaterialRecord &record = records[i];
+
+        MeshFile::copyName(record.name, material.name);
+        std::copy(std::begin(material.ambient), std::end(material.ambient), std::begin(record.ambient));
+        std::copy(std::begin(material.diffuse), std::end(material.diffuse), std::begin(record.diffuse));
+        std::copy(std::begin(material.specular), std::end(material.specular), std::begin(record.specular));
+        record.shininess = material.shininess;
+        MeshFile::copyName(record.ambientTexture, material.ambient_texname);
+        MeshFile::copyName(record.diffuseTexture, material.diffuse_texname);
+        MeshFile::copyName(record.specularTexture, material.specular_texname);
+        MeshFile::copyName(record.normalTexture, material.normal_texname);
+    }
+
+    std::filesystem::path cachePath = MeshFile::getCachePath(path);
+    MeshFile::write(
+        cachePath,
+        path,
+        mesh,
+        records,
+        getMeshSettings(name).getHash()
+    );
+    spdlog::info("ResourceRepository: wrote mesh cache {}", cachePath.string());
+}
@@ -1,60 +1,280 @@
 #ifndef RESOURCEREPOSITORY_H_
 #define RESOURCEREPOSITORY_H_
 
+#include "AssetPack.h"
 #include "Material.h"
 #include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
 #include "Image.h"
 #include "Resource.h"
 #include "Shader.h"
+#include "Utility.h"
 #include "third-party/spirv_reflect/spirv_reflect.h"
 #include "third-party/tiny_obj_loader.h"
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 typedef std::string ResourceKey;
 
+// processing applied to meshes after parsing, selectable per asset
+struct MeshImportSettings
+{
+    MeshOptimizer::Settings optimizer;
+    MeshSimplifier::Settings lod;
+    MeshletBuilder::Settings meshlets;
+
+    uint64_t getHash() const;
+    // reads per mesh overrides of defaults from a text file with one line per mesh:
+    //   <mesh name>: <setting>=<value> ...
+    // settings are named after the members, e.g. "mesh/cylinder: lod.levelCount=0 optimizer.overdraw=false";
+    // empty lines and lines starting with '#' are skipped
+    static std::unordered_map<ResourceKey, MeshImportSettings> loadOverrides(
+        const std::filesystem::path &path,
+        const MeshImportSettings &defaults = {}
+    );
+};
+
+// Resources are indexed by name when the repository is created and loaded on first access,
+// either from the files below the working directory or from a mounted asset pack.
 class ResourceRepository
 {
 public:
-    ResourceRepository(const ResourceKey &defaultImage = "");
+    enum class ResourceType
+    {
+        MESH,
+        IMAGE,
+        VERTEX_SHADER,
+        FRAGMENT_SHADER,
+    };
+    static constexpr size_t RESOURCE_TYPE_COUNT = 4;
+
+    // everything known about a resource file before it is loaded
+    struct IndexEntry
+    {
+        std::filesystem::path path;
+        uintmax_t size;
+        ResourceType type;
+        // set if the resource is served from the asset pack at path
+        const AssetPack::Entry *packEntry = nullptr;
+    };
+
+    // an .obj file after parsing and processing, before its materials are resolved
+    struct ObjData
+    {
+        std::vector<Vertex> vertices;
+        std::vector<Mesh::IndexType> indices;
+        std::vector<Mesh::Lod> lods;
+        std::vector<Mesh::Meshlet> meshlets;
+        std::vector<Mesh::Submesh> submeshes;
+        std::vector<tinyobj::material_t> materials;
+    };
+
+    // a loaded resource whose file has changed
+    struct ReloadRequest
+    {
+        ResourceType type;
+        ResourceKey name;
+        std::filesystem::path path;
+        MeshImportSettings meshSettings;
+    };
+
+    // the decoded new contents of a resource, only the member matching type is set
+    struct Reload
+    {
+        ResourceType type;
+        ResourceKey name;
+        std::filesystem::path path;
+        std::unique_ptr<ImageResourceData> image;
+        std::unique_ptr<ShaderResourceData> shader;
+        std::unique_ptr<ObjData> mesh;
+    };
+
+    // loaded resources whose content matched one loaded before
+    struct DeduplicationStatistics
+    {
+        size_t aliasCount = 0;
+        uint64_t bytesSaved = 0;
+    };
+
+    ResourceRepository(
+        const ResourceKey &defaultImage = "",
+        const MeshImportSettings &defaultMeshSettings = {},
+        std::unordered_map<ResourceKey, MeshImportSettings> meshSettings = {},
+        // if given, resources are served from this pack instead of the working directory
+        const std::filesystem::path &assetPackPath = {}
+    );
     ResourceRepository(const ResourceRepository &) = delete;
     ResourceRepository(ResourceRepository &&) = default;
     ~ResourceRepository();
 
     bool hasImage(const ResourceKey &name) const;
+    // import settings of the given mesh, falling back to the defaults if there are no per-asset settings
+    const MeshImportSettings &getMeshSettings(const ResourceKey &name) const;
 
-    const MeshResource &getMesh(const ResourceKey &name) const;
-    const MaterialResource &getMaterial(const ResourceKey &name) const;
-    const ImageResource &getImage(const ResourceKey &name) const;
-    const ShaderResource &getFragmentShader(const ResourceKey &name) const;
-    const ShaderResource &getVertexShader(const ResourceKey &name) const;
+    // resolving a name loads an indexed resource on first access, the handle is invalid if there is no such resource;
+    // resolve names once and keep the handles, dereferencing them involves no string hashing
+    MeshHandle findMesh(const ResourceKey &name);
+    MaterialHandle findMaterial(const ResourceKey &name);
+    ImageHandle findImage(const ResourceKey &name);
+    ShaderHandle findFragmentShader(const ResourceKey &name);
+    ShaderHandle findVertexShader(const ResourceKey &name);
+    // the handle must have been returned by this repository
+    const MeshResource &get(MeshHandle handle) const;
+    const MaterialResource &get(MaterialHandle handle) const;
+    const ImageResource &get(ImageHandle handle) const;
+    const ShaderResource &get(ShaderHandle handle) const;
+    // the name the mesh is listed under, of names sharing it the one it was loaded with first
+    const ResourceKey &getName(MeshHandle handle) const;
+
+    // lookup by name, falling back to the default mesh or image if there is one
+    const MeshResource &getMesh(const ResourceKey &name);
+    const MaterialResource &getMaterial(const ResourceKey &name);
+    const ImageResource &getImage(const ResourceKey &name);
+    const ShaderResource &getFragmentShader(const ResourceKey &name);
+    const ShaderResource &getVertexShader(const ResourceKey &name);
+    // loads the named resources of any type now instead of on first access, unknown names are ignored
+    void prefetch(const std::vector<ResourceKey> &names);
+    // sorted, so that anything derived from them is reproducible; includes meshes not loaded yet,
+    // but not the names of loaded duplicates
+    std::vector<ResourceKey> getMeshNames() const;
+    // materials are only known once the meshes referencing them are loaded
+    std::vector<ResourceKey> getMaterialNames() const;
+
+    // resources created at runtime, e.g. for generated scenes
+    MeshHandle addMesh(const ResourceKey &name, Mesh mesh);
+    MaterialHandle addMaterial(const ResourceKey &name, const MaterialResourceData &data);
     
     void loadObj(const ResourceKey &name, const std::filesystem::path &path);
     void loadImage(const ResourceKey &name, const std::filesystem::path &path);
     void loadFragmentShader(const ResourceKey &name, const std::filesystem::path &path);
     void loadVertexShader(const ResourceKey &name, const std::filesystem::path &path);
+    // loads every indexed file and writes the processed resources into one pack
+    void writeAssetPack(const std::filesystem::path &path);
+
+    // the request to reload the resource that was loaded from path, if there is one
+    std::optional<ReloadRequest> getReloadRequest(const std::filesystem::path &path) const;
+    // reads and processes the file without touching the repository, so it can run on any thread
+    static Reload decode(const ReloadRequest &request);
+    // replaces the data of the resource; it keeps its address but gets a new id,
+    // so that everything created from the old data can be found by the returned old id.
+    // If other names share the resource, the reloaded name is split off to a new resource and nothing is returned,
+    // the materials of the repository are repointed, users outside of it have to resolve the name again
+    std::optional<ResourceId> apply(Reload reload);
+
+    const DeduplicationStatistics &getDeduplicationStatistics() const;
 
     std::string resourceTree(size_t indentationLevel = 0) const;
 private:
-    void load(const std::filesystem::path &path, const std::string extension);
-    void loadAll();
+    // resources of one type in the order they were added, handles index into resources
+    template<typename T>
+    struct ResourceTable
+    {
+        // a deque, so that resources keep their addresses when more are added
+        std::deque<Resource<T>> resources;
+        // the name each resource was added with
+        std::vector<ResourceKey> names;
+        // the only place names are hashed; aliases map to the handle of the resource with the same content
+        std::unordered_map<ResourceKey, uint32_t> handles;
+        std::unordered_map<Utility::Hash128, uint32_t> contents;
+
+        ResourceHandle<T> find(const ResourceKey &name) const;
+        const Resource<T> &get(ResourceHandle<T> handle) const;
+        Resource<T> &get(ResourceHandle<T> handle);
+        ResourceHandle<T> add(const ResourceKey &name, Resource<T> resource);
+        void alias(const ResourceKey &name, ResourceHandle<T> handle);
+        // the content of the resource changed, so it no longer matches its old hash
+        void forgetContent(ResourceHandle<T> handle);
+        // true if more than one name resolves to the handle
+        bool isShared(ResourceHandle<T> handle) const;
+        // gives name a resource of its own, the other names sharing its handle keep the old resource
+        ResourceHandle<T> split(const ResourceKey &name, Resource<T> resource);
+    };
 
-    Shader::DescriptorSetLayoutBindingMap getShaderBindings(const spv_reflect::ShaderModule &code);
-    std::vector<std::byte> readShaderFile(const std::filesystem::path &path);
+    void buildIndex();
+    void mountAssetPack(const std::filesystem::path &path);
+    // records the materials the .mtl files named in the header of the .obj file define
+    void indexObjMaterials(const ResourceKey &name, const std::filesystem::path &path);
+    // type and name of the resource a file under root would be loaded as
+    std::optional<std::pair<ResourceType, ResourceKey>> classify(const std::filesystem::path &path) const;
+    // loads the resource if it is indexed, returns false if it is not or loading failed
+    bool loadIndexed(ResourceType type, const ResourceKey &name);
+    // vertex and fragment shaders share a table, the type selects the stage
+    ShaderHandle findShader(ResourceType type, const ResourceKey &name);
+    void loadPacked(ResourceType type, const ResourceKey &name, const AssetPack::Entry &entry);
+    std::unordered_map<ResourceKey, IndexEntry> &getIndex(ResourceType type);
+    const std::unordered_map<ResourceKey, IndexEntry> &getIndex(ResourceType type) const;
+
+    // adds a loaded resource unless one with the same content exists, then name becomes an alias of that one
+    template<typename T>
+    ResourceHandle<T> addUnique(ResourceTable<T> &table, const ResourceKey &name, std::unique_ptr<T> data);
+    // see apply()
+    template<typename T>
+    std::optional<ResourceId> replace(ResourceTable<T> &table, const ResourceKey &name, std::unique_ptr<T> data);
+    // points the textures and shaders that materials resolved by name to the resource the name resolves to now
+    void repointMaterials(const ResourceKey &name);
+    static Utility::Hash128 hashContent(const Mesh &mesh, uint64_t &size);
+    static Utility::Hash128 hashContent(const ImageResourceData &image, uint64_t &size);
+    static Utility::Hash128 hashContent(const ShaderResourceData &shader, uint64_t &size);
+    // frees what the data of a duplicate owns
+    static void releaseData(ImageResourceData &image);
+    template<typename T>
+    static void releaseData(T &data);
+
+    static VkShaderStageFlags getShaderStage(ResourceType type);
+    static std::unique_ptr<ImageResourceData> decodeImage(const ResourceKey &name, const std::filesystem::path &path);
+    static std::unique_ptr<ShaderResourceData> decodeShader(const std::filesystem::path &path, VkShaderStageFlags stage);
+    static std::unique_ptr<ShaderResourceData> createShaderData(std::vector<std::byte> code, VkShaderStageFlags stage);
+    static ObjData decodeObj(
+        const ResourceKey &name,
+        const std::filesystem::path &path,
+        const MeshImportSettings &settings
+    );
+    static Shader::DescriptorSetLayoutBindingMap getShaderBindings(const spv_reflect::ShaderModule &code);
+    static std::vector<std::byte> readShaderFile(const std::filesystem::path &path);
+    // resolves the materials and writes the mesh cache
+    std::unique_ptr<Mesh> createObjMesh(const ResourceKey &name, const std::filesystem::path &path, ObjData data);
     const MaterialResource *loadObjMaterial(const tinyobj::material_t &material);
+    bool loadCachedObj(const ResourceKey &name, const std::filesystem::path &path);
+    void loadMeshFile(const ResourceKey &name, std::shared_ptr<const MeshFile> file);
+    void writeObjCache(
+        const ResourceKey &name,
+        const std::filesystem::path &path,
+        const Mesh &mesh,
+        const std::vector<tinyobj::material_t> &materials
+    );
 
     ResourceId nextResourceId = 1;
+    std::filesystem::path root;
+    std::unique_ptr<AssetPack> assetPack;
+
+    MeshImportSettings defaultMeshSettings;
+    std::unordered_map<ResourceKey, MeshImportSettings> meshSettings;
+    // the mesh that defines each material, so that findMaterial only loads that one
+    std::unordered_map<ResourceKey, ResourceKey> materialMeshes;
+
+    // resources not loaded yet, per type; entries are removed once they are loaded
+    std::array<std::unordered_map<ResourceKey, IndexEntry>, RESOURCE_TYPE_COUNT> index;
+
+    ResourceTable<Mesh> meshes;
+    ResourceTable<MaterialResourceData> materials;
+    ResourceTable<ImageResourceData> images;
+    ResourceTable<ShaderResourceData> shaders;
 
-    std::unordered_map<ResourceKey, MeshResource> meshes;
-    std::unordered_map<ResourceKey, MaterialResource> materials;
-    std::unordered_map<ResourceKey, ImageResource> images;
-    std::unordered_map<ResourceKey, ShaderResource> vertexShaders;
-    std::unordered_map<ResourceKey, ShaderResource> fragmentShaders;
+    DeduplicationStatistics deduplicationStatistics;
 
     const MeshResource *defaultMesh = nullptr;
     const ImageResource *defaultImage = nullptr;
+    ResourceKey defaultImageName;
 };
 
 #endif
@@ -0,0 +1,212 @@
+#include "SceneGenerator.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include <random>
+#include <spdlog/fmt/fmt.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // std::uniform_real_distribution differs between standard libraries, std::mt19937 does not
+    float uniform(std::mt19937 &random)
+    {
+        return static_cast<float>(random() >> 8) / static_cast<float>(1 << 24);
+    }
+
+    glm::vec3 uniformInCube(std::mt19937 &random)
+    {
+        float x = uniform(random);
+        float y = uniform(random);
+        float z = uniform(random);
+        return glm::vec3(x, y, z) * 2.f - 1.f;
+    }
+
+    glm::vec3 unitVector(std::mt19937 &random)
+    {
+        glm::vec3 v;
+        do {
+            v = uniformInCube(random);
+        } while (glm::dot(v, v) > 1.f || glm::dot(v, v) < 1e-4f);
+        return glm::normalize(v);
+    }
+}
+
+SceneGenerator::SceneGenerator(const Settings &settings)
+    : settings(settings)
+{
+}
+
+
+const SceneGenerator::Settings &SceneGenerator::getSettings() const
+{
+    return settings;
+}
+
+SceneGenerator::Scene SceneGenerator::generate(ResourceRepository &repository) const
+{
+    if (settings.objectCount == 0 || settings.materialCount == 0) {
+        throw std::invalid_argument("SceneGenerator: object and material count must not be 0");
+    }
+
+    std::mt19937 random(settings.seed);
+    std::vector<MeshHandle> meshes = createMeshes(repository);
+
+    Scene scene{};
+    scene.materials = createMaterials(repository);
+    std::vector<glm::vec3> positions = createPositions(random, scene.radius);
+
+    scene.objects.reserve(settings.objectCount);
+    for (uint32_t i = 0; i < settings.objectCount; ++i) {
+        MeshHandle mesh = meshes[random() % meshes.size()];
+        glm::vec3 axis = unitVector(random);
+        float angle = uniform(random) * glm::two_pi<float>();
+        float scale = 0.5f + uniform(random);
+        bool animated = uniform(random) < settings.animatedFraction;
+
+        // loaded meshes come in any size, so everything is normalized to a unit bounding sphere
+        const Mesh &data = repository.get(mesh).getData();
+        float radius = glm::length(data.getBoundsMax() - data.getBoundsMin()) * 0.5f;
+        glm::vec3 center = (data.getBoundsMin() + data.getBoundsMax()) * 0.5f;
+        float normalization = radius > 0.f ? 1.f / radius : 1.f;
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.f), positions[i]);
+        transform = glm::rotate(transform, angle, axis);
+        transform = glm::scale(transform, glm::vec3(scale * normalization));
+        transform = glm::translate(transform, -center);
+
+        scene.objects.push_back(Object{
+            .mesh = mesh,
+            .material = static_cast<uint32_t>(random() % scene.materials.size()),
+            .transform = transform,
+            .rotationAxis = unitVector(random),
+            .angularVelocity = animated ? (uniform(random) * 2.f - 1.f) * glm::pi<float>() : 0.f,
+        });
+        scene.triangleCount += data.getLods()[0].indexCount > 0
+            ? data.getLods()[0].indexCount / 3
+            : data.getVertexCount() / 3;
+    }
+
+    return scene;
+}
+
+SceneGenerator::Layout SceneGenerator::parseLayout(const std::string &name)
+{
+    for (Layout layout : {Layout::GRID, Layout::RANDOM, Layout::CLUSTERED}) {
+        if (name == getLayoutName(layout)) {
+            return layout;
+        }
+    }
+    throw std::invalid_argument(fmt::format("SceneGenerator: unknown layout '{}'", name));
+}
+
+const char *SceneGenerator::getLayoutName(Layout layout)
+{
+    switch (layout) {
+    case Layout::GRID:
+        return "grid";
+    case Layout::RANDOM:
+        return "random";
+    case Layout::CLUSTERED:
+        return "clustered";
+    }
+    return "unknown";
+}
+
+std::vector<MeshHandle> SceneGenerator::createMeshes(ResourceRepository &repository) const
+{
+    std::vector<MeshHandle> meshes{
+        repository.addMesh("scene/cube", Mesh::createUnitCube()),
+        repository.addMesh("scene/hexagon", Mesh::createRegularPolygon(0.5f, 6)),
+        repository.addMesh("scene/plane", Mesh::createPlane(glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 0.f, 1.f))),
+    };
+    for (const ResourceKey &name : repository.getMeshNames()) {
+        if (name.rfind("scene/", 0) != 0) {
+            // duplicates resolve to the mesh they share their content with
+            MeshHandle mesh = repository.findMesh(name);
+            if (mesh.isValid() && std::find(meshes.begin(), meshes.end(), mesh) == meshes.end()) {
+                meshes.push_back(mesh);
+            }
+        }
+    }
+    return meshes;
+}
+
+std::vector<MaterialHandle> SceneGenerator::createMaterials(ResourceRepository &repository) const
+{
+    // the loaded materials provide shaders and textures, the colors are spread over the hue circle
+    std::vector<MaterialHandle> bases;
+    for (const ResourceKey &name : repository.getMaterialNames()) {
+        bases.push_back(repository.findMaterial(name));
+    }
+    if (bases.empty()) {
+        throw std::runtime_error("SceneGenerator: no materials to derive the scene materials from");
+    }
+
+    std::vector<MaterialHandle> materials;
+    materials.reserve(settings.materialCount);
+    for (uint32_t i = 0; i < settings.materialCount; ++i) {
+        MaterialResourceData data = repository.get(bases[i % bases.size()]).getData();
+        float hue = static_cast<float>(i) / static_cast<float>(settings.materialCount);
+        data.diffuse = glm::vec3(
+            0.5f + 0.5f * std::cos(glm::two_pi<float>() * hue),
+            0.5f + 0.5f * std::cos(glm::two_pi<float>() * (hue - 1.f / 3.f)),
+            0.5f + 0.5f * std::cos(glm::two_pi<float>() * (hue - 2.f / 3.f))
+        );
+        data.name = fmt::format("scene/material{}", i);
+        materials.push_back(repository.addMaterial(data.name, data));
+    }
+    return materials;
+}
+
+std::vector<glm::vec3> SceneGenerator::createPositions(std::mt19937 &random, float &radius) const
+{
+    std::vector<glm::vec3> positions;
+    positions.reserve(settings.objectCount);
+
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(settings.objectCount))));
+    float halfExtent = side * settings.spacing * 0.5f;
+
+    switch (settings.layout) {
+    case Layout::GRID:
+        for (uint32_t i = 0; i < settings.objectCount; ++i) {
+            glm::vec3 cell(i % side, (i / side) % side, i / (side * side));
+            positions.push_back((cell + 0.5f) * settings.spacing - halfExtent);
+        }
+        break;
+    case Layout::RANDOM:
+        for (uint32_t i = 0; i < settings.objectCount; ++i) {
+            positions.push_back(uniformInCube(random) * halfExtent);
+        }
+        break;
+    case Layout::CLUSTERED: {
+        uint32_t clusterCount = std::max(1u, std::min(settings.clusterCount, settings.objectCount));
+        std::vector<glm::vec3> centers;
+        for (uint32_t i = 0; i < clusterCount; ++i) {
+            centers.push_back(uniformInCube(random) * halfExtent);
+        }
+        // each cluster packs its share of the objects at the grid density
+        uint32_t perCluster = (settings.objectCount + clusterCount - 1) / clusterCount;
+        float clusterRadius = std::cbrt(static_cast<float>(perCluster)) * settings.spacing * 0.5f;
+        for (uint32_t i = 0; i < settings.objectCount; ++i) {
+            // the sum of three uniform samples approximates a normal distribution
+            glm::vec3 offset = (uniformInCube(random) + uniformInCube(random) + uniformInCube(random)) / 3.f;
+            positions.push_back(centers[i % clusterCount] + offset * clusterRadius * 2.f);
+        }
+        break;
+    }
+    }
+
+    radius = 0.f;
+    for (const glm::vec3 &position : positions) {
+        radius = std::max(radius, glm::length(position));
+    }
+    return positions;
+}
@@ -0,0 +1,78 @@
+#ifndef SCENEGENERATOR_H_
+#define SCENEGENERATOR_H_
+
+#include "Resource.h"
+#include "ResourceRepository.h"
+
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+// Places large numbers of objects for scalability benchmarks. The same settings always
+// produce the same scene, independent of platform and standard library.
+class SceneGenerator
+{
+public:
+    enum class Layout
+    {
+        GRID,
+        RANDOM,
+        CLUSTERED,
+    };
+
+    struct Settings
+    {
+        Layout layout = Layout::GRID;
+        uint32_t objectCount = 1000;
+        uint32_t materialCount = 8;
+        uint32_t seed = 1;
+        // distance between neighboring objects, random layouts use the same average density
+        float spacing = 3.f;
+        uint32_t clusterCount = 16;
+        // fraction of objects that spin around their own center
+        float animatedFraction = 0.f;
+    };
+
+    // handles rather than pointers, so that a scene of many objects stays compact
+    struct Object
+    {
+        MeshHandle mesh;
+        uint32_t material;
+        glm::mat4 transform;
+        // rotation around the object's own center in radians per second, 0 for static objects
+        glm::vec3 rotationAxis;
+        float angularVelocity;
+    };
+
+    struct Scene
+    {
+        std::vector<MaterialHandle> materials;
+        std::vector<Object> objects;
+        // radius of a sphere around the origin containing all object positions
+        float radius;
+        uint64_t triangleCount;
+    };
+
+    SceneGenerator(const Settings &settings);
+    SceneGenerator(const SceneGenerator &) = delete;
+    SceneGenerator(SceneGenerator &&) = default;
+    ~SceneGenerator() = default;
+
+    const Settings &getSettings() const;
+    // adds the procedural meshes and the generated materials to the repository
+    Scene generate(ResourceRepository &repository) const;
+
+    static Layout parseLayout(const std::string &name);
+    static const char *getLayoutName(Layout layout);
+private:
+    std::vector<MeshHandle> createMeshes(ResourceRepository &repository) const;
+    std::vector<MaterialHandle> createMaterials(ResourceRepository &repository) const;
+    std::vector<glm::vec3> createPositions(std::mt19937 &random, float &radius) const;
+
+    Settings settings;
+};
+
+#endif
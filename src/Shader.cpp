@@ -67,6 +67,11 @@ VkShaderModule Shader::getShaderModule() const
     return shaderModule;
 }
 
+VkDeviceSize Shader::getSize() const
+{
+    return 0;
+}
+
 std::string Shader::listBindings() const
 {
     std::stringstream ss;
@@ -29,6 +29,8 @@ public:
     bool hasSet(uint32_t set) const;
     const std::vector<VkDescriptorSetLayoutBinding> &getDescriptorSetLayoutBindings(uint32_t set) const;
     VkShaderModule getShaderModule() const;
+    // shader modules hold no device memory of their own
+    VkDeviceSize getSize() const;
 
     std::string listBindings() const;
 private:
@@ -0,0 +1,33 @@
+#include "ShaderLayout.h"
+#include "ShaderLayouts.h"
+
+const ShaderLayout *ShaderLayout::find(const std::vector<std::byte> &code)
+{
+    uint64_t hash = 0;
+    for (const ShaderLayout &layout : ShaderLayouts::ALL) {
+        if (layout.codeSize != code.size()) {
+            continue;
+        }
+        if (hash == 0) {
+            hash = hashCode(code.data(), code.size());
+        }
+        if (layout.codeHash == hash) {
+            return &layout;
+        }
+    }
+    return nullptr;
+}
+
+std::unordered_map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> ShaderLayout::getBindingMap() const
+{
+    std::unordered_map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> bindingMap;
+    for (uint32_t i = 0; i < bindingCount; ++i) {
+        bindingMap[bindings[i].set].push_back(VkDescriptorSetLayoutBinding{
+            .binding = bindings[i].binding,
+            .descriptorType = bindings[i].descriptorType,
+            .descriptorCount = bindings[i].descriptorCount,
+            .stageFlags = static_cast<VkShaderStageFlags>(stage),
+        });
+    }
+    return bindingMap;
+}
@@ -0,0 +1,63 @@
+#ifndef SHADERLAYOUT_H_
+#define SHADERLAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Interface of a compiled shader, reflected at build time by tools/ShaderReflect.cpp into the generated
+// ShaderLayouts.h, so that loading the shaders needs no reflection and mismatches fail to compile.
+struct ShaderLayout
+{
+    struct Binding
+    {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType descriptorType;
+        uint32_t descriptorCount;
+    };
+
+    struct PushConstantRange
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct VertexInput
+    {
+        uint32_t location;
+        VkFormat format;
+    };
+
+    // file name of the compiled shader
+    const char *name;
+    VkShaderStageFlagBits stage;
+    // a shader compiled after the build, e.g. for hot reloading, does not match and is reflected at runtime
+    uint64_t codeSize;
+    uint64_t codeHash;
+    const Binding *bindings;
+    uint32_t bindingCount;
+    const PushConstantRange *pushConstantRanges;
+    uint32_t pushConstantRangeCount;
+    const VertexInput *vertexInputs;
+    uint32_t vertexInputCount;
+
+    // the generated layout of exactly this code, nullptr if there is none
+    static const ShaderLayout *find(const std::vector<std::byte> &code);
+    std::unordered_map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> getBindingMap() const;
+
+    // FNV-1a, shared by the generator and the lookup
+    static uint64_t hashCode(const std::byte *data, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint64_t>(data[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+};
+
+#endif
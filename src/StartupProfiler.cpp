@@ -0,0 +1,190 @@
+#include "StartupProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        std::string detail;
+        StartupProfiler::Clock::time_point start;
+        StartupProfiler::Clock::time_point end;
+        uint32_t thread;
+    };
+
+    // times are relative to the start of the program
+    const StartupProfiler::Clock::time_point epoch = StartupProfiler::Clock::now();
+    std::atomic<bool> recording{true};
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::unordered_map<std::thread::id, uint32_t> threads;
+    std::filesystem::path tracePath;
+
+    double toMicroseconds(StartupProfiler::Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    std::string escapeJson(const std::string &text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                escaped += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+            }
+            else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    void writeTrace(const std::filesystem::path &path)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            spdlog::error("StartupProfiler: could not open {} for writing", path.string());
+            return;
+        }
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (size_t i = 0; i < events.size(); ++i) {
+            const Event &event = events[i];
+            file << (i ? ",\n" : "\n") << fmt::format(
+                "{{\"name\":\"{}\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},"
+                "\"pid\":1,\"tid\":{},\"args\":{{\"detail\":\"{}\"}}}}",
+                escapeJson(event.name),
+                toMicroseconds(event.start - epoch),
+                toMicroseconds(event.end - event.start),
+                event.thread,
+                escapeJson(event.detail)
+            );
+        }
+        file << "\n]}\n";
+        spdlog::info("StartupProfiler: wrote {} events to {}", events.size(), path.string());
+    }
+
+    void logSummary()
+    {
+        struct Phase
+        {
+            const char *name;
+            size_t count = 0;
+            StartupProfiler::Clock::duration total{};
+            const Event *slowest = nullptr;
+        };
+        std::map<std::string, Phase> phases;
+        StartupProfiler::Clock::time_point end = epoch;
+        for (const Event &event : events) {
+            Phase &phase = phases[event.name];
+            phase.name = event.name;
+            ++phase.count;
+            phase.total += event.end - event.start;
+            if (!phase.slowest || event.end - event.start > phase.slowest->end - phase.slowest->start) {
+                phase.slowest = &event;
+            }
+            end = std::max(end, event.end);
+        }
+
+        std::vector<const Phase *> sorted;
+        for (const auto &i : phases) {
+            sorted.push_back(&i.second);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Phase *a, const Phase *b) {
+            return a->total > b->total;
+        });
+
+        double startupSeconds = std::chrono::duration<double>(end - epoch).count();
+        std::string summary;
+        for (const Phase *phase : sorted) {
+            double seconds = std::chrono::duration<double>(phase->total).count();
+            summary += fmt::format(
+                "\n\t{:9.3f}s {:5.1f}%  {} ({}x",
+                seconds,
+                startupSeconds > 0. ? seconds / startupSeconds * 100. : 0.,
+                phase->name,
+                phase->count
+            );
+            if (phase->count > 1) {
+                summary += fmt::format(
+                    ", slowest {:.3f}s",
+                    std::chrono::duration<double>(phase->slowest->end - phase->slowest->start).count()
+                );
+            }
+            if (!phase->slowest->detail.empty()) {
+                summary += fmt::format(" {}", phase->slowest->detail);
+            }
+            summary += ")";
+        }
+        spdlog::info("startup took {:.3f}s, phases by total time:{}", startupSeconds, summary);
+    }
+}
+
+StartupProfiler::Scope::Scope(const char *name, std::string detail)
+    : name(name),
+    detail(std::move(detail)),
+    start(Clock::now()),
+    recording(isRecording())
+{
+}
+
+StartupProfiler::Scope::~Scope()
+{
+    if (recording) {
+        record(name, std::move(detail), start, Clock::now());
+    }
+}
+
+
+void StartupProfiler::setTracePath(const std::filesystem::path &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tracePath = path;
+}
+
+bool StartupProfiler::isRecording()
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+void StartupProfiler::record(const char *name, std::string detail, Clock::time_point start, Clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!recording) {
+        return;
+    }
+    auto thread = threads.emplace(std::this_thread::get_id(), static_cast<uint32_t>(threads.size() + 1)).first;
+    events.push_back(Event{name, std::move(detail), start, end, thread->second});
+}
+
+void StartupProfiler::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!recording) {
+        return;
+    }
+    recording = false;
+
+    logSummary();
+    if (!tracePath.empty()) {
+        writeTrace(tracePath);
+    }
+    events.clear();
+    events.shrink_to_fit();
+}
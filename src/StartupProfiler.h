@@ -0,0 +1,38 @@
+#ifndef STARTUPPROFILER_H_
+#define STARTUPPROFILER_H_
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+// Times the phases of the application start: Scope objects record how long they lived, finish() logs
+// a summary sorted by total time and writes all phases as a trace in the Chrome trace event format
+// (chrome://tracing, ui.perfetto.dev). Nested phases are included in the time of their parents.
+// Recording is thread-safe and stops with finish(), so that later work costs next to nothing.
+class StartupProfiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    class Scope
+    {
+    public:
+        // name identifies the phase in the summary, detail tells instances apart, e.g. a resource name
+        Scope(const char *name, std::string detail = {});
+        Scope(const Scope &) = delete;
+        ~Scope();
+    private:
+        const char *name;
+        std::string detail;
+        Clock::time_point start;
+        bool recording;
+    };
+
+    // where finish() writes the trace, nothing is written if it is empty
+    static void setTracePath(const std::filesystem::path &path);
+    static bool isRecording();
+    static void record(const char *name, std::string detail, Clock::time_point start, Clock::time_point end);
+    static void finish();
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <glm/common.hpp>
 #include <glm/fwd.hpp>
 #include <spdlog/fmt/fmt.h>
@@ -70,3 +71,69 @@ glm::vec3 Utility::colorFromHsl(float H, float S, float L)
 	return { c.r + m, c.g + m, c.b + m };
 }
 
+
+namespace
+{
+	constexpr uint64_t PRIME1 = 0x9e3779b185ebca87ull;
+	constexpr uint64_t PRIME2 = 0xc2b2ae3d27d4eb4full;
+	constexpr uint64_t PRIME3 = 0x165667b19e3779f9ull;
+
+	uint64_t rotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	uint64_t finalMix(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= PRIME2;
+		value ^= value >> 29;
+		value *= PRIME3;
+		value ^= value >> 32;
+		return value;
+	}
+}
+
+bool Utility::Hash128::operator==(const Hash128 &other) const
+{
+	return low == other.low && high == other.high;
+}
+
+bool Utility::Hash128::operator!=(const Hash128 &other) const
+{
+	return !(*this == other);
+}
+
+void Utility::ContentHasher::update(const void *data, size_t size)
+{
+	const std::byte *bytes = static_cast<const std::byte *>(data);
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		low = rotateLeft(low + word * PRIME2, 31) * PRIME1;
+		high = rotateLeft(high + (word ^ PRIME3) * PRIME1, 27) * PRIME2;
+	}
+	// the size goes into the tail, so that pieces of different sizes never hash alike
+	uint64_t tail = 0;
+	if (i < size) {
+		std::memcpy(&tail, bytes + i, size - i);
+	}
+	tail ^= static_cast<uint64_t>(size) << 56;
+	low = rotateLeft(low ^ tail * PRIME1, 23) * PRIME3;
+	high = rotateLeft(high ^ tail * PRIME3, 29) * PRIME1;
+	length += size;
+}
+
+Utility::Hash128 Utility::ContentHasher::finish() const
+{
+	uint64_t a = low ^ length;
+	uint64_t b = high ^ rotateLeft(length, 32);
+	a += b;
+	b += a;
+	a = finalMix(a);
+	b = finalMix(b);
+	a += b;
+	b += a;
+	return Hash128{a, b};
+}
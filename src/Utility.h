@@ -1,6 +1,9 @@
 #ifndef UTILITY_H_
 #define UTILITY_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <glm/glm.hpp>
 #include <vector>
 #include <filesystem>
@@ -10,6 +13,36 @@ namespace Utility
     std::vector<std::byte> readFile(std::filesystem::path path);
     glm::vec3 colorFromHsl(float H, float S, float L);
 
+    struct Hash128
+    {
+        uint64_t low;
+        uint64_t high;
+
+        bool operator==(const Hash128 &other) const;
+        bool operator!=(const Hash128 &other) const;
+    };
+
+    // Fast non-cryptographic 128-bit hash of data fed in pieces, for telling apart resource contents.
+    // Two independent 64-bit lanes of multiply-rotate rounds over 8 byte words, mixed together at the end.
+    class ContentHasher
+    {
+    public:
+        void update(const void *data, size_t size);
+        template <class T>
+        void update(const std::vector<T> &values);
+        Hash128 finish() const;
+    private:
+        uint64_t low = 0x9e3779b97f4a7c15ull;
+        uint64_t high = 0xc2b2ae3d27d4eb4full;
+        uint64_t length = 0;
+    };
+
+    template <class T>
+    void ContentHasher::update(const std::vector<T> &values)
+    {
+        update(values.data(), values.size() * sizeof(T));
+    }
+
     template <class T>
     inline void hash_combine(size_t &seed, const T &v)
     {
@@ -28,4 +61,16 @@ namespace Utility
     }
 };
 
+namespace std
+{
+    template <>
+    struct hash<Utility::Hash128>
+    {
+        size_t operator()(const Utility::Hash128 &hash) const
+        {
+            return static_cast<size_t>(hash.low);
+        }
+    };
+}
+
 #endif
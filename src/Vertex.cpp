@@ -1,8 +1,41 @@
 #include "Vertex.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <glm/gtx/string_cast.hpp>
 
+namespace
+{
+    int16_t encodeSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::round(std::clamp(value, -1.f, 1.f) * 32767.f));
+    }
+
+    uint16_t encodeUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::round(std::clamp(value, 0.f, 1.f) * 65535.f));
+    }
+
+    glm::vec2 encodeOctahedral(glm::vec3 normal)
+    {
+        float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (l1 == 0.f) {
+            return glm::vec2(0.f);
+        }
+        normal /= l1;
+        if (normal.z < 0.f) {
+            // fold the lower hemisphere over the diagonals
+            return glm::vec2(
+                (1.f - std::abs(normal.y)) * (normal.x >= 0.f ? 1.f : -1.f),
+                (1.f - std::abs(normal.x)) * (normal.y >= 0.f ? 1.f : -1.f)
+            );
+        }
+        return glm::vec2(normal.x, normal.y);
+    }
+}
+
 std::string Vertex::to_string() const
 {
     return glm::to_string(position);
@@ -17,35 +50,31 @@ VkVertexInputBindingDescription Vertex::getBindingDescription() {
     return bindingDescription;
 }
 
-std::array<VkVertexInputAttributeDescription, 4> Vertex::getAttributeDescriptions()
-{
-    std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
-
-    // position
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-    // normal
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, normal);
-
-    // color
-    attributeDescriptions[2].binding = 0;
-    attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[2].offset = offsetof(Vertex, color);
-
-    // uv
-    attributeDescriptions[3].binding = 0;
-    attributeDescriptions[3].location = 3;
-    attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[3].offset = offsetof(Vertex, uv);
-
-    return attributeDescriptions;
+CompressedVertex CompressedVertex::encode(
+    const Vertex &vertex,
+    const glm::vec3 &positionOffset,
+    const glm::vec3 &positionScale,
+    const glm::vec2 &uvOffset,
+    const glm::vec2 &uvScale
+) {
+    glm::vec3 position = (vertex.position - positionOffset) / positionScale;
+    glm::vec2 normal = encodeOctahedral(vertex.normal);
+    glm::vec2 uv = (vertex.uv - uvOffset) / uvScale;
+
+    return CompressedVertex{
+        .position = {encodeSnorm16(position.x), encodeSnorm16(position.y), encodeSnorm16(position.z), 0},
+        .normal = {encodeSnorm16(normal.x), encodeSnorm16(normal.y)},
+        .uv = {encodeUnorm16(uv.x), encodeUnorm16(uv.y)},
+    };
+}
+
+VkVertexInputBindingDescription CompressedVertex::getBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(CompressedVertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return bindingDescription;
 }
 
 std::ostream &operator <<(std::ostream &s, const Vertex &v)
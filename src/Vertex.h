@@ -4,12 +4,22 @@
 #include "Utility.h"
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <glm/fwd.hpp>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan_core.h>
 
 
+enum class VertexFormat : uint32_t
+{
+    // Vertex: 32 bit floats for all attributes
+    STANDARD = 0,
+    // CompressedVertex: quantized relative to the mesh bounds, no vertex color
+    COMPRESSED = 1,
+};
+
 struct Vertex {
     glm::vec3 position;
     glm::vec3 normal;
@@ -19,9 +29,51 @@ struct Vertex {
     std::string to_string() const;
 
     static VkVertexInputBindingDescription getBindingDescription();
-    static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+    // constexpr, so that the vertex inputs of the shaders are checked against it at compile time
+    static constexpr std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+};
+
+// 16 bytes instead of the 44 of Vertex:
+// - position: snorm16 relative to the mesh bounds, mapped back by Mesh::getPositionTransform()
+// - normal: octahedral encoding in two snorm16 components
+// - uv: unorm16 relative to the uv bounds, mapped back by Mesh::getUvTransform()
+struct CompressedVertex {
+    int16_t position[4];
+    int16_t normal[2];
+    uint16_t uv[2];
+
+    static CompressedVertex encode(
+        const Vertex &vertex,
+        const glm::vec3 &positionOffset,
+        const glm::vec3 &positionScale,
+        const glm::vec2 &uvOffset,
+        const glm::vec2 &uvScale
+    );
+    static VkVertexInputBindingDescription getBindingDescription();
+    static constexpr std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
 };
 
+constexpr std::array<VkVertexInputAttributeDescription, 4> Vertex::getAttributeDescriptions()
+{
+    return {{
+        // location, binding, format, offset
+        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)},
+        {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)},
+        {2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)},
+        {3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv)},
+    }};
+}
+
+constexpr std::array<VkVertexInputAttributeDescription, 3> CompressedVertex::getAttributeDescriptions()
+{
+    return {{
+        {0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(CompressedVertex, position)},
+        // octahedral normal
+        {1, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompressedVertex, normal)},
+        {2, 0, VK_FORMAT_R16G16_UNORM, offsetof(CompressedVertex, uv)},
+    }};
+}
+
 namespace std
 {
     template <>
@@ -1,20 +1,63 @@
 #include "VulkanObjectCache.h"
 #include "DescriptorSetLayout.h"
 #include "Device.h"
+#include "GraphicsPipeline.h"
+#include "Material.h"
+#include "RenderPass.h"
 #include "Resource.h"
+#include "StartupProfiler.h"
 #include "VkHelpers.h"
 #include "VkHash.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iterator>
 #include <memory>
 #include <spdlog/spdlog.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan_core.h>
 
+namespace
+{
+    template<typename T>
+    const char *getTypeName()
+    {
+        if (std::is_same<T, Image>::value) {
+            return "Image";
+        }
+        if (std::is_same<T, Shader>::value) {
+            return "Shader";
+        }
+        return "GraphicsPipeline";
+    }
+}
+
 VulkanObjectCache::VulkanObjectCache(Device &device)
-    : device(device)
+    : device(device),
+    pipelineCompiler(std::make_unique<PipelineCompiler>())
 {
 }
 
 VulkanObjectCache::~VulkanObjectCache()
 {
+    // drops the compilations that have not started, the finished ones are destroyed with their pipelines
+    pipelineCompiler.reset();
+    for (PendingPipeline &pending : pendingGraphicsPipelines) {
+        try {
+            pending.pipeline->setCompiledPipeline(pending.compilation.get());
+        }
+        catch (std::exception &) {
+        }
+    }
+    pendingGraphicsPipelines.clear();
+    // pipelines before the layouts they were created with
+    graphicsPipelines.clear();
+    evictedGraphicsPipelines.clear();
+    for (auto &pipelineLayout : pipelineLayouts) {
+        vkDestroyPipelineLayout(device.getDeviceHandle(), pipelineLayout.second, nullptr);
+    }
     for (auto &sampler : samplers) {
         vkDestroySampler(device.getDeviceHandle(), sampler.second, nullptr);
     }
@@ -53,7 +96,7 @@ DescriptorSetLayout &VulkanObjectCache::getDescriptorSetLayout(
 
     DescriptorSetLayout &layout = *descriptorSetLayouts.emplace(
         hash,
-        std::make_unique<DescriptorSetLayout>(device.getDeviceHandle(), bindings)
+        std::make_unique<DescriptorSetLayout>(device.getDeviceHandle(), bindings, flags, device.getFunctions())
     ).first->second;
 
     spdlog::info("VulkanObjectCache: created descriptor set layout at {}", (void*) &layout);
@@ -61,39 +104,353 @@ DescriptorSetLayout &VulkanObjectCache::getDescriptorSetLayout(
     return layout;
 }
 
+VkPipelineLayout VulkanObjectCache::getPipelineLayout(
+    const std::vector<VkDescriptorSetLayout> &setLayouts,
+    const std::vector<VkPushConstantRange> &pushConstantRanges
+)
+{
+    size_t hash = 0;
+    for (VkDescriptorSetLayout setLayout : setLayouts) {
+        Utility::hash_combine(hash, setLayout);
+    }
+    for (const VkPushConstantRange &range : pushConstantRanges) {
+        Utility::hash_combine(hash, range.stageFlags);
+        Utility::hash_combine(hash, range.offset);
+        Utility::hash_combine(hash, range.size);
+    }
+    auto i = pipelineLayouts.find(hash);
+    if (i != pipelineLayouts.end()) {
+        return i->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    VkPipelineLayout newPipelineLayout = VK_NULL_HANDLE;
+    VK_ASSERT(vkCreatePipelineLayout(device.getDeviceHandle(), &pipelineLayoutInfo, nullptr, &newPipelineLayout));
+    pipelineLayouts.emplace(hash, newPipelineLayout);
 
-Image &VulkanObjectCache::getImage(const ImageResource &resource)
+    spdlog::info("VulkanObjectCache: created pipeline layout {}", (void*) newPipelineLayout);
+
+    return newPipelineLayout;
+}
+
+
+CacheReference<Image> VulkanObjectCache::acquireImage(const ImageResource &resource)
+{
+    return acquire(images, resource.getId(), [this, &resource]() {
+        return std::make_unique<Image>(device, resource);
+    });
+}
+
+CacheReference<Shader> VulkanObjectCache::acquireShader(const ShaderResource &resource)
+{
+    return acquire(shaders, resource.getId(), [this, &resource]() {
+        return std::make_unique<Shader>(device, resource);
+    });
+}
+
+CacheReference<GraphicsPipeline> VulkanObjectCache::acquireGraphicsPipeline(
+    const RenderPass &renderPass,
+    const Material &material,
+    VertexFormat vertexFormat
+)
+{
+    // the fixed function state is the same for all pipelines, the render pass determines the attachments
+    size_t hash = Utility::hash_value(renderPass.getHandle());
+    Utility::hash_combine(hash, material.getVertexShaderResource(vertexFormat).getId());
+    Utility::hash_combine(hash, material.getFragmentShaderResource().getId());
+    Utility::hash_combine(hash, getMaterialDescriptorSetLayout(material).getHandle());
+    Utility::hash_combine(hash, vertexFormat);
+    // variants of the same shaders differ in their specialization constants only
+    Utility::hash_combine(hash, material.getShaderFeatures().getMask());
+
+    CacheReference<Shader> vertexShader;
+    CacheReference<Shader> fragmentShader;
+    CacheReference<GraphicsPipeline> pipeline = acquire(graphicsPipelines, hash, [&]() {
+        StartupProfiler::Scope scope("set up pipeline", fmt::format("material {}", material.getId()));
+        vertexShader = acquireShader(material.getVertexShaderResource(vertexFormat));
+        fragmentShader = acquireShader(material.getFragmentShaderResource());
+        return std::make_unique<GraphicsPipeline>(
+            device,
+            renderPass,
+            material,
+            vertexFormat,
+            *vertexShader,
+            *fragmentShader
+        );
+    });
+
+    if (vertexShader.get()) {
+        GraphicsPipeline::CompileInfo info = pipeline->getCompileInfo();
+        pendingGraphicsPipelines.push_back(PendingPipeline{
+            CacheReference<GraphicsPipeline>(*this, graphicsPipelines.at(hash)),
+            std::move(vertexShader),
+            std::move(fragmentShader),
+            pipelineCompiler->enqueue([info]() {
+                return GraphicsPipeline::compile(info);
+            }),
+        });
+    }
+    return pipeline;
+}
+
+void VulkanObjectCache::evictImage(ResourceId id)
 {
-    ResourceId id = resource.getId();
     auto i = images.find(id);
     if (i != images.end()) {
-        return *i->second;
+        markStale(images, i, evictedImages);
     }
+}
 
-    Image &image = *images.emplace(
-        id,
-        std::make_unique<Image>(device, resource)
-    ).first->second;
+void VulkanObjectCache::evictShader(ResourceId id)
+{
+    auto i = shaders.find(id);
+    if (i != shaders.end()) {
+        markStale(shaders, i, evictedShaders);
+    }
+    for (auto j = graphicsPipelines.begin(); j != graphicsPipelines.end();) {
+        auto next = std::next(j);
+        if (j->second.object->usesShader(id)) {
+            markStale(graphicsPipelines, j, evictedGraphicsPipelines);
+        }
+        j = next;
+    }
+}
 
-    spdlog::info("VulkanObjectCache: created Image at {}", (void*) &image);
+void VulkanObjectCache::waitForGraphicsPipelines()
+{
+    if (!pendingGraphicsPipelines.empty()) {
+        spdlog::info("VulkanObjectCache: waiting for {} pipelines to compile", pendingGraphicsPipelines.size());
+        finishGraphicsPipelines(true);
+    }
+}
 
-    return image;
+void VulkanObjectCache::beginFrame(uint64_t frame, uint64_t retiredFrame)
+{
+    this->frame = frame;
+    destroyRetired(evictedImages, retiredFrame);
+    destroyRetired(evictedShaders, retiredFrame);
+    destroyRetired(evictedGraphicsPipelines, retiredFrame);
+    finishGraphicsPipelines(false);
+    evictUnused();
+    assignFallbackPipelines();
 }
 
-Shader &VulkanObjectCache::getShader(const ShaderResource &resource)
+uint64_t VulkanObjectCache::getFrame() const
 {
-    ResourceId id = resource.getId();
-    auto i = shaders.find(id);
-    if (i != shaders.end()) {
-        return *i->second;
+    return frame;
+}
+
+DescriptorSetLayout &VulkanObjectCache::getMaterialDescriptorSetLayout(const Material &material)
+{
+    return getDescriptorSetLayout(
+        material.getDescriptorSetLayoutBindings(),
+        pushMaterialDescriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0
+    );
+}
+
+void VulkanObjectCache::setPushMaterialDescriptors(bool push)
+{
+    if (push && !device.getFunctions().hasPushDescriptors()) {
+        throw std::runtime_error("VulkanObjectCache: push descriptors require VK_KHR_push_descriptor");
     }
+    if (!graphicsPipelines.empty()) {
+        throw std::runtime_error("VulkanObjectCache: the material descriptor mode must be chosen before creating pipelines");
+    }
+    pushMaterialDescriptors = push;
+    spdlog::info("VulkanObjectCache: material descriptors are {}", push ? "pushed" : "bound from descriptor sets");
+}
 
-    Shader &shader = *shaders.emplace(
-        id,
-        std::make_unique<Shader>(device, resource)
-    ).first->second;
+bool VulkanObjectCache::usesPushMaterialDescriptors() const
+{
+    return pushMaterialDescriptors;
+}
+
+void VulkanObjectCache::setMemoryBudget(VkDeviceSize budget)
+{
+    memoryBudget = budget;
+    spdlog::info("VulkanObjectCache: memory budget {} MiB", budget / (1024 * 1024));
+}
 
-    spdlog::info("VulkanObjectCache: created Shader at {}", (void*) &shader);
+VkDeviceSize VulkanObjectCache::getMemoryBudget() const
+{
+    return memoryBudget;
+}
 
-    return shader;
+VkDeviceSize VulkanObjectCache::getMemoryUsage() const
+{
+    return cachedMemory + evictedMemory;
+}
+
+template<typename Key, typename T, typename Factory>
+CacheReference<T> VulkanObjectCache::acquire(
+    std::unordered_map<Key, CacheEntry<T>> &entries,
+    Key key,
+    Factory create
+)
+{
+    auto i = entries.find(key);
+    if (i == entries.end()) {
+        CacheEntry<T> entry;
+        entry.object = create();
+        entry.size = entry.object->getSize();
+        cachedMemory += entry.size;
+        i = entries.emplace(key, std::move(entry)).first;
+        spdlog::info(
+            "VulkanObjectCache: created {} {} ({} KiB)",
+            getTypeName<T>(),
+            key,
+            i->second.size / 1024
+        );
+    }
+    // entries are only erased when unreferenced, so the reference can point into the map
+    return CacheReference<T>(*this, i->second);
+}
+
+template<typename Key, typename T>
+void VulkanObjectCache::markStale(
+    std::unordered_map<Key, CacheEntry<T>> &entries,
+    typename std::unordered_map<Key, CacheEntry<T>>::iterator entry,
+    std::vector<Eviction<T>> &evictions
+)
+{
+    if (entry->second.stale) {
+        return;
+    }
+    if (entry->second.references == 0) {
+        evict(entries, entry, evictions);
+    }
+    else {
+        entry->second.stale = true;
+        ++staleCount;
+    }
+}
+
+template<typename Key, typename T>
+void VulkanObjectCache::evict(
+    std::unordered_map<Key, CacheEntry<T>> &entries,
+    typename std::unordered_map<Key, CacheEntry<T>>::iterator entry,
+    std::vector<Eviction<T>> &evictions
+)
+{
+    spdlog::info(
+        "VulkanObjectCache: evicting {} {} ({} KiB, last used in frame {})",
+        getTypeName<T>(),
+        entry->first,
+        entry->second.size / 1024,
+        entry->second.lastUsedFrame
+    );
+    if (entry->second.stale) {
+        --staleCount;
+    }
+    cachedMemory -= entry->second.size;
+    evictedMemory += entry->second.size;
+    // objects released in the current frame may still be recorded into its command buffer
+    evictions.push_back(Eviction<T>{
+        std::move(entry->second.object),
+        entry->second.size,
+        std::max(entry->second.lastUsedFrame, frame),
+    });
+    entries.erase(entry);
+}
+
+template<typename Key, typename T>
+void VulkanObjectCache::evictStale(std::unordered_map<Key, CacheEntry<T>> &entries, std::vector<Eviction<T>> &evictions)
+{
+    for (auto i = entries.begin(); i != entries.end();) {
+        auto next = std::next(i);
+        if (i->second.stale && i->second.references == 0) {
+            evict(entries, i, evictions);
+        }
+        i = next;
+    }
+}
+
+template<typename T>
+void VulkanObjectCache::destroyRetired(std::vector<Eviction<T>> &evictions, uint64_t retiredFrame)
+{
+    auto retired = std::stable_partition(evictions.begin(), evictions.end(), [retiredFrame](const Eviction<T> &e) {
+        return e.frame > retiredFrame;
+    });
+    for (auto i = retired; i != evictions.end(); ++i) {
+        evictedMemory -= i->size;
+    }
+    evictions.erase(retired, evictions.end());
+}
+
+void VulkanObjectCache::evictUnused()
+{
+    if (staleCount > 0) {
+        evictStale(images, evictedImages);
+        evictStale(shaders, evictedShaders);
+        evictStale(graphicsPipelines, evictedGraphicsPipelines);
+    }
+
+    if (cachedMemory <= memoryBudget) {
+        return;
+    }
+    // shader modules take no device memory worth counting, only images are evicted for the budget
+    std::vector<std::pair<uint64_t, ResourceId>> candidates;
+    for (const auto &i : images) {
+        if (i.second.references == 0) {
+            candidates.emplace_back(i.second.lastUsedFrame, i.first);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto &candidate : candidates) {
+        if (cachedMemory <= memoryBudget) {
+            break;
+        }
+        evict(images, images.find(candidate.second), evictedImages);
+    }
+    if (cachedMemory > memoryBudget) {
+        spdlog::debug(
+            "VulkanObjectCache: {} MiB in use exceed the budget of {} MiB",
+            cachedMemory / (1024 * 1024),
+            memoryBudget / (1024 * 1024)
+        );
+    }
+}
+
+void VulkanObjectCache::finishGraphicsPipelines(bool wait)
+{
+    for (auto i = pendingGraphicsPipelines.begin(); i != pendingGraphicsPipelines.end();) {
+        if (!wait && i->compilation.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++i;
+            continue;
+        }
+        // a pipeline that failed to compile is never ready, its draws keep using the fallback
+        try {
+            i->pipeline->setCompiledPipeline(i->compilation.get());
+        }
+        catch (std::exception &e) {
+            spdlog::error("VulkanObjectCache: compiling a pipeline failed: {}", e.what());
+        }
+        i = pendingGraphicsPipelines.erase(i);
+    }
+}
+
+void VulkanObjectCache::assignFallbackPipelines()
+{
+    for (auto &i : graphicsPipelines) {
+        GraphicsPipeline &pipeline = *i.second.object;
+        if (pipeline.isReady()) {
+            continue;
+        }
+        GraphicsPipeline *fallback = nullptr;
+        for (auto &j : graphicsPipelines) {
+            if (j.second.object->isReady() && j.second.object->isCompatible(pipeline)) {
+                fallback = j.second.object.get();
+                // an evicted fallback must outlive the frames drawing with it
+                j.second.lastUsedFrame = frame;
+                break;
+            }
+        }
+        pipeline.setFallback(fallback);
+    }
 }
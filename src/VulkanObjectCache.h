@@ -3,20 +3,70 @@
 
 #include "DescriptorSet.h"
 #include "DescriptorSetLayout.h"
+#include "GraphicsPipeline.h"
 #include "Image.h"
+#include "PipelineCompiler.h"
 #include "Resource.h"
 #include "Shader.h"
+#include <cstdint>
+#include <future>
 #include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan_core.h>
 
 class Device;
+class Material;
+class RenderPass;
+class VulkanObjectCache;
 
+// an object created from a resource or from pipeline state, shared by everything holding a CacheReference to it
+template<typename T>
+struct CacheEntry
+{
+    std::unique_ptr<T> object;
+    // device memory counted against the budget
+    VkDeviceSize size = 0;
+    uint32_t references = 0;
+    // frame in which the object was last acquired or released, orders unreferenced objects for eviction
+    uint64_t lastUsedFrame = 0;
+    // the resource data was replaced, so the object is evicted as soon as it is unreferenced
+    bool stale = false;
+};
+
+// One reference to an object of the VulkanObjectCache, released when destroyed or overwritten.
+template<typename T>
+class CacheReference
+{
+public:
+    CacheReference() = default;
+    CacheReference(VulkanObjectCache &cache, CacheEntry<T> &entry);
+    CacheReference(const CacheReference<T> &) = delete;
+    CacheReference(CacheReference<T> &&other);
+    CacheReference<T> &operator=(CacheReference<T> &&other);
+    ~CacheReference();
+
+    T &operator*() const;
+    T *operator->() const;
+    T *get() const;
+private:
+    void release();
+
+    VulkanObjectCache *cache = nullptr;
+    CacheEntry<T> *entry = nullptr;
+};
+
+// Images, shaders and graphics pipelines are reference counted. Unreferenced ones stay cached for reuse until
+// they are stale or the memory budget is exceeded, then the least recently used ones are evicted. Evicted objects
+// are destroyed once the frames that may still use them have retired, see beginFrame().
 class VulkanObjectCache
 {
 public:
     typedef size_t KeyType;
 
+    static constexpr VkDeviceSize DEFAULT_MEMORY_BUDGET = 512ull * 1024 * 1024;
+
     VulkanObjectCache(Device &device);
     VulkanObjectCache(const VulkanObjectCache &) = delete;
     ~VulkanObjectCache();
@@ -26,15 +76,171 @@ public:
         const std::vector<VkDescriptorSetLayoutBinding> &bindings,
         VkDescriptorSetLayoutCreateFlags flags = 0
     );
-    Image &getImage(const ImageResource &resource);
-    Shader &getShader(const ShaderResource &resource);
+    // set 1 of the graphics pipelines, a push descriptor layout if material descriptors are pushed
+    DescriptorSetLayout &getMaterialDescriptorSetLayout(const Material &material);
+    VkPipelineLayout getPipelineLayout(
+        const std::vector<VkDescriptorSetLayout> &setLayouts,
+        const std::vector<VkPushConstantRange> &pushConstantRanges
+    );
+    CacheReference<Image> acquireImage(const ImageResource &resource);
+    CacheReference<Shader> acquireShader(const ShaderResource &resource);
+    // keyed by the shaders, their feature variant, the descriptor set layouts, the vertex format and the
+    // render pass, so materials differing only in their parameters and images share one pipeline.
+    // New pipelines are compiled on worker threads and become ready in a later beginFrame(),
+    // until then they draw with a compatible fallback pipeline if there is one.
+    CacheReference<GraphicsPipeline> acquireGraphicsPipeline(
+        const RenderPass &renderPass,
+        const Material &material,
+        VertexFormat vertexFormat
+    );
+    // the resource was reloaded, the object created from its old data is evicted once it is unreferenced
+    void evictImage(ResourceId id);
+    // also evicts the pipelines built from the shader
+    void evictShader(ResourceId id);
+
+    // blocks until all pipelines acquired so far are compiled and ready
+    void waitForGraphicsPipelines();
+
+    // to be called once per frame after waiting for its fence: objects evicted in or before retiredFrame
+    // are destroyed, objects released from now on are stamped with frame, compiled pipelines are swapped in
+    void beginFrame(uint64_t frame, uint64_t retiredFrame);
+    uint64_t getFrame() const;
+    // material descriptors are either pushed while recording (VK_KHR_push_descriptor) or bound from
+    // descriptor sets allocated per frame; must be chosen before the first pipeline is acquired
+    void setPushMaterialDescriptors(bool push);
+    bool usesPushMaterialDescriptors() const;
+    // only unreferenced objects can be evicted, so referenced ones may exceed the budget
+    void setMemoryBudget(VkDeviceSize budget);
+    VkDeviceSize getMemoryBudget() const;
+    VkDeviceSize getMemoryUsage() const;
 private:
+    template<typename T>
+    struct Eviction
+    {
+        std::unique_ptr<T> object;
+        VkDeviceSize size;
+        uint64_t frame;
+    };
+
+    struct PendingPipeline
+    {
+        CacheReference<GraphicsPipeline> pipeline;
+        // the modules have to outlive the compilation
+        CacheReference<Shader> vertexShader;
+        CacheReference<Shader> fragmentShader;
+        std::future<VkPipeline> compilation;
+    };
+
+    template<typename Key, typename T, typename Factory>
+    CacheReference<T> acquire(std::unordered_map<Key, CacheEntry<T>> &entries, Key key, Factory create);
+    template<typename Key, typename T>
+    void markStale(
+        std::unordered_map<Key, CacheEntry<T>> &entries,
+        typename std::unordered_map<Key, CacheEntry<T>>::iterator entry,
+        std::vector<Eviction<T>> &evictions
+    );
+    template<typename Key, typename T>
+    void evict(
+        std::unordered_map<Key, CacheEntry<T>> &entries,
+        typename std::unordered_map<Key, CacheEntry<T>>::iterator entry,
+        std::vector<Eviction<T>> &evictions
+    );
+    template<typename Key, typename T>
+    void evictStale(std::unordered_map<Key, CacheEntry<T>> &entries, std::vector<Eviction<T>> &evictions);
+    template<typename T>
+    void destroyRetired(std::vector<Eviction<T>> &evictions, uint64_t retiredFrame);
+    // evicts stale objects, then the least recently used ones while the budget is exceeded
+    void evictUnused();
+    // hands compiled pipelines to their objects, without wait only those that are already done
+    void finishGraphicsPipelines(bool wait);
+    void assignFallbackPipelines();
+
     Device &device;
     
     std::unordered_map<KeyType, VkSampler> samplers;
     std::unordered_map<KeyType, std::unique_ptr<DescriptorSetLayout>> descriptorSetLayouts;
-    std::unordered_map<ResourceId, std::unique_ptr<Image>> images;
-    std::unordered_map<ResourceId, std::unique_ptr<Shader>> shaders;
+    std::unordered_map<KeyType, VkPipelineLayout> pipelineLayouts;
+    std::unordered_map<ResourceId, CacheEntry<Image>> images;
+    std::unordered_map<ResourceId, CacheEntry<Shader>> shaders;
+    std::unordered_map<KeyType, CacheEntry<GraphicsPipeline>> graphicsPipelines;
+    std::vector<Eviction<Image>> evictedImages;
+    std::vector<Eviction<Shader>> evictedShaders;
+    std::vector<Eviction<GraphicsPipeline>> evictedGraphicsPipelines;
+    std::unique_ptr<PipelineCompiler> pipelineCompiler;
+    std::vector<PendingPipeline> pendingGraphicsPipelines;
+
+    uint64_t frame = 0;
+    // entries marked stale while still referenced
+    size_t staleCount = 0;
+    VkDeviceSize memoryBudget = DEFAULT_MEMORY_BUDGET;
+    bool pushMaterialDescriptors = false;
+    VkDeviceSize cachedMemory = 0;
+    // of evicted objects waiting for their frames to retire
+    VkDeviceSize evictedMemory = 0;
 };
 
+template<typename T>
+CacheReference<T>::CacheReference(VulkanObjectCache &cache, CacheEntry<T> &entry)
+    : cache(&cache),
+    entry(&entry)
+{
+    ++entry.references;
+    entry.lastUsedFrame = cache.getFrame();
+}
+
+template<typename T>
+CacheReference<T>::CacheReference(CacheReference<T> &&other)
+    : cache(other.cache),
+    entry(other.entry)
+{
+    other.entry = nullptr;
+}
+
+template<typename T>
+CacheReference<T> &CacheReference<T>::operator=(CacheReference<T> &&other)
+{
+    if (this != &other) {
+        release();
+        cache = other.cache;
+        entry = other.entry;
+        other.entry = nullptr;
+    }
+    return *this;
+}
+
+template<typename T>
+CacheReference<T>::~CacheReference()
+{
+    release();
+}
+
+template<typename T>
+T &CacheReference<T>::operator*() const
+{
+    return *entry->object;
+}
+
+template<typename T>
+T *CacheReference<T>::operator->() const
+{
+    return entry->object.get();
+}
+
+template<typename T>
+T *CacheReference<T>::get() const
+{
+    return entry ? entry->object.get() : nullptr;
+}
+
+template<typename T>
+void CacheReference<T>::release()
+{
+    // unreferenced entries are left to the cache, which evicts them in beginFrame()
+    if (entry) {
+        --entry->references;
+        entry->lastUsedFrame = cache->getFrame();
+        entry = nullptr;
+    }
+}
+
 #endif
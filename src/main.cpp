@@ -1,10 +1,17 @@
+#include <filesystem>
+#include <optional>
 #include <string>
 #include <set>
+#include <unordered_map>
+#include <utility>
 #include <spdlog/common.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 #include "Application.h"
+#include "ResourceRepository.h"
+#include "SceneGenerator.h"
+#include "StartupProfiler.h"
 
 int main(int argc, char *argv[])
 {
@@ -36,7 +43,104 @@ int main(int argc, char *argv[])
 #endif
 
     try {
-        Application app(true, 3, singleFrame);
+        // --mesh-settings=<file>: per mesh import settings, one line per mesh like
+        //   mesh/cylinder: lod.levelCount=0 optimizer.overdraw=false meshlets.minTriangles=1024
+        // see MeshImportSettings::loadOverrides; changed settings rebuild the cached meshes
+        std::unordered_map<ResourceKey, MeshImportSettings> meshSettings;
+        for (const auto &o : options) {
+            const std::string meshSettingsOption = "--mesh-settings=";
+            if (o.rfind(meshSettingsOption, 0) == 0) {
+                meshSettings = MeshImportSettings::loadOverrides(o.substr(meshSettingsOption.size()));
+            }
+        }
+
+        // --build-pack=<file>: writes every resource below the working directory into one asset pack and exits,
+        // --pack=<file>: serves resources from such a pack instead of the working directory
+        std::filesystem::path assetPack;
+        for (const auto &o : options) {
+            const std::string buildPackOption = "--build-pack=";
+            const std::string packOption = "--pack=";
+            if (o.rfind(buildPackOption, 0) == 0) {
+                ResourceRepository(
+                    "",
+                    MeshImportSettings{},
+                    meshSettings
+                ).writeAssetPack(o.substr(buildPackOption.size()));
+                return 0;
+            }
+            if (o.rfind(packOption, 0) == 0) {
+                assetPack = o.substr(packOption.size());
+            }
+        }
+
+        // --startup-trace=<file>: writes the timed startup phases as a Chrome trace (chrome://tracing, Perfetto)
+        for (const auto &o : options) {
+            const std::string traceOption = "--startup-trace=";
+            if (o.rfind(traceOption, 0) == 0) {
+                StartupProfiler::setTracePath(o.substr(traceOption.size()));
+            }
+        }
+
+        // --lod-error=<pixels>: screen space error up to which coarser levels of detail are drawn
+        LodSelection lodSelection;
+        const std::string lodErrorOption = "--lod-error=";
+        for (const auto &o : options) {
+            if (o.rfind(lodErrorOption, 0) == 0) {
+                lodSelection.maxPixelError = std::stof(o.substr(lodErrorOption.size()));
+            }
+        }
+
+        ClusterCulling clusterCulling;
+        if (options.find("--no-cluster-culling") != options.end()) {
+            clusterCulling.enabled = false;
+        }
+
+        // --scene=<grid|random|clustered>: replaces the initial objects by a generated stress scene,
+        // sized by --scene-objects=N, --scene-materials=M, --scene-seed=S and --scene-animated[=fraction]
+        std::optional<SceneGenerator::Settings> sceneSettings;
+        auto getValue = [](const std::string &option, const std::string &name) -> std::optional<std::string> {
+            if (option.rfind(name, 0) == 0) {
+                return option.substr(name.size());
+            }
+            return std::nullopt;
+        };
+        for (const auto &o : options) {
+            if (auto value = getValue(o, "--scene=")) {
+                if (!sceneSettings) {
+                    sceneSettings.emplace();
+                }
+                sceneSettings->layout = SceneGenerator::parseLayout(*value);
+            }
+        }
+        if (sceneSettings) {
+            for (const auto &o : options) {
+                if (auto value = getValue(o, "--scene-objects=")) {
+                    sceneSettings->objectCount = static_cast<uint32_t>(std::stoul(*value));
+                } else if (auto value = getValue(o, "--scene-materials=")) {
+                    sceneSettings->materialCount = static_cast<uint32_t>(std::stoul(*value));
+                } else if (auto value = getValue(o, "--scene-seed=")) {
+                    sceneSettings->seed = static_cast<uint32_t>(std::stoul(*value));
+                } else if (auto value = getValue(o, "--scene-animated=")) {
+                    sceneSettings->animatedFraction = std::stof(*value);
+                } else if (o == "--scene-animated") {
+                    sceneSettings->animatedFraction = 1.f;
+                }
+            }
+        }
+
+        // --push-descriptors: pushes material descriptors while recording instead of binding descriptor sets
+        bool pushDescriptors = options.find("--push-descriptors") != options.end();
+
+        Application app(true, 3, singleFrame, sceneSettings, assetPack, pushDescriptors, std::move(meshSettings));
+        app.setLodSelection(lodSelection);
+        app.setClusterCulling(clusterCulling);
+        app.setHotReload(options.find("--no-hot-reload") == options.end());
+        // --memory-budget=<MiB>: device memory cached images may take before unused ones are evicted
+        for (const auto &o : options) {
+            if (auto value = getValue(o, "--memory-budget=")) {
+                app.setMemoryBudget(std::stoull(*value) * 1024 * 1024);
+            }
+        }
         app.run();
     } catch (const std::exception& e) {
         spdlog::critical("Exception {}: {}", typeid(e).name(), e.what());
@@ -0,0 +1,172 @@
+// Reflects compiled shaders into a header of constexpr ShaderLayouts, see ShaderLayout.h.
+// usage: shader-reflect <output header> <shader.spv>...
+
+#include "../ShaderLayout.h"
+#include "../third-party/spirv_reflect/spirv_reflect.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <vulkan/vk_enum_string_helper.h>
+
+namespace
+{
+    std::vector<std::byte> readFile(const std::filesystem::path &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("could not open " + path.string());
+        }
+        std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        const std::byte *bytes = reinterpret_cast<const std::byte *>(data.data());
+        return std::vector<std::byte>(bytes, bytes + data.size());
+    }
+
+    // shader.compressed.vert.spv -> SHADER_COMPRESSED_VERT
+    std::string getIdentifier(const std::filesystem::path &path)
+    {
+        std::string identifier;
+        for (char c : path.stem().string()) {
+            identifier += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(c)) : '_';
+        }
+        return identifier;
+    }
+
+    void reflect(std::ostream &out, const std::filesystem::path &path, const std::string &identifier)
+    {
+        std::vector<std::byte> code = readFile(path);
+        spv_reflect::ShaderModule module{code.size(), code.data()};
+        if (module.GetResult() != SPV_REFLECT_RESULT_SUCCESS) {
+            throw std::runtime_error("could not reflect " + path.string());
+        }
+        VkShaderStageFlagBits stage = static_cast<VkShaderStageFlagBits>(module.GetShaderStage());
+
+        uint32_t count = 0;
+        module.EnumerateDescriptorBindings(&count, nullptr);
+        std::vector<SpvReflectDescriptorBinding *> bindings(count);
+        module.EnumerateDescriptorBindings(&count, bindings.data());
+        if (!bindings.empty()) {
+            out << "    constexpr ShaderLayout::Binding " << identifier << "_BINDINGS[] = {\n";
+            for (const SpvReflectDescriptorBinding *binding : bindings) {
+                uint32_t descriptorCount = 1;
+                for (uint32_t i = 0; i < binding->array.dims_count; ++i) {
+                    descriptorCount *= binding->array.dims[i];
+                }
+                out << "        {" << binding->set << ", " << binding->binding << ", "
+                    << string_VkDescriptorType(static_cast<VkDescriptorType>(binding->descriptor_type)) << ", "
+                    << descriptorCount << "},\n";
+            }
+            out << "    };\n";
+        }
+
+        module.EnumeratePushConstantBlocks(&count, nullptr);
+        std::vector<SpvReflectBlockVariable *> pushConstants(count);
+        module.EnumeratePushConstantBlocks(&count, pushConstants.data());
+        if (!pushConstants.empty()) {
+            out << "    constexpr ShaderLayout::PushConstantRange " << identifier << "_PUSH_CONSTANTS[] = {\n";
+            for (const SpvReflectBlockVariable *block : pushConstants) {
+                out << "        {" << block->offset << ", " << block->size << "},\n";
+            }
+            out << "    };\n";
+        }
+
+        std::vector<SpvReflectInterfaceVariable *> inputs;
+        if (stage == VK_SHADER_STAGE_VERTEX_BIT) {
+            module.EnumerateInputVariables(&count, nullptr);
+            inputs.resize(count);
+            module.EnumerateInputVariables(&count, inputs.data());
+            inputs.erase(
+                std::remove_if(inputs.begin(), inputs.end(), [](const SpvReflectInterfaceVariable *input) {
+                    return input->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN;
+                }),
+                inputs.end()
+            );
+        }
+        if (!inputs.empty()) {
+            out << "    constexpr ShaderLayout::VertexInput " << identifier << "_VERTEX_INPUTS[] = {\n";
+            for (const SpvReflectInterfaceVariable *input : inputs) {
+                out << "        {" << input->location << ", "
+                    << string_VkFormat(static_cast<VkFormat>(input->format)) << "},\n";
+            }
+            out << "    };\n";
+        }
+
+        auto arrayOrNull = [&identifier](bool empty, const char *suffix) {
+            return empty ? std::string("nullptr") : identifier + suffix;
+        };
+        out << "    constexpr ShaderLayout " << identifier << "{\n"
+            << "        \"" << path.filename().string() << "\",\n"
+            << "        " << string_VkShaderStageFlagBits(stage) << ",\n"
+            << "        " << code.size() << "ull,\n"
+            << "        0x" << std::hex << ShaderLayout::hashCode(code.data(), code.size()) << std::dec << "ull,\n"
+            << "        " << arrayOrNull(bindings.empty(), "_BINDINGS") << ", " << bindings.size() << ",\n"
+            << "        " << arrayOrNull(pushConstants.empty(), "_PUSH_CONSTANTS") << ", " << pushConstants.size() << ",\n"
+            << "        " << arrayOrNull(inputs.empty(), "_VERTEX_INPUTS") << ", " << inputs.size() << ",\n"
+            << "    };\n\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <output header> <shader.spv>...\n", argv[0]);
+        return 1;
+    }
+
+    std::ostringstream out;
+    out << "// generated by shader-reflect from the compiled shaders, do not edit\n"
+        << "#ifndef SHADERLAYOUTS_H_\n"
+        << "#define SHADERLAYOUTS_H_\n\n"
+        << "#include \"ShaderLayout.h\"\n\n"
+        << "namespace ShaderLayouts\n{\n";
+
+    std::vector<std::string> identifiers;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            identifiers.push_back(getIdentifier(argv[i]));
+            reflect(out, argv[i], identifiers.back());
+        }
+    }
+    catch (const std::exception &e) {
+        std::fprintf(stderr, "shader-reflect: %s\n", e.what());
+        return 1;
+    }
+
+    out << "    constexpr ShaderLayout ALL[] = {\n";
+    for (const std::string &identifier : identifiers) {
+        out << "        " << identifier << ",\n";
+    }
+    if (identifiers.empty()) {
+        // arrays cannot be empty, a layout of no code is never found
+        out << "        ShaderLayout{},\n";
+    }
+    out << "    };\n}\n\n#endif\n";
+
+    // rewriting an unchanged header would recompile everything including it
+    std::filesystem::path outputPath = argv[1];
+    if (std::filesystem::exists(outputPath)) {
+        std::vector<std::byte> previous = readFile(outputPath);
+        std::string current = out.str();
+        if (previous.size() == current.size()
+            && std::equal(previous.begin(), previous.end(), current.begin(), [](std::byte a, char b) {
+                return a == static_cast<std::byte>(b);
+            })
+        ) {
+            return 0;
+        }
+    }
+    std::filesystem::create_directories(outputPath.parent_path());
+    std::ofstream file(outputPath, std::ios::trunc);
+    file << out.str();
+    return file ? 0 : 1;
+}